@@ -85,6 +85,18 @@ rtError
 rtRemoteLocateObject(rtRemoteEnvironment* env, char const* id, rtObjectRef& obj, int timeout=3000,
         remoteDisconnectedCallback cb=NULL, void *cbdata=NULL);
 
+/**
+ * Locate several remote objects by id with a single resolver round trip.
+ * @param ids The ids of the objects to locate.
+ * @param objs Receives one reference per id, in the same order. Ids that
+ * could not be found are left empty.
+ * @param count The number of entries in ids and objs.
+ * @returns RT_OK if every object was found
+ */
+rtError
+rtRemoteLocateObjects(rtRemoteEnvironment* env, char const* const* ids, rtObjectRef* objs, int count,
+        int timeout=3000, remoteDisconnectedCallback cb=NULL, void *cbdata=NULL);
+
 /**
  * Removes the pair {cb, data} from a client's disconnected callback list.
  * @param cb callback pointer
@@ -0,0 +1,73 @@
+/*
+
+pxCore Copyright 2005-2018 John Robinson
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+*/
+
+#ifndef __RT_REMOTE_BUFFER_H__
+#define __RT_REMOTE_BUFFER_H__
+
+#include <rtObject.h>
+#include <memory>
+#include <typeinfo>
+
+// An immutable block of bytes that can be passed anywhere an rtObjectRef
+// can. It is sent as a raw attachment after the frame, never as JSON, and
+// the receiver gets a local rtRemoteBuffer rather than a proxy.
+class rtRemoteBuffer final : public rtIObject
+{
+public:
+  // copies data
+  rtRemoteBuffer(void const* data, uint32_t length);
+
+  // shares data with owner, no copy
+  rtRemoteBuffer(std::shared_ptr<void> const& owner, char const* data, uint32_t length);
+
+  virtual ~rtRemoteBuffer();
+
+  // "length" is the only property
+  virtual rtError Get(char const* name, rtValue* value) const;
+  virtual rtError Get(uint32_t index, rtValue* value) const;
+  virtual rtError Set(char const* name, rtValue const* value);
+  virtual rtError Set(uint32_t index, rtValue const* value);
+
+  virtual unsigned long AddRef();
+  virtual unsigned long Release();
+  virtual rtMethodMap* getMap() const { return NULL; }
+
+  inline char const* data() const
+    { return m_data; }
+
+  inline uint32_t length() const
+    { return m_length; }
+
+  inline std::shared_ptr<void> const& owner() const
+    { return m_owner; }
+
+  // see rtRemoteObject::fromObject
+  static inline rtRemoteBuffer const* fromObject(rtIObject const* obj)
+  {
+    return (obj && typeid(*obj) == typeid(rtRemoteBuffer))
+      ? static_cast<rtRemoteBuffer const *>(obj) : nullptr;
+  }
+
+private:
+  rtAtomic                m_ref_count;
+  std::shared_ptr<void>   m_owner;
+  char const*             m_data;
+  uint32_t                m_length;
+};
+
+#endif
@@ -0,0 +1,69 @@
+/*
+
+pxCore Copyright 2005-2018 John Robinson
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+*/
+
+#ifndef __RT_REMOTE_CHAIN_RESOLVER_H__
+#define __RT_REMOTE_CHAIN_RESOLVER_H__
+
+#include "rtRemoteIResolver.h"
+
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+class rtRemoteEnvironment;
+
+// Asks several resolvers in turn and returns the first hit. Names
+// registered by this process are answered from memory before any of them.
+// The order comes from rt.rpc.resolver.chain, e.g. "file,multicast" or
+// "file,unicast,multicast" where a name service runs, so cheap local
+// lookups go first and the network is the fallback.
+// Registrations go to every resolver in the chain.
+class rtRemoteChainResolver : public rtRemoteIResolver
+{
+public:
+  rtRemoteChainResolver(rtRemoteEnvironment* env);
+  ~rtRemoteChainResolver();
+
+public:
+  virtual rtError open(sockaddr_storage const& rpc_endpoint) override;
+  virtual rtError close() override;
+  virtual rtError registerObject(std::string const& name, sockaddr_storage const& endpoint) override;
+  virtual rtError locateObject(std::string const& name, sockaddr_storage& endpoint,
+    uint32_t timeout) override;
+  virtual rtError unregisterObject(std::string const& name) override;
+  virtual rtError locateObjects(std::vector<std::string> const& names,
+    std::map<std::string, sockaddr_storage>& endpoints, uint32_t timeout) override;
+
+private:
+  struct Stage
+  {
+    std::string                        Name;
+    std::unique_ptr<rtRemoteIResolver> Resolver;
+  };
+
+  using LocalObjectMap = std::map< std::string, sockaddr_storage >;
+
+  rtRemoteEnvironment* m_env;
+  std::vector<Stage>   m_stages;
+  LocalObjectMap       m_local_objects;
+  std::mutex           m_mutex;
+};
+
+#endif
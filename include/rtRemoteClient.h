@@ -47,6 +47,7 @@ public:
   enum class State
   {
     Started,
+    Reconnecting,
     Shutdown
   };
 
@@ -58,7 +59,8 @@ public:
   rtRemoteClient(rtRemoteEnvironment* env, sockaddr_storage const& remoteEndpoint);
   ~rtRemoteClient();
 
-  rtError open();
+  // timeout bounds the connect, zero means rt.rpc.stream.connect_timeout_ms
+  rtError open(uint32_t timeout = 0);
   rtError startSession(std::string const& objectId, uint32_t timeout = 0);
 
   rtError sendSet(std::string const& objectId, uint32_t    propertyIdx , rtValue const& value);
@@ -73,14 +75,32 @@ public:
 
   void removeKeepAliveForObject(std::string const& s);
 
+  // a name this client was opened for by a locate. Reconnect looks these
+  // up again, ids the peer generated can't be.
+  void addLocatedObject(std::string const& objectId);
+
+  // one reconnect attempt, then the next one is scheduled or the client
+  // gives up. Called on the server's reconnect thread.
+  void runReconnect(rtRemoteServer* server);
+
   inline rtRemoteEnvironment* getEnvironment() const
     { return m_env; }
 
+  // the key the server's client table has this under. Set once, before
+  // the client is shared, so it can be read without the lock.
+  inline void setTableKey(std::string const& key)
+    { m_table_key = key; }
+  inline std::string const& getTableKey() const
+    { return m_table_key; }
+
   rtError send(rtRemoteMessagePtr const& msg);
 
   sockaddr_storage getRemoteEndpoint() const;
   sockaddr_storage getLocalEndpoint() const;
 
+  // the peer's pid, uid and gid. Only for same host unix connections.
+  bool getPeerCredentials(rtRemotePeerCredentials& creds) const;
+
 private:
   rtError sendGet(rtRemoteMessagePtr const& req, rtRemoteCorrelationKey k, rtValue& value);
   rtError sendSet(rtRemoteMessagePtr const& req, rtRemoteCorrelationKey k);
@@ -90,8 +110,11 @@ private:
   virtual rtError onMessage(rtRemoteMessagePtr const& msg);
   virtual rtError onStateChanged(std::shared_ptr<rtRemoteStream> const& stream, rtRemoteStream::State state);
 
-  rtError connectRpcEndpoint();
+  rtError connectRpcEndpoint(uint32_t timeout);
   rtError sendKeepAlive();
+  void notifyStateChanged(State state);
+  void scheduleReconnect();
+  rtError reconnect(rtRemoteServer* server);
 
   static rtError onSynchronousResponse_Handler(std::shared_ptr<rtRemoteClient>& client,
         rtRemoteMessagePtr const& msg, void* argp)
@@ -104,6 +127,17 @@ private:
   // bool moreToProcess(rtRemoteCorrelationKey k);
 
 private:
+  // how startSession treats the session.open round trip, from
+  // rt.rpc.client.session_open
+  enum class SessionOpen
+  {
+    Wait,
+    Pipeline,
+    Skip
+  };
+
+  static SessionOpen sessionOpenMode(rtRemoteEnvironment* env);
+
   inline std::shared_ptr<rtRemoteStream> getStream()
   {
     std::shared_ptr<rtRemoteStream> s;
@@ -116,9 +150,15 @@ private:
 
   std::shared_ptr<rtRemoteStream>           m_stream;
   std::vector<std::string>                  m_objects;
+  std::vector<std::string>                  m_located;
   std::recursive_mutex mutable              m_mutex;
   rtRemoteEnvironment*                      m_env;
   rtRemoteCallback<StateChangedHandler>     m_state_changed_handler;
+  bool                                      m_outbound;
+  uint32_t                                  m_reconnect_attempts;
+  uint32_t                                  m_reconnect_delay;
+  SessionOpen                               m_session_open;
+  std::string                               m_table_key;
 };
 
 #endif
@@ -23,6 +23,7 @@ limitations under the License.
 #include "rtRemoteCorrelationKey.h"
 #include "rtRemoteMessageHandler.h"
 
+#include <atomic>
 #include <condition_variable>
 #include <map>
 #include <mutex>
@@ -33,6 +34,7 @@ class rtRemoteServer;
 class rtRemoteConfig;
 class rtRemoteStreamSelector;
 class rtRemoteObjectCache;
+class rtRemoteTimerService;
 
 class rtRemoteEnvironment
 {
@@ -52,6 +54,7 @@ public:
   rtRemoteServer*           Server;
   rtRemoteObjectCache*      ObjectCache;
   rtRemoteStreamSelector*   StreamSelector;
+  rtRemoteTimerService*     Timers;
 
   using rtRemoteQueueReady = void (*)(void*);
 
@@ -65,6 +68,10 @@ public:
   rtError processSingleWorkItem(std::chrono::milliseconds timeout, bool wait, rtRemoteCorrelationKey* key, const rtRemoteCorrelationKey* const specificKey = nullptr);
   rtError waitForResponse(std::chrono::milliseconds timeout, rtRemoteCorrelationKey key);
 
+  // returns a process-unique id like "obj://<prefix>.<n>". The prefix is
+  // generated once, so this is just an atomic increment and a format.
+  std::string newObjectId(char const* scheme);
+
 private:
   struct WorkItem
   {
@@ -102,6 +109,8 @@ private:
   WorkItemMap                   m_specific_workitem_map; // Store workitems for pending requests here, not m_queue
   rtRemoteQueueReady            m_queue_ready_handler;
   void*                         m_queue_ready_context;
+  std::string                   m_object_id_prefix;
+  std::atomic<uint64_t>         m_next_object_id;
 };
 
 #endif
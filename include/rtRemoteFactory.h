@@ -24,7 +24,8 @@ enum rtResolverType
 {
   RT_RESOLVER_MULTICAST,
   RT_RESOLVER_FILE,
-  RT_RESOLVER_UNICAST
+  RT_RESOLVER_UNICAST,
+  RT_RESOLVER_CHAIN
 };
 
 
@@ -36,5 +37,11 @@ private:
   rtRemoteFactory();
   ~rtRemoteFactory();
 public:
+  // the one named by rt.rpc.resolver.type, or multicast if that isn't one
+  // we know
   static rtRemoteIResolver* rtRemoteCreateResolver(rtRemoteEnvironment* env);
+
+  // returns nullptr if resolverType isn't one we know
+  static rtRemoteIResolver* rtRemoteCreateResolver(rtRemoteEnvironment* env,
+    std::string const& resolverType);
 };
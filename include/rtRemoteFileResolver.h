@@ -16,21 +16,21 @@ limitations under the License.
 
 */
 
+#ifndef __RT_REMOTE_FILE_RESOLVER_H__
+#define __RT_REMOTE_FILE_RESOLVER_H__
+
 #include "rtRemoteIResolver.h"
+#include "rtRemoteLogStore.h"
 
 #include <string>
 #include <stdint.h>
 #include <netinet/in.h>
-#include <rtObject.h>
-
-#include "rtRemoteTypes.h"
-#include "rtRemoteIResolver.h"
-#include "rtRemoteEndpoint.h"
-#include "rtRemoteSocketUtils.h"
 
 class rtRemoteEnvironment;
 
-
+// Registrations shared through a file, kept as "name<tab>address<tab>port<tab>pid"
+// lines in an rtRemoteLogStore. The address is an ip or a unix socket path.
+// Entries whose process is gone are ignored.
 class rtRemoteFileResolver : public rtRemoteIResolver
 {
 public:
@@ -46,8 +46,8 @@ public:
   virtual rtError unregisterObject(std::string const& name) override;
 
 private:
-  std::string       m_rpc_addr;
-  uint16_t          m_rpc_port;
-  FILE*             m_db_fp;
+  rtRemoteLogStore     m_store;
   rtRemoteEnvironment* m_env;
 };
+
+#endif
@@ -22,11 +22,12 @@ limitations under the License.
 #include <rtObject.h>
 #include <memory>
 #include <string>
+#include <typeinfo>
 
 class rtRemoteClient;
 class rtRemoteEnvironment;
 
-class rtRemoteFunction : public rtIFunction
+class rtRemoteFunction final : public rtIFunction
 {
 public:
   rtRemoteFunction(std::string const& id, std::string const& name,
@@ -44,6 +45,13 @@ public:
   inline std::string const& getName() const
     { return m_name; }
 
+  // see rtRemoteObject::fromObject
+  static inline rtRemoteFunction* fromFunction(rtIFunction* func)
+  {
+    return (func && typeid(*func) == typeid(rtRemoteFunction))
+      ? static_cast<rtRemoteFunction *>(func) : nullptr;
+  }
+
   virtual size_t hash();
   virtual void setHash(size_t hash);
 
@@ -19,8 +19,11 @@ limitations under the License.
 #ifndef __RT_REMOTE_OBJECT_RESOLVER_H__
 #define __RT_REMOTE_OBJECT_RESOLVER_H__
 
+#include <chrono>
+#include <map>
 #include <memory>
 #include <string>
+#include <vector>
 #include <rtError.h>
 #include <sys/socket.h>
 #include <stdint.h>
@@ -36,6 +39,29 @@ public:
   virtual rtError registerObject(std::string const& name, sockaddr_storage const& endpoint) = 0;
   virtual rtError locateObject(std::string const& name, sockaddr_storage& endpoint, uint32_t timeout) = 0;
   virtual rtError unregisterObject(std::string const& name) = 0;
+
+  // Locates several names at once. Every name that was found gets an entry
+  // in endpoints. Returns RT_OK only if all of them were found. Resolvers
+  // that can ask for many names in one round trip should override this.
+  virtual rtError locateObjects(std::vector<std::string> const& names,
+    std::map<std::string, sockaddr_storage>& endpoints, uint32_t timeout)
+  {
+    using namespace std::chrono;
+    auto const deadline = steady_clock::now() + milliseconds(timeout);
+
+    rtError result = RT_OK;
+    for (std::string const& name : names)
+    {
+      auto remaining = duration_cast<milliseconds>(deadline - steady_clock::now()).count();
+      sockaddr_storage endpoint;
+      rtError e = locateObject(name, endpoint, remaining > 0 ? static_cast<uint32_t>(remaining) : 0);
+      if (e == RT_OK)
+        endpoints[name] = endpoint;
+      else if (result == RT_OK || e != RT_RESOURCE_NOT_FOUND)
+        result = e; // a timeout wins over not found
+    }
+    return result;
+  }
 };
 
 #endif
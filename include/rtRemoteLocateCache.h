@@ -0,0 +1,93 @@
+/*
+
+pxCore Copyright 2005-2018 John Robinson
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+*/
+
+#ifndef __RT_REMOTE_LOCATE_CACHE_H__
+#define __RT_REMOTE_LOCATE_CACHE_H__
+
+#include "rtRemoteIResolver.h"
+
+#include <chrono>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+class rtRemoteEnvironment;
+
+// Remembers the outcome of locateObject in front of another resolver.
+// Found names are kept for rt.rpc.resolver.cache.ttl_ms, names the resolver
+// says don't exist (RT_RESOURCE_NOT_FOUND) for
+// rt.rpc.resolver.cache.negative_ttl_ms. Timeouts and other errors aren't
+// cached. A ttl of zero turns that half of the cache off. When full, the
+// entry closest to expiring makes room.
+class rtRemoteLocateCache : public rtRemoteIResolver
+{
+public:
+  rtRemoteLocateCache(rtRemoteEnvironment* env, rtRemoteIResolver* resolver);
+  ~rtRemoteLocateCache();
+
+public:
+  virtual rtError open(sockaddr_storage const& rpc_endpoint) override;
+  virtual rtError close() override;
+  virtual rtError registerObject(std::string const& name, sockaddr_storage const& endpoint) override;
+  virtual rtError locateObject(std::string const& name, sockaddr_storage& endpoint,
+    uint32_t timeout) override;
+  virtual rtError unregisterObject(std::string const& name) override;
+  virtual rtError locateObjects(std::vector<std::string> const& names,
+    std::map<std::string, sockaddr_storage>& endpoints, uint32_t timeout) override;
+
+  // drop a single name, e.g. when the object is not at the cached endpoint
+  void invalidate(std::string const& name);
+
+  // drop every name that resolved to endpoint. call when a connection to it goes away
+  void invalidateEndpoint(sockaddr_storage const& endpoint);
+
+  void clear();
+
+private:
+  // names ordered by when they expire, so eviction doesn't scan
+  using ExpiryIndex = std::multimap< std::chrono::steady_clock::time_point, std::string >;
+
+  struct Entry
+  {
+    rtError                               Status;
+    sockaddr_storage                      Endpoint;
+    std::string                           EndpointName;
+    std::chrono::steady_clock::time_point Expires;
+    ExpiryIndex::iterator                 ExpiryPos;
+  };
+
+  using EntryMap = std::map< std::string, Entry >;
+
+  void insert(std::string const& name, rtError status, sockaddr_storage const& endpoint);
+
+  // m_mutex must be held
+  EntryMap::iterator erase(EntryMap::iterator itr);
+
+  rtRemoteEnvironment*               m_env;
+  std::unique_ptr<rtRemoteIResolver> m_resolver;
+  std::mutex                         m_mutex;
+  EntryMap                           m_entries;
+  ExpiryIndex                        m_expiry;
+  std::chrono::milliseconds          m_ttl;
+  std::chrono::milliseconds          m_negative_ttl;
+  size_t                             m_max_entries;
+};
+
+#endif
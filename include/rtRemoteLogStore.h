@@ -0,0 +1,77 @@
+/*
+
+pxCore Copyright 2005-2018 John Robinson
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+*/
+
+#ifndef __RT_REMOTE_LOG_STORE_H__
+#define __RT_REMOTE_LOG_STORE_H__
+
+#include <functional>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+#include <rtError.h>
+#include <sys/types.h>
+#include <time.h>
+
+// A string map shared between processes through a file. The file is an
+// append-only log of "key<separator>value" lines, where an empty value
+// removes the key. Every process keeps a parsed copy and only reads what
+// was appended since it last looked. Once the log is mostly stale it is
+// rewritten to a temp file and renamed over the original.
+class rtRemoteLogStore
+{
+public:
+  rtRemoteLogStore(std::string const& separator);
+  ~rtRemoteLogStore();
+
+  rtError open(std::string const& path);
+  rtError close();
+
+  rtError get(std::string const& key, std::string& value);
+  rtError put(std::string const& key, std::string const& value);
+  rtError erase(std::string const& key);
+
+  // values the filter rejects read as missing. they are erased when found
+  // and left out when the log is compacted.
+  using Filter = std::function<bool(std::string const& value)>;
+  void setFilter(Filter const& filter);
+
+private:
+  rtError openFile();
+  rtError refresh();
+  rtError reload();
+  // writes record unless precondition, checked with the file locked and
+  // the parsed copy current, returns false
+  rtError append(std::string const& record, std::function<bool()> const& precondition = nullptr);
+  rtError compact();
+  void apply(char const* begin, char const* end);
+  bool validKey(std::string const& key) const;
+
+  std::string                                   m_separator;
+  std::string                                   m_path;
+  int                                           m_fd;
+  ino_t                                         m_ino;
+  off_t                                         m_parsed_size;
+  timespec                                      m_parsed_mtime;
+  size_t                                        m_live_bytes;
+  std::unordered_map<std::string, std::string>  m_entries;
+  Filter                                        m_filter;
+  std::mutex                                    m_mutex;
+};
+
+#endif
@@ -19,7 +19,7 @@ limitations under the License.
 #ifndef __RT_REMOTE_ENDPOINT_MAPPER_H__
 #define __RT_REMOTE_ENDPOINT_MAPPER_H__
 
-#include "rtRemoteEndpoint.h"
+#include "rtRemoteEndPoint.h"
 #include "rtError.h"
 #include <string>
 
@@ -31,9 +31,9 @@ public:
   virtual ~rtRemoteIMapper() { }
 
 public:
-  virtual rtError registerEndpoint(std::string const& objectId, rtRemoteEndpointPtr const& endpoint) = 0;
+  virtual rtError registerEndpoint(std::string const& objectId, rtRemoteEndPointPtr const& endpoint) = 0;
   virtual rtError deregisterEndpoint(std::string const& objectId) = 0;
-  virtual rtError lookupEndpoint(std::string const& objectId, rtRemoteEndpointPtr& endpoint) = 0; 
+  virtual rtError lookupEndpoint(std::string const& objectId, rtRemoteEndPointPtr& endpoint) = 0; 
   virtual bool    isRegistered(std::string const& objectId) = 0;
 
 protected:
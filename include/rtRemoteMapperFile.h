@@ -20,13 +20,15 @@ limitations under the License.
 #define __RT_REMOTE_ENDPOINT_MAPPER_FILE_H__
 
 #include "rtRemoteMapper.h"
-#include "rtRemoteEndpoint.h"
+#include "rtRemoteEndPoint.h"
+#include "rtRemoteLogStore.h"
 #include "rtError.h"
 #include <string>
-#include <mutex>
 
 class rtRemoteEnvironment;
 
+// Endpoints shared through a file, kept as "objectId::=uri" lines in an
+// rtRemoteLogStore.
 class rtRemoteMapperFile : public virtual rtRemoteIMapper
 {
 public:
@@ -34,14 +36,13 @@ public:
   ~rtRemoteMapperFile();
 
 public:
-  virtual rtError registerEndpoint(std::string const& objectId, rtRemoteEndpointPtr const& endpoint) override;
+  virtual rtError registerEndpoint(std::string const& objectId, rtRemoteEndPointPtr const& endpoint) override;
   virtual rtError deregisterEndpoint(std::string const& objectId) override;
-  virtual rtError lookupEndpoint(std::string const& objectId, rtRemoteEndpointPtr& endpoint) override; 
+  virtual rtError lookupEndpoint(std::string const& objectId, rtRemoteEndPointPtr& endpoint) override; 
   virtual bool    isRegistered(std::string const& objectId) override;
 
 private:
-  std::string m_file_path;
-  std::mutex  m_mutex;
+  rtRemoteLogStore m_store;
 };
 
 #endif
@@ -20,7 +20,7 @@ limitations under the License.
 #define __RT_REMOTE_ENDPOINT_MAPPER_MAP_H__
 
 #include "rtRemoteMapper.h"
-#include "rtRemoteEndpoint.h"
+#include "rtRemoteEndPoint.h"
 #include "rtError.h"
 #include <string>
 #include <mutex>
@@ -34,13 +34,13 @@ public:
   rtRemoteMapperMap(rtRemoteEnvironment* env);
 
 public:
-  virtual rtError registerEndpoint(std::string const& objectId, rtRemoteEndpointPtr const& endpoint) override;
+  virtual rtError registerEndpoint(std::string const& objectId, rtRemoteEndPointPtr const& endpoint) override;
   virtual rtError deregisterEndpoint(std::string const& objectId) override;
-  virtual rtError lookupEndpoint(std::string const& objectId, rtRemoteEndpointPtr& endpoint) override; 
+  virtual rtError lookupEndpoint(std::string const& objectId, rtRemoteEndPointPtr& endpoint) override; 
   virtual bool    isRegistered(std::string const& objectId) override;
 
 private:
-  using RegisteredObjectsMap = std::map< std::string, rtRemoteEndpointPtr >;
+  using RegisteredObjectsMap = std::map< std::string, rtRemoteEndPointPtr >;
 
 private: 
   RegisteredObjectsMap m_hosted_objects;
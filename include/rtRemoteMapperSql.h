@@ -20,23 +20,42 @@ limitations under the License.
 #define __RT_REMOTE_ENDPOINT_MAPPER_SQL_H__
 
 #include "rtRemoteMapper.h"
-#include "rtRemoteEndpoint.h"
+#include "rtRemoteEndPoint.h"
 #include "rtError.h"
 #include <string>
+#include <mutex>
 
 class rtRemoteEnvironment;
 
+struct sqlite3;
+struct sqlite3_stmt;
+
+// Endpoints kept in an SQLite database. The database runs in WAL mode so
+// lookups from other processes don't wait on writers.
 class rtRemoteMapperSql : public virtual rtRemoteIMapper
 {
 public:
   rtRemoteMapperSql(rtRemoteEnvironment* env);
-  //~rtRemoteMapperSql();
+  ~rtRemoteMapperSql();
 
 public:
-  virtual rtError registerEndpoint(std::string const& objectId, rtRemoteEndpointPtr const& endpoint) override;
+  virtual rtError registerEndpoint(std::string const& objectId, rtRemoteEndPointPtr const& endpoint) override;
   virtual rtError deregisterEndpoint(std::string const& objectId) override;
-  virtual rtError lookupEndpoint(std::string const& objectId, rtRemoteEndpointPtr& endpoint) override; 
+  virtual rtError lookupEndpoint(std::string const& objectId, rtRemoteEndPointPtr& endpoint) override; 
   virtual bool    isRegistered(std::string const& objectId) override;
+
+private:
+  rtError open(std::string const& path);
+  void close();
+  rtError exec(char const* sql);
+  rtError prepare(char const* sql, sqlite3_stmt** stmt);
+  rtError lookup(std::string const& objectId, std::string& uri);
+
+  sqlite3*      m_db;
+  sqlite3_stmt* m_insert;
+  sqlite3_stmt* m_delete;
+  sqlite3_stmt* m_select;
+  std::mutex    m_mutex;
 };
 
 #endif
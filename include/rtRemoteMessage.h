@@ -21,6 +21,7 @@ limitations under the License.
 
 #include <limits>
 #include <memory>
+#include <vector>
 #include <rapidjson/document.h>
 #include <rtError.h>
 #include <rtValue.h>
@@ -42,6 +43,7 @@ limitations under the License.
 #define kFieldNameValue "value"
 #define kFieldNameValueType "type"
 #define kFieldNameValueValue "value"
+#define kFieldNameValueAttachment "attachment"
 #define kFieldNameSenderId "sender.id"
 #define kFieldNameKeepAliveIds "keep_alive.ids"
 #define kFieldNameEndPoint "endpoint"
@@ -49,6 +51,10 @@ limitations under the License.
 #define kFieldNameScheme "scheme"
 #define kFieldNameEndpointType "endpoint.type"
 #define kFieldNameReplyTo "reply-to"
+#define kFieldNameObjectIds "object.ids"
+#define kFieldNameIp "ip"
+#define kFieldNamePort "port"
+#define kFieldNameLease "lease"
 #define kEndpointTypeLocal "local.endpoint"
 #define kEndpointTypeRemote "net.endpoint"
 #define kNullObjectId "nil"
@@ -70,6 +76,8 @@ limitations under the License.
 #define kMessageTypeMethodCallRequest "method.call.request"
 #define kMessageTypeKeepAliveRequest "keep_alive.request"
 #define kMessageTypeOpenSessionRequest "session.open.request"
+#define kMessageTypeShmOpenRequest "shm.open.request"
+#define kMessageTypeShmOpenResponse "shm.open.response"
 
 #define kInvalidPropertyIndex std::numeric_limits<uint32_t>::max()
 
@@ -87,23 +95,86 @@ limitations under the License.
 #define kNsMessageTypeUpdateResponse "ns.update.response"
 #define kNsMessageTypeRegister "ns.register"
 #define kNsMessageTypeRegisterResponse "ns.register.response"
+#define kNsMessageTypeSubscribe "ns.subscribe"
+#define kNsMessageTypeSubscribeResponse "ns.subscribe.response"
+#define kNsMessageTypeUnsubscribe "ns.unsubscribe"
+#define kNsMessageTypeEvent "ns.event"
+#define kNsFieldNameEvent "ns.event"
+#define kNsFieldNamePrefix "ns.prefix"
+#define kNsFieldNameObjectIds "ns.object.ids"
+#define kNsFieldNameObjects "ns.objects"
+// names per batched ns.lookup, so the reply fits in a datagram
+#define kNsMaxLookupBatch 32
+#define kNsEventRegister "register"
+#define kNsEventDeregister "deregister"
 #define kNsFieldNameStatusCode "ns.status"
 #define kNsStatusSuccess "ns.status.success"
 #define kNsStatusFail "ns.status.fail"
 
-using rtRemoteMessage     = rapidjson::Document;
+// A payload that travels on the wire after the json frame rather than inside
+// it, so large values are neither escaped nor copied into the DOM. Owner
+// keeps Data alive.
+struct rtRemoteAttachment
+{
+  char const*           Data;
+  uint32_t              Length;
+  std::shared_ptr<void> Owner;
+};
+
+using rtRemoteAttachmentList = std::vector<rtRemoteAttachment>;
+
+class rtRemoteMessage : public rapidjson::Document
+{
+public:
+  ~rtRemoteMessage();
+
+  // returns the index a value uses to refer to the attachment
+  inline uint32_t addAttachment(rtRemoteAttachment const& a)
+  {
+    m_attachments.push_back(a);
+    return static_cast<uint32_t>(m_attachments.size() - 1);
+  }
+
+  inline rtRemoteAttachment const* getAttachment(uint32_t index) const
+    { return index < m_attachments.size() ? &m_attachments[index] : nullptr; }
+
+  inline rtRemoteAttachmentList const& getAttachments() const
+    { return m_attachments; }
+
+  inline void setAttachments(rtRemoteAttachmentList&& list)
+    { m_attachments = std::move(list); }
+
+  // descriptors that arrived with the message over a unix socket. Any that
+  // are not taken are closed along with the message.
+  inline void setFileDescriptors(std::vector<int>&& fds)
+    { m_fds = std::move(fds); }
+
+  inline std::vector<int> takeFileDescriptors()
+    { std::vector<int> fds; fds.swap(m_fds); return fds; }
+
+private:
+  rtRemoteAttachmentList m_attachments;
+  std::vector<int>       m_fds;
+};
+
 using rtRemoteMessagePtr  = std::shared_ptr<rtRemoteMessage>;
 
-char const*             rtMessage_GetPropertyName(rtRemoteMessage const& m);
-uint32_t                rtMessage_GetPropertyIndex(rtRemoteMessage const& m);
-char const*             rtMessage_GetMessageType(rtRemoteMessage const& m);
-rtRemoteCorrelationKey  rtMessage_GetCorrelationKey(rtRemoteMessage const& m);
-char const*             rtMessage_GetObjectId(rtRemoteMessage const& m);
-rtError                 rtMessage_GetStatusCode(rtRemoteMessage const& m);
-char const*             rtMessage_GetStatusMessage(rtRemoteMessage const& m);
-rtError                 rtMessage_Dump(rtRemoteMessage const& m, FILE* out = stdout);
-rtError                 rtMessage_SetStatus(rtRemoteMessage& m, rtError code, char const* fmt, ...) RT_PRINTF_FORMAT(3, 4);
-rtError                 rtMessage_SetStatus(rtRemoteMessage& m, rtError code);
+char const*             rtMessage_GetPropertyName(rapidjson::Document const& m);
+uint32_t                rtMessage_GetPropertyIndex(rapidjson::Document const& m);
+char const*             rtMessage_GetMessageType(rapidjson::Document const& m);
+rtRemoteCorrelationKey  rtMessage_GetCorrelationKey(rapidjson::Document const& m);
+char const*             rtMessage_GetObjectId(rapidjson::Document const& m);
+rtError                 rtMessage_GetStatusCode(rapidjson::Document const& m);
+char const*             rtMessage_GetStatusMessage(rapidjson::Document const& m);
+rtError                 rtMessage_Dump(rapidjson::Document const& m, FILE* out = stdout);
+rtError                 rtMessage_SetStatus(rapidjson::Document& m, rtError code, char const* fmt, ...) RT_PRINTF_FORMAT(3, 4);
+rtError                 rtMessage_SetStatus(rapidjson::Document& m, rtError code);
 rtRemoteCorrelationKey  rtMessage_GetNextCorrelationKey();
 
+// true if the fields the rtMessage_Get accessors read without checking
+// have the right type: message.type is a string, and correlation.key,
+// object.id and status.message are strings where present. Check this before trusting a
+// message from another process.
+bool                    rtMessage_IsWellFormed(rapidjson::Document const& m);
+
 #endif
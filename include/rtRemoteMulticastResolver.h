@@ -22,6 +22,7 @@ limitations under the License.
 #include <mutex>
 #include <string>
 #include <thread>
+#include <vector>
 
 #include <stdint.h>
 #include <netinet/in.h>
@@ -29,6 +30,7 @@ limitations under the License.
 
 #include "rtRemoteCorrelationKey.h"
 #include "rtRemoteEndPoint.h"
+#include "rtRemotePendingRequests.h"
 #include "rtRemoteTypes.h"
 #include "rtRemoteSocketUtils.h"
 
@@ -48,18 +50,30 @@ public:
   virtual rtError locateObject(std::string const& name, sockaddr_storage& endpoint,
     uint32_t timeout) override;
   virtual rtError unregisterObject(std::string const& name) override;
+  virtual rtError locateObjects(std::vector<std::string> const& names,
+    std::map<std::string, sockaddr_storage>& endpoints, uint32_t timeout) override;
 
 private:
   using CommandHandler = rtError (rtRemoteMulticastResolver::*)(rtRemoteMessagePtr const&, sockaddr_storage const&);
   using HostedObjectsMap = std::map< std::string, sockaddr_storage >;
   using CommandHandlerMap = std::map< std::string, CommandHandler >;
-  using RequestMap = std::map< rtRemoteCorrelationKey, rtRemoteMessagePtr >;
+
+  // a search for several names. answers trickle in from different hosts
+  struct PendingBatch
+  {
+    std::mutex                              Mutex;
+    std::condition_variable                 Cond;
+    std::map<std::string, sockaddr_storage> Found;
+  };
+  using BatchMap = std::map< rtRemoteCorrelationKey, std::shared_ptr<PendingBatch> >;
 
   void runListener();
   void doRead(int fd, rtRemoteSocketBuffer& buff);
   void doDispatch(char const* buff, int n, sockaddr_storage* peer);
 
   rtError sendSearchAndWait(const std::string& name, const int timeout, rtRemoteMessagePtr& ret);
+  rtError sendSearch(rtRemoteCorrelationKey const& seqId, std::vector<std::string> const& names);
+  rtError onBatchLocate(std::shared_ptr<PendingBatch> const& batch, rtRemoteMessagePtr const& doc);
 
   rtError init();
   rtError openUnicastSocket();
@@ -80,13 +94,14 @@ private:
   socklen_t         m_ucast_len;
 
   std::unique_ptr<std::thread> m_read_thread;
-  std::condition_variable m_cond;
   std::mutex        m_mutex;
   pid_t             m_pid;
   CommandHandlerMap m_command_handlers;
   rtRemoteEndPointPtr m_rpc_endpoint;
   HostedObjectsMap  m_hosted_objects;
-  RequestMap	      m_pending_searches;
+  rtRemotePendingRequests m_pending_searches;
+  std::mutex        m_batch_mutex;
+  BatchMap          m_pending_batches;
   int		            m_shutdown_pipe[2];
   rtRemoteEnvironment* m_env;
 };
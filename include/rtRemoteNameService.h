@@ -17,15 +17,17 @@ limitations under the License.
 */
 
 #include "rtRemoteCorrelationKey.h"
-#include "rtRemoteEndpoint.h"
+#include "rtRemoteEndPoint.h"
 #include "rtRemoteSocketUtils.h"
 #include "rtRemoteEnvironment.h"
 
+#include <chrono>
 #include <condition_variable>
 #include <map>
 #include <mutex>
 #include <string>
 #include <thread>
+#include <vector>
 
 #include <stdint.h>
 #include <netinet/in.h>
@@ -47,12 +49,49 @@ private:
   using CommandHandler = rtError (rtRemoteNameService::*)(rtRemoteMessagePtr const&, sockaddr_storage const&);
   using CommandHandlerMap = std::map< std::string, CommandHandler >;
   using RequestMap = std::map< rtRemoteCorrelationKey, rtRemoteMessagePtr >;
-  using RegisteredObjectsMap = std::map< std::string, sockaddr_storage >;
+
+  // a registration lives until its lease runs out. Response is the lookup
+  // reply rendered once at register time, minus sender and correlation key.
+  struct Registration
+  {
+    sockaddr_storage                      Endpoint;
+    std::chrono::steady_clock::time_point Expires;
+    std::string                           Response;
+  };
+  using RegisteredObjectsMap = std::map< std::string, Registration >;
+
+  // someone who wants to hear about a name, or every name starting with
+  // Pattern. Renewed by sending the subscribe again.
+  struct Subscription
+  {
+    std::string                           Pattern;
+    bool                                  Prefix;
+    sockaddr_storage                      Subscriber;
+    std::chrono::steady_clock::time_point Expires;
+
+    bool matches(std::string const& name) const
+      { return Prefix ? name.compare(0, Pattern.size(), Pattern) == 0 : name == Pattern; }
+  };
+  using SubscriptionList = std::vector< Subscription >;
 
   rtError onRegister(rtRemoteMessagePtr const& doc, sockaddr_storage const& soc);
   rtError onDeregister(rtRemoteMessagePtr const& doc, sockaddr_storage const& soc);
   rtError onUpdate(rtRemoteMessagePtr const& doc, sockaddr_storage const& soc);
   rtError onLookup(rtRemoteMessagePtr const& doc, sockaddr_storage const& soc);
+  rtError onLookupMany(rtRemoteMessagePtr const& doc, rapidjson::Value const& ids,
+    sockaddr_storage const& soc);
+  rtError onSubscribe(rtRemoteMessagePtr const& doc, sockaddr_storage const& soc);
+  rtError onUnsubscribe(rtRemoteMessagePtr const& doc, sockaddr_storage const& soc);
+
+  void notify(char const* event, std::string const& objectId, sockaddr_storage const* endpoint);
+  rtError sendEvent(char const* event, std::string const& objectId, sockaddr_storage const* endpoint,
+    sockaddr_storage const& subscriber);
+
+  rtError sendStatus(char const* messageType, rtRemoteMessagePtr const& req, bool success,
+    sockaddr_storage const& soc);
+  std::chrono::milliseconds leaseFrom(rtRemoteMessagePtr const& doc) const;
+  static std::string renderLookupResponse(char const* objectId, sockaddr_storage const& endpoint);
+  void purgeExpired();
 
   void runListener();
   void doRead(int fd, rtRemoteSocketBuffer& buff);
@@ -69,6 +108,7 @@ private:
   CommandHandlerMap    m_command_handlers;
   RequestMap           m_pending_requests;
   RegisteredObjectsMap m_registered_objects;
+  SubscriptionList     m_subscriptions;
 
   std::mutex                   m_mutex;
   std::unique_ptr<std::thread> m_read_thread;
@@ -16,16 +16,21 @@ limitations under the License.
 
 */
 
+#ifndef __RT_REMOTE_NS_RESOLVER_H__
+#define __RT_REMOTE_NS_RESOLVER_H__
+
 #include "rtRemoteIResolver.h"
 #include "rtRemoteTypes.h"
 #include "rtRemoteCorrelationKey.h"
+#include "rtRemotePendingRequests.h"
 #include "rtRemoteSocketUtils.h"
 
-#include <condition_variable>
+#include <chrono>
 #include <map>
 #include <mutex>
 #include <string>
 #include <thread>
+#include <vector>
 
 #include <stdint.h>
 #include <netinet/in.h>
@@ -48,11 +53,44 @@ public:
   rtError registerObject(std::string const& name, sockaddr_storage const& endpoint, uint32_t timeout);
   virtual rtError unregisterObject(std::string const& name) override;
 
+  // one ns.lookup per kNsMaxLookupBatch names, all in flight together
+  virtual rtError locateObjects(std::vector<std::string> const& names,
+    std::map<std::string, sockaddr_storage>& endpoints, uint32_t timeout) override;
+
+  // asks the name service to push changes for pattern (or every name
+  // starting with it). locateObject answers subscribed names from memory.
+  // open() subscribes to the comma separated patterns in
+  // rt.rpc.resolver.unicast.subscribe, where a trailing '*' means prefix.
+  rtError subscribe(std::string const& pattern, bool prefix);
+  rtError unsubscribe(std::string const& pattern);
+
 private:
   using CommandHandler = rtError (rtRemoteNsResolver::*)(rtRemoteMessagePtr const&, sockaddr_storage const&);
   using HostedObjectsMap = std::map< std::string, sockaddr_storage >;
+
+  // a name pushed by the name service. the service resends every match
+  // when a subscription is renewed, which pushes Expires out again.
+  struct KnownObject
+  {
+    sockaddr_storage                      Endpoint;
+    std::chrono::steady_clock::time_point Expires;
+  };
+  using KnownObjectsMap = std::map< std::string, KnownObject >;
+
+  // Key is the correlation key of the last subscribe sent. Acked is set
+  // when the name service answers it.
+  struct Subscription
+  {
+    std::string Pattern;
+    bool        Prefix;
+    std::string Key;
+    bool        Acked;
+
+    bool matches(std::string const& name) const
+      { return Prefix ? name.compare(0, Pattern.size(), Pattern) == 0 : name == Pattern; }
+  };
+  using SubscriptionList = std::vector< Subscription >;
   using CommandHandlerMap = std::map< std::string, CommandHandler >;
-  using RequestMap = std::map< rtRemoteCorrelationKey, rtRemoteMessagePtr >;
 
   void runListener();
   void doRead(int fd, rtRemoteSocketBuffer& buff);
@@ -63,6 +101,19 @@ private:
 
   // command handlers
   rtError onLocate(rtRemoteMessagePtr const& doc, sockaddr_storage const& soc);
+  rtError onUpdateResponse(rtRemoteMessagePtr const& doc, sockaddr_storage const& soc);
+  rtError onEvent(rtRemoteMessagePtr const& doc, sockaddr_storage const& soc);
+  rtError onSubscribeResponse(rtRemoteMessagePtr const& doc, sockaddr_storage const& soc);
+  rtError sendSubscribe(char const* messageType, std::string const& pattern, bool prefix,
+    rtRemoteCorrelationKey const& seqId);
+
+  // drops known names matched by sub that no other acked subscription
+  // covers. m_mutex must be held.
+  void forgetKnownObjects(Subscription const& sub);
+
+  rtError sendRegistration(char const* messageType, std::string const& name,
+    sockaddr_storage const& endpoint, rtRemoteCorrelationKey const& seqId);
+  void sendHeartbeats();
 
 private:
 
@@ -71,14 +122,15 @@ private:
   socklen_t         m_static_len;
 
   std::unique_ptr<std::thread> m_read_thread;
-  std::condition_variable m_cond;
   std::mutex        m_mutex;
   pid_t             m_pid;
   CommandHandlerMap m_command_handlers;
   std::string       m_rpc_addr;
   uint16_t          m_rpc_port;
   HostedObjectsMap  m_hosted_objects;
-  RequestMap	    m_pending_searches;
+  KnownObjectsMap   m_known_objects;
+  SubscriptionList  m_subscriptions;
+  rtRemotePendingRequests m_pending_searches;
   int		        m_shutdown_pipe[2];
 
   sockaddr_storage  m_ns_dest;
@@ -87,3 +139,5 @@ private:
   // endpointMapper;
   // 
 };
+
+#endif
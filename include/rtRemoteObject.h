@@ -22,10 +22,11 @@ limitations under the License.
 #include <rtObject.h>
 #include <memory>
 #include <string>
+#include <typeinfo>
 
 class rtRemoteClient;
 
-class rtRemoteObject : public rtIObject
+class rtRemoteObject final : public rtIObject
 {
 public:
   rtRemoteObject(std::string const& id, std::shared_ptr<rtRemoteClient> const& transport);
@@ -42,6 +43,14 @@ public:
   inline std::string const& getId() const
     { return m_id; }
 
+  // returns obj if it is a remote proxy, nullptr otherwise. The class is final
+  // so an exact type match replaces the dynamic_cast hierarchy walk.
+  static inline rtRemoteObject const* fromObject(rtIObject const* obj)
+  {
+    return (obj && typeid(*obj) == typeid(rtRemoteObject))
+      ? static_cast<rtRemoteObject const *>(obj) : nullptr;
+  }
+
 private:
   rtAtomic                          m_ref_count;
   std::string                       m_id;
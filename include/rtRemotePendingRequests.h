@@ -0,0 +1,59 @@
+/*
+
+pxCore Copyright 2005-2018 John Robinson
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+*/
+
+#ifndef __RT_REMOTE_PENDING_REQUESTS_H__
+#define __RT_REMOTE_PENDING_REQUESTS_H__
+
+#include "rtRemoteCorrelationKey.h"
+#include "rtRemoteMessage.h"
+
+#include <future>
+#include <map>
+#include <mutex>
+
+// Requests waiting for a reply, keyed by correlation key. Every request
+// has its own promise, so a reply wakes only the thread that asked. The
+// table is split into shards with their own lock, so parallel lookups
+// rarely touch the same mutex.
+class rtRemotePendingRequests
+{
+public:
+  // call before sending the request so that a fast reply is not missed
+  std::future<rtRemoteMessagePtr> add(rtRemoteCorrelationKey const& key);
+
+  // hands doc to whoever waits on key. returns false if nobody does
+  bool complete(rtRemoteCorrelationKey const& key, rtRemoteMessagePtr const& doc);
+
+  // forget a request that timed out or failed to send
+  void remove(rtRemoteCorrelationKey const& key);
+
+private:
+  static const int kShardCount = 16;
+
+  struct Shard
+  {
+    std::mutex Mutex;
+    std::map< rtRemoteCorrelationKey, std::promise<rtRemoteMessagePtr> > Requests;
+  };
+
+  Shard& shardFor(rtRemoteCorrelationKey const& key);
+
+  Shard m_shards[kShardCount];
+};
+
+#endif
@@ -24,10 +24,15 @@ limitations under the License.
 #include "rtRemoteMessageHandler.h"
 
 #include <condition_variable>
+#include <deque>
 #include <map>
+#include <memory>
 #include <mutex>
+#include <set>
 #include <string>
 #include <thread>
+#include <unordered_map>
+#include <vector>
 
 #include <stdint.h>
 #include <netinet/in.h>
@@ -35,7 +40,7 @@ limitations under the License.
 
 typedef void(*clientDisconnectedCallback)(void *data);
 
-class rtRemoteIResolver;
+class rtRemoteLocateCache;
 
 class rtRemoteServer
 {
@@ -48,7 +53,16 @@ public:
   rtError registerObject(std::string const& objectId, rtObjectRef const& obj);
   rtError unregisterObject(std::string const& objectId);
   rtError findObject(std::string const& objectId, rtObjectRef& obj, uint32_t timeout, clientDisconnectedCallback cb, void *cbdata);
+  rtError findObjects(std::vector<std::string> const& objectIds, std::vector<rtObjectRef>& objs,
+    uint32_t timeout, clientDisconnectedCallback cb, void *cbdata);
   rtError unregisterDisconnectedCallback( clientDisconnectedCallback cb, void *cbdata );
+
+  // asks the resolver where objectId lives, for clients that reconnect
+  rtError locateObject(std::string const& objectId, sockaddr_storage& endpoint, uint32_t timeout);
+
+  // runs client->reconnect() on the reconnect thread. Locating and
+  // connecting block, so it's kept off the timer thread.
+  void queueReconnect(std::shared_ptr<rtRemoteClient> const& client);
   rtError removeStaleObjects();
   rtError processMessage(std::shared_ptr<rtRemoteClient>& client, rtRemoteMessagePtr const& msg);
 
@@ -61,12 +75,22 @@ private:
   };
 
   void runListener();
+  void runReconnects();
+  void runAcceptor(int fd);
   void doAccept(int fd);
+  rtError openReusePortListeners();
+  rtError getClient(sockaddr_storage const& endpoint, uint32_t slot, uint32_t timeout,
+    std::shared_ptr<rtRemoteClient>& client);
+  void removeFromClientTable(std::shared_ptr<rtRemoteClient> const& client);
+  void addToClientTable(std::shared_ptr<rtRemoteClient> const& client);
 
 
   static rtError onOpenSession_Dispatch(std::shared_ptr<rtRemoteClient>& client, rtRemoteMessagePtr const& doc, void* argp)
     { return reinterpret_cast<rtRemoteServer *>(argp)->onOpenSession(client, doc); }
 
+  static rtError onOpenSessionResponse_Dispatch(std::shared_ptr<rtRemoteClient>& client, rtRemoteMessagePtr const& doc, void* argp)
+    { return reinterpret_cast<rtRemoteServer *>(argp)->onOpenSessionResponse(client, doc); }
+
   static rtError onGet_Dispatch(std::shared_ptr<rtRemoteClient>& client, rtRemoteMessagePtr const& doc, void* argp)
     { return reinterpret_cast<rtRemoteServer *>(argp)->onGet(client, doc); }
 
@@ -93,6 +117,7 @@ private:
   rtError start();
   rtError onIncomingMessage(std::shared_ptr<rtRemoteClient>& client, rtRemoteMessagePtr const& msg);
   rtError onOpenSession(std::shared_ptr<rtRemoteClient>& client, rtRemoteMessagePtr const& doc);
+  rtError onOpenSessionResponse(std::shared_ptr<rtRemoteClient>& client, rtRemoteMessagePtr const& doc);
   rtError onGet(std::shared_ptr<rtRemoteClient>& client, rtRemoteMessagePtr const& doc);
   rtError onSet(std::shared_ptr<rtRemoteClient>& client, rtRemoteMessagePtr const& doc);
   rtError onMethodCall(std::shared_ptr<rtRemoteClient>& client, rtRemoteMessagePtr const& doc);
@@ -100,6 +125,8 @@ private:
   rtError onKeepAliveResponse(std::shared_ptr<rtRemoteClient>& client, rtRemoteMessagePtr const& doc);
   rtError openRpcListener();
   rtError onClientStateChanged(std::shared_ptr<rtRemoteClient> const& client, rtRemoteClient::State state);
+  rtError openRemoteObject(std::string const& objectId, sockaddr_storage const& objectEndpoint,
+    rtObjectRef& obj, uint32_t timeout, clientDisconnectedCallback cb, void *cbdata);
 
 private:
   struct ObjectReference
@@ -117,7 +144,19 @@ private:
       bool operator == (const ClientDisconnectedCB& other) const {return func == other.func && data == other.data;}
   };
 
-  using ClientMap = std::map< std::string, std::shared_ptr<rtRemoteClient> >;
+  // a connect in progress. others asking for the same endpoint wait on it
+  struct PendingConnect
+  {
+    PendingConnect() : Done(false), Status(RT_OK) { }
+
+    bool                            Done;
+    rtError                         Status;
+    std::shared_ptr<rtRemoteClient> Client;
+  };
+
+  // keyed on pool slot and normalized peer address, see clientKey
+  using ClientMap = std::unordered_map< std::string, std::shared_ptr<rtRemoteClient> >;
+  using PendingConnectMap = std::unordered_map< std::string, std::shared_ptr<PendingConnect> >;
   using ClientDisconnectedCBMap = std::map< rtRemoteClient*, std::vector<ClientDisconnectedCB> >;
   using ClientList = std::vector< std::shared_ptr<rtRemoteClient > >;
   using CommandHandlerMap = std::map< std::string, rtRemoteCallback<rtRemoteMessageHandler> >;
@@ -127,15 +166,28 @@ private:
   int                           m_listen_fd;
 
   std::unique_ptr<std::thread>  m_thread;
+  std::vector<int>              m_reuseport_fds;
+  std::vector< std::unique_ptr<std::thread> > m_accept_threads;
+  uint32_t                      m_sweep_timer;
+  std::unique_ptr<std::thread>  m_reconnect_thread;
+  std::deque< std::weak_ptr<rtRemoteClient> > m_reconnect_queue;
+  std::mutex                    m_reconnect_mutex;
+  std::condition_variable       m_reconnect_cond;
+  bool                          m_reconnect_stopped;
   mutable std::mutex            m_mutex;
   CommandHandlerMap             m_command_handlers;
 
-  rtRemoteIResolver*            m_resolver;
+  rtRemoteLocateCache*          m_resolver;
+  std::set<std::string>         m_registered_objects;
   ClientMap                     m_object_map;
+  PendingConnectMap             m_pending_connects;
+  std::condition_variable       m_connect_cond;
   ClientList                    m_connected_clients;
   ClientDisconnectedCBMap       m_disconnected_callback_map;
   int                           m_shutdown_pipe[2];
   uint32_t                      m_keep_alive_interval;
+  uint32_t                      m_pool_size;
+  rtRemoteSocketOptions         m_socket_options;
   rtRemoteEnvironment*          m_env;
 };
 
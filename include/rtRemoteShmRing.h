@@ -0,0 +1,95 @@
+/*
+
+pxCore Copyright 2005-2018 John Robinson
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+*/
+
+#ifndef __RT_REMOTE_SHM_RING_H__
+#define __RT_REMOTE_SHM_RING_H__
+
+#include <rtError.h>
+
+#include <memory>
+#include <stdint.h>
+#include <sys/uio.h>
+
+// Single producer, single consumer byte ring in shared memory. The memory
+// comes from a memfd and wakeups go through two eventfds, one for data and
+// one for space, so all of them can be handed to a peer over a unix socket.
+// The peer can write the mapping at any time, so only Head and Tail are
+// read from it, and only after checking them against our own copy of the
+// size. Linux only.
+class rtRemoteShmRing
+{
+public:
+  ~rtRemoteShmRing();
+
+  rtRemoteShmRing(rtRemoteShmRing const&) = delete;
+  rtRemoteShmRing& operator = (rtRemoteShmRing const&) = delete;
+
+  static rtError create(uint32_t size, std::unique_ptr<rtRemoteShmRing>& ring);
+
+  // takes ownership of all descriptors, even on failure
+  static rtError attach(int memFd, int eventFd, int spaceFd, std::unique_ptr<rtRemoteShmRing>& ring);
+
+  // producer. Copies all of iov into the ring, waiting for the consumer
+  // to make room if needed. On failure part of iov may already be in the
+  // ring, so the caller has to give up on the ring.
+  rtError write(iovec const* iov, int n, uint32_t timeoutMillis);
+
+  // consumer. Blocks until exactly n bytes have been read.
+  rtError read(char* buff, uint32_t n, uint32_t timeoutMillis);
+
+  bool isEmpty() const;
+
+  // consumer. Bytes that can be read without waiting.
+  uint32_t available() const;
+
+  // consumer. Resets the wakeup counter before draining the ring.
+  void clearSignal();
+
+  // marks the ring closed so a peer blocked in read() or write() gives up
+  void close();
+
+  inline int memFd() const
+    { return m_mem_fd; }
+
+  inline int eventFd() const
+    { return m_event_fd; }
+
+  inline int spaceFd() const
+    { return m_space_fd; }
+
+private:
+  struct Header;
+
+  rtRemoteShmRing(int memFd, int eventFd, int spaceFd, void* base, size_t mappedSize);
+
+  static void signal(int fd);
+  static void drain(int fd);
+  static bool waitFor(int fd, int timeoutMillis);
+
+  int       m_mem_fd;
+  int       m_event_fd;
+  int       m_space_fd;
+  void*     m_base;
+  size_t    m_mapped_size;
+  Header*   m_header;
+  char*     m_data;
+  uint32_t  m_size;   // fixed at create/attach, never re-read from the mapping
+  uint32_t  m_index;  // our own side, Head for the producer and Tail for the consumer
+};
+
+#endif
@@ -20,10 +20,12 @@ limitations under the License.
 #define __RT_REMOTE_SOCKET_UTILS_H__
 
 #include <sys/socket.h>
+#include <sys/uio.h>
 #include <sys/un.h>
 #include <netinet/in.h>
 #include <netinet/tcp.h>
 #include <rtError.h>
+#include <functional>
 #include <memory>
 #include <string>
 #include <vector>
@@ -36,26 +38,106 @@ limitations under the License.
 #endif
 
 #define kInvalidSocket (-1)
-#define kUnixSocketTemplateRoot "/tmp/rt_remote_soc"
+
+class rtRemoteConfig;
+#define kUnixSocketNamePrefix "rt_remote_soc."
+
+// who is at the other end of a unix socket, as the kernel recorded it when
+// the connection was made
+struct rtRemotePeerCredentials
+{
+  pid_t pid;
+  uid_t uid;
+  gid_t gid;
+};
+
+// Tuning for rpc stream sockets, read from the rt.rpc.stream.* settings.
+// Zero or false leaves the kernel default. The TCP ones are skipped on
+// unix sockets.
+struct rtRemoteSocketOptions
+{
+  bool      NoDelay;
+  int       SendBufferSize;
+  int       ReceiveBufferSize;
+  bool      QuickAck;
+  int       BusyPollUsec;
+  bool      KeepAlive;
+  int       KeepAliveIdle;
+  int       KeepAliveInterval;
+  int       KeepAliveCount;
+  uint32_t  UserTimeout;
+
+  static rtRemoteSocketOptions fromConfig(rtRemoteConfig const& conf);
+};
 
 rtError rtParseAddress(sockaddr_storage& ss, char const* addr, uint16_t port, uint32_t* index);
 rtError rtParseAddress(sockaddr_storage& ss, char const* s);
+
+// the endpoint in the ip and port fields of a message, or of an object
+// inside one. Fails if either is missing or of the wrong type.
+rtError rtMessage_GetEndpoint(rapidjson::Value const& doc, sockaddr_storage& ss);
 rtError rtSocketGetLength(sockaddr_storage const& ss, socklen_t* len);
 rtError rtGetInterfaceAddress(char const* name, sockaddr_storage& ss);
 rtError rtGetInetAddr(sockaddr_storage const& ss, void** addr);
 rtError rtGetPort(sockaddr_storage const& ss, uint16_t* port);
 rtError rtPushFd(fd_set* fds, int fd, int* maxFd);
 rtError rtReadUntil(int fd, char* buff, int n);
-rtError rtReadMessage(int fd, rtRemoteSocketBuffer& buff, rtRemoteMessagePtr& doc);
+rtError rtReadMessage(int fd, rtRemoteSocketBuffer& buff, rtRemoteMessagePtr& doc,
+  uint32_t maxAttachmentSize, uint32_t maxFrameAttachmentBytes);
+
+// byte source and sink for framed messages, so the same framing can run
+// over something other than a socket
+using rtRemoteFrameReader = std::function<rtError (char* buff, uint32_t n)>;
+using rtRemoteFrameWriter = std::function<rtError (iovec* iov, int n)>;
+
+rtError rtReadFrame(rtRemoteFrameReader const& in, rtRemoteSocketBuffer& buff, rtRemoteMessagePtr& doc,
+  uint32_t maxAttachmentSize, uint32_t maxFrameAttachmentBytes);
+rtError rtWriteFrame(rtRemoteMessage const& m, rtRemoteFrameWriter const& out);
+
+// Looks at the first n bytes of a byte stream. Sets length to the size of
+// the first frame once all of it is there, or to zero if more is needed.
+// Fails if the frame is over either limit.
+rtError rtGetFrameLength(char const* p, uint32_t n, uint32_t maxMessageSize,
+  uint32_t maxFrameAttachmentBytes, uint32_t* length);
 rtError rtParseMessage(char const* buff, int n, rtRemoteMessagePtr& doc);
 std::string rtSocketToString(sockaddr_storage const& ss);
 
+// The textual path of a unix socket. Linux abstract names, which start with
+// a nul byte, are written with a leading '@' the way ss(8) shows them.
+// rtParseAddress reads the same form back.
+std::string rtUnixSocketPath(sockaddr_storage const& ss);
+
+// The address without the port: the numeric ip, or the unix socket path as
+// rtUnixSocketPath writes it. rtParseAddress(ss, addr, port, index) reads
+// either back.
+std::string rtSocketAddressToString(sockaddr_storage const& ss);
+
 // this really doesn't belong here, but putting it here for now
-rtError rtSendDocument(rtRemoteMessage const& m, int fd, sockaddr_storage const* dest);
+rtError rtSendDocument(rapidjson::Document const& doc, int fd, sockaddr_storage const* dest);
+rtError rtSendMessage(rtRemoteMessage const& m, int fd, int const* fds = nullptr, int numFds = 0);
 rtError rtGetPeerName(int fd, sockaddr_storage& endpoint);
 rtError rtGetSockName(int fd, sockaddr_storage& endpoint);
 rtError	rtCloseSocket(int& fd);
 rtError rtGetDefaultInterface(sockaddr_storage& addr, uint16_t port);
-rtError rtCreateUnixSocketName(pid_t pid, char* buff, int n);
+rtError rtCreateUnixSocketName(char const* dir, pid_t pid, char* buff, int n);
+rtError rtCreateAbstractSocketName(pid_t pid, char* buff, int n);
+rtError rtGetPeerCredentials(int fd, rtRemotePeerCredentials& creds);
+
+// Sets opts on fd. A failed option is logged and the rest are still tried.
+rtError rtApplySocketOptions(int fd, int family, rtRemoteSocketOptions const& opts);
+
+// Creates dir for unix sockets, sticky and world writable. An existing one
+// must be a directory, not a symlink, owned by us or root, and either mode
+// 01777 or closed to group and other.
+rtError rtCreateSocketDirectory(char const* dir);
+
+// Connects to the first of endpoints that answers within timeout. The next
+// endpoint is tried every stagger ms, or as soon as one fails, while the
+// earlier attempts keep going. On success fd is a connected blocking
+// socket and index, if given, says which endpoint it is. opts, if given,
+// are set on each socket before it connects so buffer sizes count for the
+// handshake.
+rtError rtConnectSocket(std::vector<sockaddr_storage> const& endpoints, uint32_t timeout,
+  uint32_t stagger, int& fd, size_t* index = nullptr, rtRemoteSocketOptions const* opts = nullptr);
 
 #endif
@@ -23,12 +23,14 @@ limitations under the License.
 #include "rtRemoteSocketUtils.h"
 #include "rtRemoteAsyncHandle.h"
 #include "rtRemoteCallback.h"
+#include "rtRemoteShmRing.h"
 
 #include <deque>
 #include <map>
 #include <memory>
 #include <mutex>
 #include <thread>
+#include <vector>
 
 class rtRemoteStreamSelector;
 
@@ -63,9 +65,18 @@ public:
 
   rtError open();
   rtError close();
-  rtError connect();
-  rtError connectTo(sockaddr_storage const& endpoint);
+  rtError connect(uint32_t timeout);
+
+  // races the endpoints and keeps the first that connects, see rtConnectSocket
+  rtError connectTo(std::vector<sockaddr_storage> const& endpoints, uint32_t timeout);
   rtError send(rtRemoteMessagePtr const& msg);
+
+  // moves traffic for a same host peer onto a pair of shared memory rings.
+  // Call on a connected unix stream before open(). On failure the stream
+  // keeps using the socket, and peers that refused or didn't answer in
+  // time aren't asked again for rt.rpc.stream.shm_retry_ms. A reply that
+  // comes in late is still honored.
+  rtError openSharedMemory(uint32_t ringSize, uint32_t timeout);
   rtRemoteAsyncHandle sendWithWait(rtRemoteMessagePtr const& msg, rtRemoteCorrelationKey k);
 
   rtError setCallbackHandler(std::shared_ptr<CallbackHandler> const& callbackHandler);
@@ -79,9 +90,23 @@ public:
   inline sockaddr_storage getRemoteEndpoint() const
     { return m_remote_endpoint; }
 
+  // false unless this is a connected unix stream
+  inline bool getPeerCredentials(rtRemotePeerCredentials& creds) const
+  {
+    if (!m_has_peer_credentials)
+      return false;
+    creds = m_peer_credentials;
+    return true;
+  }
+
 private:
   rtError onIncomingMessage(rtRemoteSocketBuffer& buff);
+  rtError onIncomingSharedMemory(rtRemoteSocketBuffer& buff);
+  rtError onSharedMemoryRequest(rtRemoteMessagePtr const& req);
+  rtError onLateSharedMemoryResponse(rtRemoteMessagePtr const& res);
   rtError onInactivity();
+  rtError drainSocket(rtRemoteSocketBuffer& buff);
+  void readPeerCredentials();
 
 private:
   int                                   m_fd;
@@ -89,6 +114,17 @@ private:
   sockaddr_storage                      m_local_endpoint;
   sockaddr_storage                      m_remote_endpoint;
   rtRemoteEnvironment*                  m_env;
+  rtRemotePeerCredentials               m_peer_credentials;
+  bool                                  m_has_peer_credentials;
+  bool                                  m_quick_ack;
+  std::mutex                            m_send_mutex;
+  std::unique_ptr<rtRemoteShmRing>      m_shm_tx; // guarded by m_send_mutex
+  std::unique_ptr<rtRemoteShmRing>      m_shm_rx; // read on the selector thread only
+  std::unique_ptr<rtRemoteShmRing>      m_shm_pending_tx; // offered, no reply yet
+  std::unique_ptr<rtRemoteShmRing>      m_shm_pending_rx;
+  rtRemoteCorrelationKey                m_shm_pending_key;
+  std::vector<char>                     m_shm_rx_buff; // start of a frame still arriving
+  bool                                  m_shm_rx_started; // socket drained after switching
 };
 
 #endif
@@ -20,6 +20,7 @@ limitations under the License.
 #define __RT_REMOTE_STREAM_SELECTOR_H__
 
 #include "rtError.h"
+#include "rtRemoteTimerService.h"
 
 #include <memory>
 #include <mutex>
@@ -42,6 +43,7 @@ public:
 private:
   static void* pollFds(void* argp);
   rtError doPollFds();
+  void sendKeepAlives();
 
 private:
   // TODO: should this be std::weak_ptr
@@ -52,6 +54,7 @@ private:
   int                                             m_shutdown_pipe[2];
   rtRemoteEnvironment*                            m_env;
   bool                                            m_running;
+  rtRemoteTimerService::TimerId                   m_keep_alive_timer;
 };
 
 #endif
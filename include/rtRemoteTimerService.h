@@ -0,0 +1,81 @@
+/*
+
+pxCore Copyright 2005-2018 John Robinson
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+*/
+
+#ifndef __RT_REMOTE_TIMER_SERVICE_H__
+#define __RT_REMOTE_TIMER_SERVICE_H__
+
+#include "rtError.h"
+
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <stdint.h>
+#include <thread>
+#include <utility>
+
+// One thread that runs housekeeping on a schedule: stale object sweeps,
+// keep-alives and the like. Keeps that work off the accept and I/O
+// threads. Callbacks run one at a time and should be short.
+class rtRemoteTimerService
+{
+public:
+  using TimerId = uint32_t;
+  using Callback = std::function<void ()>;
+
+  rtRemoteTimerService();
+  ~rtRemoteTimerService();
+
+  rtError start();
+  rtError shutdown();
+
+  // runs func after interval, and every interval after that if periodic.
+  // returns 0 if the service isn't running
+  TimerId schedule(std::chrono::milliseconds interval, Callback const& func, bool periodic = true);
+
+  // once this returns func is not running and won't run again, unless
+  // called from func itself
+  void cancel(TimerId id);
+
+private:
+  using Clock = std::chrono::steady_clock;
+
+  struct Timer
+  {
+    Clock::time_point         Due;
+    std::chrono::milliseconds Interval;
+    bool                      Periodic;
+    Callback                  Func;
+  };
+
+  void run();
+
+  std::map<TimerId, Timer>                     m_timers;
+  std::set< std::pair<Clock::time_point, TimerId> > m_due;
+  std::mutex                                   m_mutex;
+  std::condition_variable                      m_cond;
+  std::unique_ptr<std::thread>                 m_thread;
+  TimerId                                      m_next_id;
+  TimerId                                      m_current;
+  bool                                         m_running;
+};
+
+#endif
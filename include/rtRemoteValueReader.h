@@ -26,12 +26,15 @@ limitations under the License.
 
 class rtRemoteClient;
 class rtRemoteEnvironment;
+class rtRemoteMessage;
 
 class rtRemoteValueReader
 {
 public:
+  // parent is the message that from belongs to. It holds any attachments
+  // the value refers to.
   static rtError read(rtRemoteEnvironment* env, rtValue& val, rapidjson::Value const& from,
-    std::shared_ptr<rtRemoteClient> const& client);
+    rtRemoteMessage const& parent, std::shared_ptr<rtRemoteClient> const& client);
 };
 
 #endif
@@ -25,13 +25,17 @@ limitations under the License.
 #include <rapidjson/document.h>
 
 class rtRemoteEnvironment;
-
+class rtRemoteMessage;
 
 class rtRemoteValueWriter
 {
 public:
+  // strings of rt.rpc.stream.attachment_threshold bytes or more, and
+  // rtRemoteBuffer values, are added to parent as attachments rather than
+  // written into the DOM. The threshold is 0, off, by default since older
+  // peers can't read frames with attachments.
   static rtError write(rtRemoteEnvironment* env,
-    rtValue const& from, rapidjson::Value& to, rapidjson::Document& parent);
+    rtValue const& from, rapidjson::Value& to, rtRemoteMessage& parent);
 };
 
 #endif
@@ -0,0 +1,76 @@
+/*
+
+pxCore Copyright 2005-2018 John Robinson
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+*/
+
+// Name service daemon for the "unicast" resolver. Listens on
+// rt.rpc.resolver.unicast.address/port until SIGINT or SIGTERM.
+//
+//   rtNameService [-c rtremote.conf]
+
+#include "rtRemote.h"
+#include "rtRemoteConfig.h"
+#include "rtRemoteEnvironment.h"
+#include "rtRemoteNameService.h"
+
+#include <rtLog.h>
+
+#include <getopt.h>
+#include <signal.h>
+#include <stdio.h>
+
+int main(int argc, char* argv[])
+{
+  char const* configFile = nullptr;
+
+  while (true)
+  {
+    int c = getopt(argc, argv, "c:");
+    if (c == -1)
+      break;
+    if (c == 'c')
+      configFile = optarg;
+  }
+
+  // block before any thread starts so only sigwait sees them
+  sigset_t signals;
+  sigemptyset(&signals);
+  sigaddset(&signals, SIGINT);
+  sigaddset(&signals, SIGTERM);
+  pthread_sigmask(SIG_BLOCK, &signals, nullptr);
+
+  rtRemoteEnvironment* env = configFile
+    ? rtEnvironmentFromFile(configFile)
+    : rtEnvironmentGetGlobal();
+
+  rtRemoteNameService ns(env);
+  rtError e = ns.init();
+  if (e != RT_OK)
+  {
+    rtLogError("failed to start name service. %s", rtStrError(e));
+    return 1;
+  }
+
+  rtLogInfo("name service running on %s:%d", env->Config->resolver_unicast_address().c_str(),
+    env->Config->resolver_unicast_port());
+
+  int sig = 0;
+  sigwait(&signals, &sig);
+  rtLogInfo("got signal %d, shutting down", sig);
+
+  ns.close();
+  return 0;
+}
@@ -29,7 +29,9 @@ limitations under the License.
 
 #include <chrono>
 #include <mutex>
+#include <string>
 #include <thread>
+#include <vector>
 
 
 #include <rtLog.h>
@@ -138,6 +140,32 @@ rtRemoteLocateObject(rtRemoteEnvironment* env, char const* id, rtObjectRef& obj,
   return env->Server->findObject(id, obj, timeout, cb, cbdata);
 }
 
+rtError
+rtRemoteLocateObjects(rtRemoteEnvironment* env, char const* const* ids, rtObjectRef* objs, int count,
+        int timeout, remoteDisconnectedCallback cb, void *cbdata)
+{
+  if (env == nullptr)
+    return RT_ERROR_INVALID_ARG;
+
+  if (count < 0 || (count > 0 && (ids == nullptr || objs == nullptr)))
+    return RT_ERROR_INVALID_ARG;
+
+  std::vector<std::string> objectIds;
+  objectIds.reserve(count);
+  for (int i = 0; i < count; ++i)
+  {
+    if (ids[i] == nullptr)
+      return RT_ERROR_INVALID_ARG;
+    objectIds.push_back(ids[i]);
+  }
+
+  std::vector<rtObjectRef> refs;
+  rtError e = env->Server->findObjects(objectIds, refs, timeout, cb, cbdata);
+  for (int i = 0; i < count; ++i)
+    objs[i] = refs[i];
+  return e;
+}
+
 rtError
 rtRemoteUnregisterDisconnectedCallback( rtRemoteEnvironment* env, remoteDisconnectedCallback cb, void *cbdata )
 {
@@ -0,0 +1,93 @@
+/*
+
+pxCore Copyright 2005-2018 John Robinson
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+*/
+
+#include "rtRemoteBuffer.h"
+#include "rtError.h"
+
+#include <string.h>
+#include <vector>
+
+rtRemoteBuffer::rtRemoteBuffer(void const* data, uint32_t length)
+  : m_ref_count(0)
+  , m_data(nullptr)
+  , m_length(length)
+{
+  std::shared_ptr<std::vector<char>> copy(new std::vector<char>(length));
+  if (length > 0)
+    memcpy(&(*copy)[0], data, length);
+  m_data = copy->empty() ? nullptr : &(*copy)[0];
+  m_owner = copy;
+}
+
+rtRemoteBuffer::rtRemoteBuffer(std::shared_ptr<void> const& owner, char const* data, uint32_t length)
+  : m_ref_count(0)
+  , m_owner(owner)
+  , m_data(data)
+  , m_length(length)
+{
+}
+
+rtRemoteBuffer::~rtRemoteBuffer()
+{
+}
+
+rtError
+rtRemoteBuffer::Get(char const* name, rtValue* value) const
+{
+  if (name == nullptr || value == nullptr)
+    return RT_ERROR_INVALID_ARG;
+
+  if (strcmp(name, "length") != 0)
+    return RT_PROPERTY_NOT_FOUND;
+
+  value->setUInt32(m_length);
+  return RT_OK;
+}
+
+rtError
+rtRemoteBuffer::Get(uint32_t /*index*/, rtValue* /*value*/) const
+{
+  return RT_PROPERTY_NOT_FOUND;
+}
+
+rtError
+rtRemoteBuffer::Set(char const* /*name*/, rtValue const* /*value*/)
+{
+  return RT_ERROR_INVALID_OPERATION;
+}
+
+rtError
+rtRemoteBuffer::Set(uint32_t /*index*/, rtValue const* /*value*/)
+{
+  return RT_ERROR_INVALID_OPERATION;
+}
+
+rtObject::refcount_t
+rtRemoteBuffer::AddRef()
+{
+  return rtAtomicInc(&m_ref_count);
+}
+
+rtObject::refcount_t
+rtRemoteBuffer::Release()
+{
+  refcount_t n = rtAtomicDec(&m_ref_count);
+  if (n == 0)
+    delete this;
+  return n;
+}
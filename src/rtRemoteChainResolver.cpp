@@ -0,0 +1,241 @@
+/*
+
+pxCore Copyright 2005-2018 John Robinson
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+*/
+
+#include "rtRemoteChainResolver.h"
+#include "rtRemoteConfig.h"
+#include "rtRemoteEnvironment.h"
+#include "rtRemoteFactory.h"
+
+#include <chrono>
+#include <sstream>
+
+#include <rtLog.h>
+
+using std::chrono::steady_clock;
+
+namespace
+{
+  // the later stages still get a share of what is left if an earlier one
+  // sits on the whole timeout
+  uint32_t
+  stageTimeout(steady_clock::time_point deadline, size_t stagesLeft)
+  {
+    using namespace std::chrono;
+    auto remaining = duration_cast<milliseconds>(deadline - steady_clock::now()).count();
+    if (remaining <= 0)
+      return 0;
+    return static_cast<uint32_t>(remaining / static_cast<int64_t>(stagesLeft));
+  }
+}
+
+rtRemoteChainResolver::rtRemoteChainResolver(rtRemoteEnvironment* env)
+  : m_env(env)
+{
+  std::stringstream chain(m_env->Config->resolver_chain());
+  std::string name;
+  while (std::getline(chain, name, ','))
+  {
+    name.erase(0, name.find_first_not_of(" \t"));
+    name.erase(name.find_last_not_of(" \t") + 1);
+    if (name.empty())
+      continue;
+
+    if (name == "chain")
+    {
+      rtLogWarn("ignoring chain resolver inside resolver chain");
+      continue;
+    }
+
+    rtRemoteIResolver* resolver = rtRemoteFactory::rtRemoteCreateResolver(m_env, name);
+    if (!resolver)
+    {
+      rtLogWarn("ignoring unknown resolver '%s' in resolver chain", name.c_str());
+      continue;
+    }
+
+    Stage stage;
+    stage.Name = name;
+    stage.Resolver.reset(resolver);
+    m_stages.push_back(std::move(stage));
+  }
+}
+
+rtRemoteChainResolver::~rtRemoteChainResolver()
+{
+}
+
+rtError
+rtRemoteChainResolver::open(sockaddr_storage const& rpc_endpoint)
+{
+  // a resolver that can't start (no name service, no multicast route) is
+  // left out rather than failing everything else
+  for (auto itr = m_stages.begin(); itr != m_stages.end();)
+  {
+    rtError e = itr->Resolver->open(rpc_endpoint);
+    if (e != RT_OK)
+    {
+      rtLogWarn("dropping %s resolver from chain. %s", itr->Name.c_str(), rtStrError(e));
+      itr = m_stages.erase(itr);
+    }
+    else
+    {
+      rtLogInfo("resolver chain: %s", itr->Name.c_str());
+      ++itr;
+    }
+  }
+
+  if (m_stages.empty())
+  {
+    rtLogError("no usable resolvers in chain '%s'", m_env->Config->resolver_chain().c_str());
+    return RT_FAIL;
+  }
+  return RT_OK;
+}
+
+rtError
+rtRemoteChainResolver::close()
+{
+  for (Stage& stage : m_stages)
+    stage.Resolver->close();
+
+  std::unique_lock<std::mutex> lock(m_mutex);
+  m_local_objects.clear();
+  return RT_OK;
+}
+
+rtError
+rtRemoteChainResolver::registerObject(std::string const& name, sockaddr_storage const& endpoint)
+{
+  {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_local_objects[name] = endpoint;
+  }
+
+  // good enough if anyone can find it
+  rtError result = RT_FAIL;
+  for (Stage& stage : m_stages)
+  {
+    rtError e = stage.Resolver->registerObject(name, endpoint);
+    if (e == RT_OK)
+      result = RT_OK;
+    else
+      rtLogWarn("%s resolver failed to register %s. %s", stage.Name.c_str(), name.c_str(), rtStrError(e));
+  }
+  return result;
+}
+
+rtError
+rtRemoteChainResolver::unregisterObject(std::string const& name)
+{
+  {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_local_objects.erase(name);
+  }
+
+  rtError result = RT_OK;
+  for (Stage& stage : m_stages)
+  {
+    rtError e = stage.Resolver->unregisterObject(name);
+    if (e != RT_OK)
+      result = e;
+  }
+  return result;
+}
+
+rtError
+rtRemoteChainResolver::locateObject(std::string const& name, sockaddr_storage& endpoint,
+  uint32_t timeout)
+{
+  {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    auto itr = m_local_objects.find(name);
+    if (itr != m_local_objects.end())
+    {
+      endpoint = itr->second;
+      return RT_OK;
+    }
+  }
+
+  auto const deadline = steady_clock::now() + std::chrono::milliseconds(timeout);
+
+  // a stage that fails just passes the name on to the next one. it's only
+  // not found if every stage says so, since one that timed out can't.
+  rtError result = RT_RESOURCE_NOT_FOUND;
+  for (size_t i = 0; i < m_stages.size(); ++i)
+  {
+    sockaddr_storage found;
+    rtError e = m_stages[i].Resolver->locateObject(name, found, stageTimeout(deadline, m_stages.size() - i));
+    if (e == RT_OK)
+    {
+      rtLogDebug("%s found by %s resolver", name.c_str(), m_stages[i].Name.c_str());
+      endpoint = found;
+      return RT_OK;
+    }
+    if (e != RT_RESOURCE_NOT_FOUND)
+    {
+      rtLogDebug("%s resolver failed to locate %s. %s", m_stages[i].Name.c_str(), name.c_str(), rtStrError(e));
+      if (result == RT_RESOURCE_NOT_FOUND)
+        result = e;
+    }
+  }
+  return result;
+}
+
+rtError
+rtRemoteChainResolver::locateObjects(std::vector<std::string> const& names,
+  std::map<std::string, sockaddr_storage>& endpoints, uint32_t timeout)
+{
+  std::vector<std::string> remaining;
+  {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    for (std::string const& name : names)
+    {
+      auto itr = m_local_objects.find(name);
+      if (itr != m_local_objects.end())
+        endpoints[name] = itr->second;
+      else
+        remaining.push_back(name);
+    }
+  }
+
+  auto const deadline = steady_clock::now() + std::chrono::milliseconds(timeout);
+
+  // each stage only gets asked for what the ones before it couldn't find
+  rtError result = RT_RESOURCE_NOT_FOUND;
+  for (size_t i = 0; i < m_stages.size() && !remaining.empty(); ++i)
+  {
+    rtError e = m_stages[i].Resolver->locateObjects(remaining, endpoints,
+      stageTimeout(deadline, m_stages.size() - i));
+    if (e != RT_OK && e != RT_RESOURCE_NOT_FOUND)
+    {
+      rtLogDebug("%s resolver failed some lookups. %s", m_stages[i].Name.c_str(), rtStrError(e));
+      if (result == RT_RESOURCE_NOT_FOUND)
+        result = e;
+    }
+
+    std::vector<std::string> missing;
+    for (std::string const& name : remaining)
+    {
+      if (endpoints.find(name) == endpoints.end())
+        missing.push_back(name);
+    }
+    remaining.swap(missing);
+  }
+
+  return remaining.empty() ? RT_OK : result;
+}
@@ -24,6 +24,8 @@ limitations under the License.
 #include "rtRemoteValueWriter.h"
 #include "rtRemoteConfig.h"
 #include "rtRemoteEnvironment.h"
+#include "rtRemoteServer.h"
+#include "rtRemoteTimerService.h"
 
 #include "rapidjson/rapidjson.h"
 
@@ -36,10 +38,18 @@ limitations under the License.
 #include <errno.h>
 
 #include <algorithm>
+#include <chrono>
 #include <rapidjson/document.h>
 
 namespace
 {
+  // see rtRemoteEnvironment::newObjectId
+  bool
+  isGeneratedObjectId(std::string const& id)
+  {
+    return id.compare(0, 6, "obj://") == 0 || id.compare(0, 7, "func://") == 0;
+  }
+
   void
   addValue(rtRemoteMessagePtr& doc, rtRemoteEnvironment* env, rtValue const& value)
   {
@@ -79,15 +89,36 @@ rtRemoteClient::rtRemoteClient(rtRemoteEnvironment* env, int fd,
   sockaddr_storage const& local_endpoint, sockaddr_storage const& remoteEndpoint)
   : m_stream(new rtRemoteStream(env, fd, local_endpoint, remoteEndpoint))
   , m_env(env)
+  , m_outbound(false)
+  , m_reconnect_attempts(0)
+  , m_reconnect_delay(0)
+  , m_session_open(sessionOpenMode(env))
 {
 }
 
 rtRemoteClient::rtRemoteClient(rtRemoteEnvironment* env, sockaddr_storage const& remoteEndpoint)
   : m_stream(new rtRemoteStream(env, -1, sockaddr_storage(), remoteEndpoint))
   , m_env(env)
+  , m_outbound(true)
+  , m_reconnect_attempts(0)
+  , m_reconnect_delay(0)
+  , m_session_open(sessionOpenMode(env))
 {
 }
 
+rtRemoteClient::SessionOpen
+rtRemoteClient::sessionOpenMode(rtRemoteEnvironment* env)
+{
+  std::string const mode = env->Config->client_session_open();
+  if (mode == "pipeline")
+    return SessionOpen::Pipeline;
+  if (mode == "skip")
+    return SessionOpen::Skip;
+  if (mode != "wait")
+    rtLogWarn("unknown rt.rpc.client.session_open '%s', using 'wait'", mode.c_str());
+  return SessionOpen::Wait;
+}
+
 rtRemoteClient::~rtRemoteClient()
 {
   std::unique_lock<std::recursive_mutex> lock(m_mutex);
@@ -128,19 +159,25 @@ rtRemoteClient::onStateChanged(std::shared_ptr<rtRemoteStream> const& /*stream*/
   {
     rtLogInfo("stream closed");
     std::unique_lock<std::recursive_mutex> lock(m_mutex);
-    if (m_state_changed_handler.Func)
-    {
-      auto self = shared_from_this();
-      rtError e = m_state_changed_handler.Func(self, State::Shutdown, m_state_changed_handler.Arg);
-      if (e != RT_OK)
-        rtLogWarn("failed to invoke state changed handler. %s", rtStrError(e));
-    }
+
+    // only connections we opened, and only if there are proxies to save
+    bool const reconnecting = m_outbound && !m_objects.empty()
+      && m_env->Config->client_reconnect();
+
+    notifyStateChanged(reconnecting ? State::Reconnecting : State::Shutdown);
 
     if (m_stream)
     {
       m_stream->close();
       m_stream.reset();
     }
+
+    if (reconnecting)
+    {
+      m_reconnect_attempts = 0;
+      m_reconnect_delay = m_env->Config->client_reconnect_initial_ms();
+      scheduleReconnect();
+    }
   }
   else if (state == rtRemoteStream::State::Inactive)
   {
@@ -153,6 +190,157 @@ rtRemoteClient::onStateChanged(std::shared_ptr<rtRemoteStream> const& /*stream*/
   return RT_OK;
 }
 
+void
+rtRemoteClient::notifyStateChanged(State state)
+{
+  std::unique_lock<std::recursive_mutex> lock(m_mutex);
+  if (m_state_changed_handler.Func)
+  {
+    auto self = shared_from_this();
+    rtError e = m_state_changed_handler.Func(self, state, m_state_changed_handler.Arg);
+    if (e != RT_OK)
+      rtLogWarn("failed to invoke state changed handler. %s", rtStrError(e));
+  }
+}
+
+void
+rtRemoteClient::scheduleReconnect()
+{
+  // the timer only waits out the backoff, the work is done on the server's
+  // reconnect thread
+  std::weak_ptr<rtRemoteClient> weakSelf = shared_from_this();
+  rtRemoteEnvironment* env = m_env;
+  env->Timers->schedule(std::chrono::milliseconds(m_reconnect_delay), [weakSelf, env]
+  {
+    std::shared_ptr<rtRemoteClient> self = weakSelf.lock();
+    if (self && env->Server)
+      env->Server->queueReconnect(self);
+  }, false);
+}
+
+void
+rtRemoteClient::runReconnect(rtRemoteServer* server)
+{
+  rtError e = reconnect(server);
+  if (e == RT_OK)
+    return;
+
+  std::unique_lock<std::recursive_mutex> lock(m_mutex);
+  if (++m_reconnect_attempts >= m_env->Config->client_reconnect_attempts())
+  {
+    rtLogWarn("giving up reconnecting after %u attempts", m_reconnect_attempts);
+    notifyStateChanged(State::Shutdown);
+    return;
+  }
+
+  m_reconnect_delay = std::min(m_reconnect_delay * 2, m_env->Config->client_reconnect_max_ms());
+  scheduleReconnect();
+}
+
+// The peer may have come back somewhere else (new port, new unix socket),
+// so the endpoint is looked up again. The proxies keep pointing at this
+// client and only the stream underneath them is replaced.
+rtError
+rtRemoteClient::reconnect(rtRemoteServer* server)
+{
+  std::vector<std::string> objects;
+  std::vector<std::string> located;
+  {
+    std::unique_lock<std::recursive_mutex> lock(m_mutex);
+    objects = m_objects;
+    located = m_located;
+  }
+
+  // every proxy registers its id, so the same one shows up many times
+  std::sort(objects.begin(), objects.end());
+  objects.erase(std::unique(objects.begin(), objects.end()), objects.end());
+  if (objects.empty())
+    return RT_OK;
+
+  // names we located and still hold proxies for. Failing that, anything
+  // that isn't an id the peer made up for a returned object.
+  std::vector<std::string> names;
+  for (std::string const& name : located)
+  {
+    if (std::binary_search(objects.begin(), objects.end(), name))
+      names.push_back(name);
+  }
+  if (names.empty())
+  {
+    for (std::string const& id : objects)
+    {
+      if (!isGeneratedObjectId(id))
+        names.push_back(id);
+    }
+  }
+  if (names.empty())
+  {
+    rtLogInfo("reconnect: no object names to locate the peer with");
+    return RT_ERROR_OBJECT_NOT_FOUND;
+  }
+
+  uint32_t const timeout = m_env->Config->stream_connect_timeout_ms();
+  auto const deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeout);
+
+  sockaddr_storage endpoint;
+  rtError e = RT_ERROR_OBJECT_NOT_FOUND;
+  for (std::string const& name : names)
+  {
+    auto left = std::chrono::duration_cast<std::chrono::milliseconds>(
+      deadline - std::chrono::steady_clock::now()).count();
+    if (left <= 0)
+      break;
+
+    e = server->locateObject(name, endpoint, static_cast<uint32_t>(left));
+    if (e == RT_OK)
+      break;
+    rtLogInfo("reconnect: can't locate %s yet. %s", name.c_str(), rtStrError(e));
+  }
+  if (e != RT_OK)
+    return e;
+
+  std::shared_ptr<rtRemoteStream> s(new rtRemoteStream(m_env, -1, sockaddr_storage(), endpoint));
+  {
+    std::unique_lock<std::recursive_mutex> lock(m_mutex);
+    m_stream = s;
+  }
+  s->setCallbackHandler(shared_from_this());
+
+  e = connectRpcEndpoint(timeout);
+  if (e == RT_OK)
+    e = s->open();
+  if (e != RT_OK)
+  {
+    std::unique_lock<std::recursive_mutex> lock(m_mutex);
+    if (m_stream == s)
+      m_stream.reset();
+    s->close();
+    return e;
+  }
+
+  // ids the peer generated name objects of the old connection, there's no
+  // session to reopen for them
+  objects.erase(std::remove_if(objects.begin(), objects.end(), isGeneratedObjectId), objects.end());
+
+  rtLogInfo("reconnected to %s, reopening %d sessions", rtSocketToString(endpoint).c_str(),
+    static_cast<int>(objects.size()));
+
+  for (std::string const& id : objects)
+  {
+    rtError err = startSession(id);
+    if (err != RT_OK)
+      rtLogWarn("reconnect: failed to reopen session for %s. %s", id.c_str(), rtStrError(err));
+  }
+
+  // the server forgot our keep-alives with the old connection
+  e = sendKeepAlive();
+  if (e != RT_OK)
+    rtLogWarn("reconnect: failed to send keep alive. %s", rtStrError(e));
+
+  notifyStateChanged(State::Started);
+  return RT_OK;
+}
+
 rtError
 rtRemoteClient::setStateChangedHandler(StateChangedHandler handler, void* argp)
 {
@@ -163,12 +351,15 @@ rtRemoteClient::setStateChangedHandler(StateChangedHandler handler, void* argp)
 }
 
 rtError
-rtRemoteClient::open()
+rtRemoteClient::open(uint32_t timeout)
 {
   auto self = shared_from_this();
   m_stream->setCallbackHandler(self);
 
-  rtError err = connectRpcEndpoint();
+  if (timeout == 0)
+    timeout = m_env->Config->stream_connect_timeout_ms();
+
+  rtError err = connectRpcEndpoint(timeout);
   if (err != RT_OK)
   {
     rtLogWarn("failed to connect to rpc endpoint: %d", err);
@@ -189,31 +380,54 @@ rtRemoteClient::open()
 }
 
 rtError
-rtRemoteClient::connectRpcEndpoint()
+rtRemoteClient::connectRpcEndpoint(uint32_t timeout)
 {
   rtError e = RT_OK;
   std::shared_ptr<rtRemoteStream> s = getStream();
   if (!s)
     return RT_ERROR_STREAM_CLOSED;
   if (!s->isConnected())
-    e = s->connect();
+  {
+    e = s->connect(timeout);
+
+    // only the connecting side asks. The peer answers from its stream.
+    if (e == RT_OK && m_env->Config->stream_shm_enable()
+      && s->getRemoteEndpoint().ss_family == AF_UNIX)
+    {
+      rtError err = s->openSharedMemory(m_env->Config->stream_shm_ring_size(),
+        m_env->Config->stream_shm_open_timeout_ms());
+      if (err != RT_OK)
+        rtLogInfo("shared memory not available, staying on socket. %s", rtStrError(err));
+    }
+  }
   return e;
 }
 
 rtError
 rtRemoteClient::startSession(std::string const& objectId, uint32_t timeout)
 {
+  std::shared_ptr<rtRemoteStream> s = getStream();
+  if (!s)
+    return RT_ERROR_STREAM_CLOSED;
+
+  // the server keeps no state for a session. Skip only applies to same host
+  // peers the kernel vouched for, everyone else gets the request pipelined.
+  rtRemotePeerCredentials creds;
+  if (m_session_open == SessionOpen::Skip && s->getPeerCredentials(creds))
+    return RT_OK;
+
   rtRemoteCorrelationKey k = rtMessage_GetNextCorrelationKey();
 
-  rtRemoteMessagePtr req(new rapidjson::Document());
+  rtRemoteMessagePtr req(new rtRemoteMessage());
   req->SetObject();
   req->AddMember(kFieldNameMessageType, kMessageTypeOpenSessionRequest, req->GetAllocator());
   req->AddMember(kFieldNameCorrelationKey, k.toString(), req->GetAllocator());
   req->AddMember(kFieldNameObjectId, objectId, req->GetAllocator());
 
-  std::shared_ptr<rtRemoteStream> s = getStream();
-  if (!s)
-    return RT_ERROR_STREAM_CLOSED;
+  // goes out ahead of the first call on the same stream, so it's still
+  // handled first. The response is dropped by the server's handler.
+  if (m_session_open != SessionOpen::Wait)
+    return s->send(req);
 
   rtRemoteAsyncHandle handle = s->sendWithWait(req, k);
   rtError e = handle.waitUntil(timeout, [this] { return checkStream(); });
@@ -234,6 +448,14 @@ void rtRemoteClient::registerKeepAliveForObject(std::string const& s)
   m_objects.push_back(s);
 }
 
+void
+rtRemoteClient::addLocatedObject(std::string const& objectId)
+{
+  std::unique_lock<std::recursive_mutex> lock(m_mutex);
+  if (std::find(m_located.begin(), m_located.end(), objectId) == m_located.end())
+    m_located.push_back(objectId);
+}
+
 void rtRemoteClient::removeKeepAliveForObject(std::string const& s)
 {
   std::unique_lock<std::recursive_mutex> lock(m_mutex);
@@ -255,7 +477,7 @@ rtRemoteClient::sendKeepAlive()
   // we sent, and simply update the correlation key
   rtRemoteCorrelationKey k = rtMessage_GetNextCorrelationKey();
 
-  rtRemoteMessagePtr msg(new rapidjson::Document());
+  rtRemoteMessagePtr msg(new rtRemoteMessage());
   msg->SetObject();
   msg->AddMember(kFieldNameMessageType, kMessageTypeKeepAliveRequest, msg->GetAllocator());
   msg->AddMember(kFieldNameCorrelationKey,k.toString(), msg->GetAllocator());
@@ -287,7 +509,7 @@ rtRemoteClient::sendSet(std::string const& objectId, char const* propertyName, r
 {
   rtRemoteCorrelationKey k = rtMessage_GetNextCorrelationKey();
 
-  rtRemoteMessagePtr req(new rapidjson::Document());
+  rtRemoteMessagePtr req(new rtRemoteMessage());
   req->SetObject();
   req->AddMember(kFieldNameMessageType, kMessageTypeSetByNameRequest, req->GetAllocator());
   req->AddMember(kFieldNameObjectId, objectId, req->GetAllocator());
@@ -303,7 +525,7 @@ rtRemoteClient::sendSet(std::string const& objectId, uint32_t propertyIdx, rtVal
 {
   rtRemoteCorrelationKey k = rtMessage_GetNextCorrelationKey();
 
-  rtRemoteMessagePtr req(new rapidjson::Document());
+  rtRemoteMessagePtr req(new rtRemoteMessage());
   req->SetObject();
   req->AddMember(kFieldNameMessageType, kMessageTypeSetByIndexRequest, req->GetAllocator());
   req->AddMember(kFieldNameObjectId, objectId, req->GetAllocator());
@@ -343,7 +565,7 @@ rtRemoteClient::sendGet(std::string const& objectId, char const* propertyName, r
 {
   rtRemoteCorrelationKey k = rtMessage_GetNextCorrelationKey();
 
-  rtRemoteMessagePtr req(new rapidjson::Document());
+  rtRemoteMessagePtr req(new rtRemoteMessage());
   req->SetObject();
   req->AddMember(kFieldNameMessageType, kMessageTypeGetByNameRequest, req->GetAllocator());
   req->AddMember(kFieldNameObjectId, objectId, req->GetAllocator());
@@ -358,7 +580,7 @@ rtRemoteClient::sendGet(std::string const& objectId, uint32_t propertyIdx, rtVal
 {
   rtRemoteCorrelationKey k = rtMessage_GetNextCorrelationKey();
 
-  rtRemoteMessagePtr req(new rapidjson::Document());
+  rtRemoteMessagePtr req(new rtRemoteMessage());
   req->SetObject();
   req->AddMember(kFieldNameMessageType, kMessageTypeGetByNameRequest, req->GetAllocator());
   req->AddMember(kFieldNameObjectId, objectId, req->GetAllocator());
@@ -398,7 +620,7 @@ rtRemoteClient::sendGet(rtRemoteMessagePtr const& req, rtRemoteCorrelationKey k,
       return RT_ERROR_PROTOCOL_ERROR;
     }
 
-    e = rtRemoteValueReader::read(m_env, value, itr->value, shared_from_this());
+    e = rtRemoteValueReader::read(m_env, value, itr->value, *res, shared_from_this());
     if (e == RT_OK)
       e = rtMessage_GetStatusCode(*res);
   }
@@ -411,7 +633,7 @@ rtRemoteClient::sendCall(std::string const& objectId, std::string const& methodN
 {
   rtRemoteCorrelationKey k = rtMessage_GetNextCorrelationKey();
 
-  rtRemoteMessagePtr req(new rapidjson::Document());
+  rtRemoteMessagePtr req(new rtRemoteMessage());
   req->SetObject();
   req->AddMember(kFieldNameMessageType, kMessageTypeMethodCallRequest, req->GetAllocator());
   req->AddMember(kFieldNameObjectId, objectId, req->GetAllocator());
@@ -450,13 +672,20 @@ rtRemoteClient::sendCall(rtRemoteMessagePtr const& req, rtRemoteCorrelationKey k
       return RT_ERROR_PROTOCOL_ERROR;
     }
 
-    e = rtRemoteValueReader::read(m_env, result, itr->value, shared_from_this());
+    e = rtRemoteValueReader::read(m_env, result, itr->value, *res, shared_from_this());
     if (e == RT_OK)
       e = rtMessage_GetStatusCode(*res);
   }
   return e;
 }
 
+bool
+rtRemoteClient::getPeerCredentials(rtRemotePeerCredentials& creds) const
+{
+  std::unique_lock<std::recursive_mutex> lock(m_mutex);
+  return m_stream && m_stream->getPeerCredentials(creds);
+}
+
 sockaddr_storage
 rtRemoteClient::getRemoteEndpoint() const
 {
@@ -33,6 +33,7 @@ limitations under the License.
 #include <iostream>
 #include <limits>
 #include <memory>
+#include <set>
 #include <vector>
 
 static inline std::string& ltrim(std::string& s)
@@ -107,6 +108,30 @@ struct Setting
   char const* value;
 };
 
+// renamed settings. The old name is still read, with a warning, unless the
+// file sets the new one too.
+struct DeprecatedSetting
+{
+  char const* name;
+  char const* replacement;
+};
+
+static DeprecatedSetting const kDeprecatedSettings[] =
+{
+  { "rt.rpc.resolver.spin_iteration_ms", "rt.rpc.resolver.spin_max_ms" }
+};
+
+static char const*
+findReplacement(std::string const& name)
+{
+  for (DeprecatedSetting const& setting : kDeprecatedSettings)
+  {
+    if (name == setting.name)
+      return setting.replacement;
+  }
+  return nullptr;
+}
+
 rtRemoteConfigBuilder*
 rtRemoteConfigBuilder::getDefaultConfig()
 {
@@ -222,6 +247,9 @@ rtRemoteConfigBuilder::fromFile(char const* file)
 
   int line = 1;
 
+  // names the file sets itself, so a deprecated alias can't override them
+  std::set<std::string> names;
+
   char* p = nullptr;
   while ((p = fgets(&buff[0], static_cast<int>(buff.size()), f.get())) != nullptr)
   {
@@ -256,6 +284,19 @@ rtRemoteConfigBuilder::fromFile(char const* file)
     rtLogDebug("LINE:(%04d) '%s'", line++, p);
     rtLogDebug("'%s' == '%s'", name.c_str(), val.c_str());
 
+    char const* replacement = findReplacement(name);
+    if (replacement != nullptr)
+    {
+      rtLogWarn("%s: '%s' is deprecated, use '%s'", file, name.c_str(), replacement);
+      if (names.find(replacement) != names.end())
+        continue;
+      name = replacement;
+    }
+    else
+    {
+      names.insert(name);
+    }
+
     auto itr = builder->m_map.find(name);
     if (itr != builder->m_map.end())
     {
@@ -51,10 +51,7 @@ rtRemoteFileEndPoint::toSockAddr() const
 rtRemoteFileEndPoint*
 rtRemoteFileEndPoint::fromSockAddr(sockaddr_storage const& s)
 {
-  void* addr = nullptr;
-  rtGetInetAddr(s, &addr);
-
-  return new rtRemoteFileEndPoint("unix", reinterpret_cast<char const *>(addr));
+  return new rtRemoteFileEndPoint("unix", rtUnixSocketPath(s));
 }
 
 sockaddr_storage
@@ -20,20 +20,41 @@ limitations under the License.
 #include "rtRemoteConfig.h"
 #include "rtRemoteServer.h"
 #include "rtRemoteStreamSelector.h"
+#include "rtRemoteTimerService.h"
 #include "rtRemoteObjectCache.h"
+#include "rtGuid.h"
 #include "rtError.h"
 
+#include <inttypes.h>
+#include <stdio.h>
+
 rtRemoteEnvironment::rtRemoteEnvironment(rtRemoteConfig* config)
   : Config(config)
   , Server(nullptr)
   , ObjectCache(nullptr)
   , StreamSelector(nullptr)
+  , Timers(nullptr)
   , RefCount(1)
   , Initialized(false)
   , m_running(false)
   , m_queue_ready_handler(nullptr)
   , m_queue_ready_context(nullptr)
+  , m_next_object_id(1)
 {
+  // one uuid per environment, shortened. ids only need to be unique across
+  // the processes we talk to, the counter takes care of the rest.
+  std::string guid = rtGuid::newRandom().toString();
+  for (char c : guid)
+  {
+    if (c != '-')
+      m_object_id_prefix.push_back(c);
+    if (m_object_id_prefix.size() == 16)
+      break;
+  }
+
+  Timers = new rtRemoteTimerService();
+  Timers->start();
+
   StreamSelector = new rtRemoteStreamSelector(this);
   StreamSelector->start();
 
@@ -63,6 +84,20 @@ rtRemoteEnvironment::start()
   }
 }
 
+std::string
+rtRemoteEnvironment::newObjectId(char const* scheme)
+{
+  uint64_t n = m_next_object_id.fetch_add(1, std::memory_order_relaxed);
+
+  char buff[64];
+  int len = snprintf(buff, sizeof(buff), "%s%s.%" PRIx64, scheme, m_object_id_prefix.c_str(), n);
+  if (len < 0)
+    len = 0;
+  else if (len >= static_cast<int>(sizeof(buff)))
+    len = sizeof(buff) - 1;
+  return std::string(buff, len);
+}
+
 void
 rtRemoteEnvironment::processRunQueue()
 {
@@ -139,6 +174,11 @@ rtRemoteEnvironment::shutdown()
   for (auto& t : m_workers)
     t->join();
 
+  // stop the timer thread before anything its callbacks use goes away.
+  // cancel() and schedule() are still safe on a stopped service.
+  if (Timers)
+    Timers->shutdown();
+
   if (Server)
   {
     delete Server;
@@ -155,6 +195,13 @@ rtRemoteEnvironment::shutdown()
     StreamSelector = nullptr;
   }
 
+  // after everything that schedules timers is gone
+  if (Timers)
+  {
+    delete Timers;
+    Timers = nullptr;
+  }
+
   if (ObjectCache)
   {
     rtError e = ObjectCache->clear();
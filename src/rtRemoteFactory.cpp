@@ -19,28 +19,29 @@ limitations under the License.
 #include "rtRemoteFactory.h"
 #include "rtRemoteConfig.h"
 #include "rtRemoteIResolver.h"
+#include "rtRemoteChainResolver.h"
+#include "rtRemoteFileResolver.h"
 #include "rtRemoteMulticastResolver.h"
+#include "rtRemoteNsResolver.h"
 #include "rtRemoteTypes.h"
 #include "rtRemoteEnvironment.h"
 
-static rtResolverType
-rtResolverTypeFromString(std::string const& resolverType)
+static bool
+rtResolverTypeFromString(std::string const& resolverType, rtResolverType& t)
 {
   char const* s = resolverType.c_str();
 
-  rtResolverType t = RT_RESOLVER_MULTICAST;
-  if (s != nullptr)
-  {
-    if (strcasecmp(s, "multicast") == 0)
-      t = RT_RESOLVER_MULTICAST;
-    else if (strcasecmp(s, "file") == 0)
-      t = RT_RESOLVER_FILE;
-    else if (strcasecmp(s, "unicast") == 0)
-      t = RT_RESOLVER_UNICAST;
-    else
-      RT_ASSERT(false);
-  }
-  return t;
+  if (strcasecmp(s, "multicast") == 0)
+    t = RT_RESOLVER_MULTICAST;
+  else if (strcasecmp(s, "file") == 0)
+    t = RT_RESOLVER_FILE;
+  else if (strcasecmp(s, "unicast") == 0)
+    t = RT_RESOLVER_UNICAST;
+  else if (strcasecmp(s, "chain") == 0)
+    t = RT_RESOLVER_CHAIN;
+  else
+    return false;
+  return true;
 };
 
 rtRemoteFactory::rtRemoteFactory()
@@ -56,15 +57,39 @@ rtRemoteFactory::~rtRemoteFactory()
 rtRemoteIResolver*
 rtRemoteFactory::rtRemoteCreateResolver(rtRemoteEnvironment* env)
 {
+  rtRemoteIResolver* resolver = rtRemoteCreateResolver(env, env->Config->resolver_type());
+  if (!resolver)
+  {
+    rtLogWarn("falling back to the multicast resolver");
+    resolver = new rtRemoteMulticastResolver(env);
+  }
+  return resolver;
+}
+
+rtRemoteIResolver*
+rtRemoteFactory::rtRemoteCreateResolver(rtRemoteEnvironment* env, std::string const& resolverType)
+{
+  rtResolverType t;
+  if (!rtResolverTypeFromString(resolverType, t))
+  {
+    rtLogError("unknown resolver type: %s", resolverType.c_str());
+    return nullptr;
+  }
+
   rtRemoteIResolver* resolver = nullptr;
-  rtResolverType t = rtResolverTypeFromString(env->Config->resolver_type());
   switch (t)
   {
     case RT_RESOLVER_MULTICAST:
       resolver = new rtRemoteMulticastResolver(env);
       break;
-    default:
-      assert(false);
+    case RT_RESOLVER_FILE:
+      resolver = new rtRemoteFileResolver(env);
+      break;
+    case RT_RESOLVER_UNICAST:
+      resolver = new rtRemoteNsResolver(env);
+      break;
+    case RT_RESOLVER_CHAIN:
+      resolver = new rtRemoteChainResolver(env);
       break;
   }
   return resolver;
@@ -18,87 +18,74 @@ limitations under the License.
 
 #include "rtRemoteFileResolver.h"
 #include "rtRemoteSocketUtils.h"
-#include "rtRemoteMessage.h"
 #include "rtRemoteConfig.h"
 #include "rtRemoteEnvironment.h"
 
-#include <condition_variable>
-#include <thread>
-#include <mutex>
+#include <string>
 
 #include <rtLog.h>
 
 #include <errno.h>
-#include <fcntl.h>
+#include <signal.h>
+#include <stdlib.h>
 #include <string.h>
-#include <netinet/in.h>
-#include <net/if.h>
-#include <arpa/inet.h>
 #include <unistd.h>
-#include <ifaddrs.h>
-#include <sys/file.h>
-#include <sys/stat.h>
-#include <fcntl.h>
-#include <unistd.h>
-
-#include <rapidjson/document.h>
-#include <rapidjson/memorystream.h>
-#include <rapidjson/prettywriter.h>
-#include <rapidjson/stringbuffer.h>
-#include <rapidjson/writer.h>
-#include <rapidjson/filereadstream.h>
-#include <rapidjson/filewritestream.h>
-#include <rapidjson/pointer.h>
 
-class FileLocker
+namespace
 {
-public:
-  FileLocker(FILE* f) : m_file(f)
+  std::string
+  formatEndpoint(sockaddr_storage const& endpoint)
   {
-    lock();
-  }
+    uint16_t port = 0;
+    if (endpoint.ss_family != AF_UNIX)
+      rtGetPort(endpoint, &port);
 
-  ~FileLocker()
-  {
-    unlock();
+    return rtSocketAddressToString(endpoint) + "\t" + std::to_string(port) + "\t" + std::to_string(getpid());
   }
 
-  void lock()
+  // entries are "address<tab>port<tab>pid", where address is an ip or a
+  // unix socket path and the port of a unix socket is 0. older ones have no pid and are
+  // taken as live.
+  pid_t
+  ownerOf(std::string const& s)
   {
-    if (m_file)
-    {
-      int ret = flock(fileno(m_file), LOCK_EX);
-      if (ret == -1)
-      {
-        rtError e = rtErrorFromErrno(errno);
-        rtLogWarn("failed to lock file. %s", rtStrError(e));
-      }
-    }
+    size_t tab = s.find('\t');
+    if (tab != std::string::npos)
+      tab = s.find('\t', tab + 1);
+    if (tab == std::string::npos)
+      return 0;
+    return static_cast<pid_t>(strtol(s.c_str() + tab + 1, nullptr, 10));
   }
 
-  void unlock()
+  bool
+  isOwnerAlive(std::string const& s)
   {
-    if (m_file)
-    {
-      int ret = flock(fileno(m_file), LOCK_UN);
-      if (ret == -1)
-      {
-        rtError e = rtErrorFromErrno(errno);
-        rtLogWarn("failed to unlock file. %s", rtStrError(e));
-      }
-      m_file = nullptr;
-    }
+    pid_t pid = ownerOf(s);
+    if (pid <= 0 || pid == getpid())
+      return true;
+    return kill(pid, 0) == 0 || errno != ESRCH;
   }
 
-private:
-  FILE* m_file;
-};
+  rtError
+  parseEndpoint(std::string const& s, sockaddr_storage& endpoint)
+  {
+    size_t tab = s.find('\t');
+    if (tab == std::string::npos)
+      return RT_ERROR_INVALID_ARG;
 
+    std::string ip = s.substr(0, tab);
+    uint16_t port = static_cast<uint16_t>(strtol(s.c_str() + tab + 1, nullptr, 10));
+    return rtParseAddress(endpoint, ip.c_str(), port, nullptr);
+  }
+}
 
 rtRemoteFileResolver::rtRemoteFileResolver(rtRemoteEnvironment* env)
-: m_db_fp(nullptr)
-, m_env(env)
-{}
+  : m_store("\t")
+  , m_env(env)
+{
+  // don't hand out endpoints of processes that died without unregistering
+  m_store.setFilter(&isOwnerAlive);
+}
 
 rtRemoteFileResolver::~rtRemoteFileResolver()
 {
@@ -108,110 +95,46 @@ rtRemoteFileResolver::~rtRemoteFileResolver()
 }
 
 rtError
-rtRemoteFileResolver::open(sockaddr_storage const& rpc_endpoint)
+rtRemoteFileResolver::open(sockaddr_storage const& /*rpc_endpoint*/)
 {
-  std::string dbPath = m_env->Config->resolver_file_db_path();
-  m_db_fp = fopen(dbPath.c_str(), "w+");
-  if (m_db_fp == nullptr)
-  {
-    rtError e = rtErrorFromErrno(errno);
-    rtLogError("could not open database file %s. %s", dbPath.c_str(), rtStrError(e));
-    return e;
-  }
-
-  char buff[128];
-  void* addr = nullptr;
-  rtGetInetAddr(rpc_endpoint, &addr);
-
-  socklen_t len;
-  rtSocketGetLength(rpc_endpoint, &len);
-  char const* p = inet_ntop(rpc_endpoint.ss_family, addr, buff, len);
-  if (p)
-    m_rpc_addr = p;
-
-  rtGetPort(rpc_endpoint, &m_rpc_port);
-  return RT_OK;
+  return m_store.open(m_env->Config->resolver_file_db_path());
 }
 
 rtError
-rtRemoteFileResolver::registerObject(std::string const& name, sockaddr_storage const&)
+rtRemoteFileResolver::registerObject(std::string const& name, sockaddr_storage const& endpoint)
 {
-  if (m_db_fp == nullptr)
-  {
-    rtLogError("no database connection");
-    return RT_ERROR_INVALID_ARG;
-  }
-
-  // read in existing records into DOM
-  std::vector<char> buff(1024 * 64);
-  fseek(m_db_fp, 0, SEEK_SET);
-
-  FileLocker fileLocker(m_db_fp);
-  rapidjson::FileReadStream is(m_db_fp, &buff[0], buff.capacity());
-
-  rapidjson::Document doc;
-  doc.ParseStream(is);
-
-  rapidjson::Pointer("/" + name + "/" + kFieldNameIp).Set(doc, m_rpc_addr);
-  rapidjson::Pointer("/" + name + "/" + kFieldNamePort).Set(doc, m_rpc_port);
-
-  // write updated json back to file
-  buff[0] = '\0';
-
-  fseek(m_db_fp, 0, SEEK_SET);  
-  rapidjson::FileWriteStream os(m_db_fp, &buff[0], buff.capacity());
-  rapidjson::Writer<rapidjson::FileWriteStream> writer(os);
-  doc.Accept(writer);
-  fflush(m_db_fp);
-
-  return RT_OK;
+  return m_store.put(name, formatEndpoint(endpoint));
 }
 
 rtError
 rtRemoteFileResolver::locateObject(std::string const& name, sockaddr_storage& endpoint,
     uint32_t)
 {
-  if (m_db_fp == nullptr)
-  {
-    rtLogError("no database connection");
-    return RT_ERROR_INVALID_ARG;
-  }
-
-  std::vector<char> buff(1024 * 64);
-
-  FileLocker fileLocker(m_db_fp);
-  fseek(m_db_fp, 0, SEEK_SET);  
-  rapidjson::FileReadStream is(m_db_fp, &buff[0], buff.capacity());
-
-  rapidjson::Document doc;
-  doc.ParseStream(is);
+  std::string value;
+  rtError e = m_store.get(name, value);
+  if (e != RT_OK)
+    return e;
 
-  fileLocker.unlock();
-  
-  // check if name is registered
-  if (!rapidjson::Pointer("/" + name).Get(doc))
+  // an entry we can't use is as good as none, so a resolver chain can go
+  // on and the answer can still be cached as not found
+  memset(&endpoint, 0, sizeof(endpoint));
+  e = parseEndpoint(value, endpoint);
+  if (e != RT_OK)
+  {
+    rtLogWarn("bad entry for %s: %s", name.c_str(), value.c_str());
     return RT_RESOURCE_NOT_FOUND;
-  
-  // pull registered IP and port
-  rapidjson::Value *ip = rapidjson::Pointer("/" + name + "/" + kFieldNameIp).Get(doc);
-  rapidjson::Value *port = rapidjson::Pointer("/" + name + "/" + kFieldNamePort).Get(doc);
-  rtError err = rtParseAddress(endpoint, ip->GetString(), port->GetInt(), nullptr);
-  if (err != RT_OK)
-    return err;
-    
+  }
   return RT_OK;
 }
 
 rtError
 rtRemoteFileResolver::close()
 {
-  if (m_db_fp != nullptr)
-    fclose(m_db_fp);
-  return RT_OK;
+  return m_store.close();
 }
 
 rtError
-rtRemoteFileResolver::unregisterObject(std::string const& /*name*/)
+rtRemoteFileResolver::unregisterObject(std::string const& name)
 {
-  return RT_ERROR_NOT_IMPLEMENTED;
+  return m_store.erase(name);
 }
@@ -0,0 +1,221 @@
+/*
+
+pxCore Copyright 2005-2018 John Robinson
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+*/
+
+#include "rtRemoteLocateCache.h"
+#include "rtRemoteConfig.h"
+#include "rtRemoteEnvironment.h"
+#include "rtRemoteSocketUtils.h"
+
+#include <rtLog.h>
+#include <string.h>
+
+using std::chrono::steady_clock;
+
+rtRemoteLocateCache::rtRemoteLocateCache(rtRemoteEnvironment* env, rtRemoteIResolver* resolver)
+  : m_env(env)
+  , m_resolver(resolver)
+  , m_ttl(env->Config->resolver_cache_ttl_ms())
+  , m_negative_ttl(env->Config->resolver_cache_negative_ttl_ms())
+  , m_max_entries(env->Config->resolver_cache_max_entries())
+{
+}
+
+rtRemoteLocateCache::~rtRemoteLocateCache()
+{
+}
+
+rtError
+rtRemoteLocateCache::open(sockaddr_storage const& rpc_endpoint)
+{
+  return m_resolver->open(rpc_endpoint);
+}
+
+rtError
+rtRemoteLocateCache::close()
+{
+  clear();
+  return m_resolver->close();
+}
+
+rtError
+rtRemoteLocateCache::registerObject(std::string const& name, sockaddr_storage const& endpoint)
+{
+  invalidate(name);
+  return m_resolver->registerObject(name, endpoint);
+}
+
+rtError
+rtRemoteLocateCache::unregisterObject(std::string const& name)
+{
+  invalidate(name);
+  return m_resolver->unregisterObject(name);
+}
+
+rtError
+rtRemoteLocateCache::locateObject(std::string const& name, sockaddr_storage& endpoint,
+  uint32_t timeout)
+{
+  {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    auto itr = m_entries.find(name);
+    if (itr != m_entries.end())
+    {
+      if (steady_clock::now() < itr->second.Expires)
+      {
+        if (itr->second.Status == RT_OK)
+          endpoint = itr->second.Endpoint;
+        return itr->second.Status;
+      }
+      erase(itr);
+    }
+  }
+
+  rtError e = m_resolver->locateObject(name, endpoint, timeout);
+  insert(name, e, endpoint);
+  return e;
+}
+
+rtError
+rtRemoteLocateCache::locateObjects(std::vector<std::string> const& names,
+  std::map<std::string, sockaddr_storage>& endpoints, uint32_t timeout)
+{
+  std::vector<std::string> misses;
+  rtError result = RT_OK;
+  {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    auto const now = steady_clock::now();
+    for (std::string const& name : names)
+    {
+      auto itr = m_entries.find(name);
+      if (itr == m_entries.end() || itr->second.Expires <= now)
+        misses.push_back(name);
+      else if (itr->second.Status == RT_OK)
+        endpoints[name] = itr->second.Endpoint;
+      else
+        result = itr->second.Status;
+    }
+  }
+
+  if (misses.empty())
+    return result;
+
+  std::map<std::string, sockaddr_storage> found;
+  rtError e = m_resolver->locateObjects(misses, found, timeout);
+  for (std::string const& name : misses)
+  {
+    auto itr = found.find(name);
+    if (itr != found.end())
+    {
+      insert(name, RT_OK, itr->second);
+      endpoints[name] = itr->second;
+    }
+    else
+    {
+      sockaddr_storage none;
+      memset(&none, 0, sizeof(none));
+      insert(name, e != RT_OK ? e : RT_RESOURCE_NOT_FOUND, none);
+      result = e != RT_OK ? e : RT_RESOURCE_NOT_FOUND;
+    }
+  }
+  return result;
+}
+
+void
+rtRemoteLocateCache::insert(std::string const& name, rtError status, sockaddr_storage const& endpoint)
+{
+  // no answer in time isn't an answer, ask again next time
+  if (status != RT_OK && status != RT_RESOURCE_NOT_FOUND)
+    return;
+
+  std::chrono::milliseconds const ttl = (status == RT_OK) ? m_ttl : m_negative_ttl;
+  if (ttl.count() == 0 || m_max_entries == 0)
+    return;
+
+  Entry entry;
+  entry.Status = status;
+  entry.Expires = steady_clock::now() + ttl;
+  if (status == RT_OK)
+  {
+    entry.Endpoint = endpoint;
+    entry.EndpointName = rtSocketToString(endpoint);
+  }
+  else
+  {
+    memset(&entry.Endpoint, 0, sizeof(entry.Endpoint));
+  }
+
+  std::unique_lock<std::mutex> lock(m_mutex);
+  auto itr = m_entries.find(name);
+  if (itr != m_entries.end())
+  {
+    erase(itr);
+  }
+  else if (m_entries.size() >= m_max_entries)
+  {
+    // make room. whatever expires first, expired or not, goes
+    auto first = m_entries.find(m_expiry.begin()->second);
+    erase(first);
+  }
+
+  entry.ExpiryPos = m_expiry.insert(ExpiryIndex::value_type(entry.Expires, name));
+  m_entries.insert(EntryMap::value_type(name, entry));
+}
+
+rtRemoteLocateCache::EntryMap::iterator
+rtRemoteLocateCache::erase(EntryMap::iterator itr)
+{
+  m_expiry.erase(itr->second.ExpiryPos);
+  return m_entries.erase(itr);
+}
+
+void
+rtRemoteLocateCache::invalidate(std::string const& name)
+{
+  std::unique_lock<std::mutex> lock(m_mutex);
+  auto itr = m_entries.find(name);
+  if (itr != m_entries.end())
+    erase(itr);
+}
+
+void
+rtRemoteLocateCache::invalidateEndpoint(sockaddr_storage const& endpoint)
+{
+  std::string const endpointName = rtSocketToString(endpoint);
+
+  std::unique_lock<std::mutex> lock(m_mutex);
+  for (auto itr = m_entries.begin(); itr != m_entries.end();)
+  {
+    if (itr->second.Status == RT_OK && itr->second.EndpointName == endpointName)
+    {
+      rtLogDebug("dropping cached location of %s", itr->first.c_str());
+      itr = erase(itr);
+    }
+    else
+    {
+      ++itr;
+    }
+  }
+}
+
+void
+rtRemoteLocateCache::clear()
+{
+  std::unique_lock<std::mutex> lock(m_mutex);
+  m_entries.clear();
+  m_expiry.clear();
+}
@@ -0,0 +1,379 @@
+/*
+
+pxCore Copyright 2005-2018 John Robinson
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+*/
+
+#include "rtRemoteLogStore.h"
+#include "rtRemoteSocketUtils.h"
+
+#include <rtLog.h>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+namespace
+{
+  class FileLocker
+  {
+  public:
+    FileLocker(int fd) : m_fd(fd)
+    {
+      if (flock(m_fd, LOCK_EX) == -1)
+      {
+        rtError e = rtErrorFromErrno(errno);
+        rtLogWarn("failed to lock file. %s", rtStrError(e));
+        m_fd = -1;
+      }
+    }
+
+    ~FileLocker()
+    {
+      if (m_fd != -1)
+        flock(m_fd, LOCK_UN);
+    }
+
+  private:
+    int m_fd;
+  };
+
+  // the log is rewritten once it is this many times bigger than what is live
+  const off_t kCompactRatio = 4;
+  const off_t kCompactMinSize = 64 * 1024;
+
+  timespec
+  modifiedTime(struct stat const& st)
+  {
+    #ifdef __APPLE__
+    return st.st_mtimespec;
+    #else
+    return st.st_mtim;
+    #endif
+  }
+}
+
+rtRemoteLogStore::rtRemoteLogStore(std::string const& separator)
+  : m_separator(separator)
+  , m_fd(-1)
+  , m_ino(0)
+  , m_parsed_size(0)
+  , m_live_bytes(0)
+{
+  memset(&m_parsed_mtime, 0, sizeof(m_parsed_mtime));
+}
+
+rtRemoteLogStore::~rtRemoteLogStore()
+{
+  close();
+}
+
+rtError
+rtRemoteLogStore::open(std::string const& path)
+{
+  std::unique_lock<std::mutex> lock(m_mutex);
+  m_path = path;
+
+  // other processes may already have written to it. don't truncate.
+  rtError e = openFile();
+  if (e != RT_OK)
+    return e;
+  return reload();
+}
+
+rtError
+rtRemoteLogStore::close()
+{
+  std::unique_lock<std::mutex> lock(m_mutex);
+  if (m_fd != -1)
+    ::close(m_fd);
+  m_fd = -1;
+  m_entries.clear();
+  return RT_OK;
+}
+
+rtError
+rtRemoteLogStore::openFile()
+{
+  if (m_fd != -1)
+    ::close(m_fd);
+
+  m_fd = ::open(m_path.c_str(), O_RDWR | O_CREAT | O_APPEND | O_CLOEXEC, 0666);
+  if (m_fd == -1)
+  {
+    rtError e = rtErrorFromErrno(errno);
+    rtLogError("could not open %s. %s", m_path.c_str(), rtStrError(e));
+    return e;
+  }
+  return RT_OK;
+}
+
+bool
+rtRemoteLogStore::validKey(std::string const& key) const
+{
+  return !key.empty() && key.find('\n') == std::string::npos
+    && key.find(m_separator) == std::string::npos;
+}
+
+void
+rtRemoteLogStore::apply(char const* begin, char const* end)
+{
+  while (begin < end)
+  {
+    char const* eol = static_cast<char const *>(memchr(begin, '\n', end - begin));
+    if (!eol)
+      break; // partial line, a writer is still at it
+
+    std::string line(begin, eol);
+    begin = eol + 1;
+
+    size_t sep = line.find(m_separator);
+    if (sep == std::string::npos || sep == 0)
+      continue;
+
+    std::string key = line.substr(0, sep);
+    std::string value = line.substr(sep + m_separator.size());
+
+    auto itr = m_entries.find(key);
+    if (itr != m_entries.end())
+    {
+      m_live_bytes -= key.size() + m_separator.size() + itr->second.size() + 1;
+      m_entries.erase(itr);
+    }
+
+    if (!value.empty())
+    {
+      m_live_bytes += line.size() + 1;
+      m_entries.emplace(std::move(key), std::move(value));
+    }
+  }
+}
+
+// Brings the parsed copy up to date. Usually the file is unchanged and this
+// is a single stat. If it only grew, just the new pages are mapped and parsed.
+rtError
+rtRemoteLogStore::refresh()
+{
+  struct stat st;
+  if (stat(m_path.c_str(), &st) == -1)
+    return rtErrorFromErrno(errno);
+
+  if (st.st_ino != m_ino)
+  {
+    // compacted by someone else
+    rtError e = openFile();
+    if (e != RT_OK)
+      return e;
+    return reload();
+  }
+
+  timespec const mtime = modifiedTime(st);
+  if (st.st_size == m_parsed_size && mtime.tv_sec == m_parsed_mtime.tv_sec
+      && mtime.tv_nsec == m_parsed_mtime.tv_nsec)
+    return RT_OK;
+
+  if (st.st_size < m_parsed_size)
+    return reload();
+
+  long const pageSize = sysconf(_SC_PAGESIZE);
+  off_t const mapStart = m_parsed_size - (m_parsed_size % pageSize);
+  size_t const mapLength = st.st_size - mapStart;
+  if (st.st_size == m_parsed_size)
+  {
+    m_parsed_mtime = mtime;
+    return RT_OK;
+  }
+
+  void* p = mmap(nullptr, mapLength, PROT_READ, MAP_SHARED, m_fd, mapStart);
+  if (p == MAP_FAILED)
+    return rtErrorFromErrno(errno);
+
+  char const* base = static_cast<char const *>(p);
+  char const* begin = base + (m_parsed_size - mapStart);
+  char const* end = base + mapLength;
+
+  // stop after the last complete line, a writer may be half way through the next
+  char const* last = end;
+  while (last > begin && last[-1] != '\n')
+    --last;
+
+  apply(begin, last);
+  m_parsed_size += (last - begin);
+  if (last == end)
+    m_parsed_mtime = mtime;
+  munmap(p, mapLength);
+  return RT_OK;
+}
+
+rtError
+rtRemoteLogStore::reload()
+{
+  struct stat st;
+  if (fstat(m_fd, &st) == -1)
+    return rtErrorFromErrno(errno);
+
+  m_entries.clear();
+  m_live_bytes = 0;
+  m_parsed_size = 0;
+  m_ino = st.st_ino;
+  memset(&m_parsed_mtime, 0, sizeof(m_parsed_mtime));
+  return refresh();
+}
+
+void
+rtRemoteLogStore::setFilter(Filter const& filter)
+{
+  std::unique_lock<std::mutex> lock(m_mutex);
+  m_filter = filter;
+}
+
+rtError
+rtRemoteLogStore::append(std::string const& record, std::function<bool()> const& precondition)
+{
+  if (m_fd == -1)
+  {
+    rtLogError("%s is not open", m_path.c_str());
+    return RT_ERROR_INVALID_ARG;
+  }
+
+  while (true)
+  {
+    FileLocker locker(m_fd);
+
+    // if the file was compacted while we waited, we hold a lock on the old one
+    struct stat cur;
+    struct stat ours;
+    if (stat(m_path.c_str(), &cur) == 0 && fstat(m_fd, &ours) == 0 && cur.st_ino != ours.st_ino)
+    {
+      rtError e = openFile();
+      if (e != RT_OK)
+        return e;
+      continue;
+    }
+
+    rtError e = RT_OK;
+    if (precondition)
+    {
+      e = refresh();
+      if (e != RT_OK)
+        return e;
+      if (!precondition())
+        return RT_OK;
+    }
+
+    ssize_t n = write(m_fd, record.data(), record.size());
+    if (n != static_cast<ssize_t>(record.size()))
+      return rtErrorFromErrno(errno);
+
+    e = refresh();
+    if (e != RT_OK)
+      return e;
+
+    if (m_parsed_size > kCompactMinSize && m_parsed_size > kCompactRatio * static_cast<off_t>(m_live_bytes))
+      return compact();
+    return RT_OK;
+  }
+}
+
+// called with the file locked
+rtError
+rtRemoteLogStore::compact()
+{
+  std::string tmpPath = m_path + ".tmp." + std::to_string(getpid());
+  int fd = ::open(tmpPath.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0666);
+  if (fd == -1)
+    return rtErrorFromErrno(errno);
+
+  std::string out;
+  out.reserve(m_live_bytes);
+  for (auto const& entry : m_entries)
+  {
+    if (!m_filter || m_filter(entry.second))
+      out += entry.first + m_separator + entry.second + "\n";
+  }
+
+  ssize_t n = write(fd, out.data(), out.size());
+  ::close(fd);
+  if (n != static_cast<ssize_t>(out.size()) || rename(tmpPath.c_str(), m_path.c_str()) == -1)
+  {
+    rtError e = rtErrorFromErrno(errno);
+    unlink(tmpPath.c_str());
+    rtLogWarn("failed to compact %s. %s", m_path.c_str(), rtStrError(e));
+    return RT_OK; // the old log is still good
+  }
+
+  rtLogInfo("compacted %s to %d entries", m_path.c_str(), static_cast<int>(m_entries.size()));
+  rtError e = openFile();
+  if (e != RT_OK)
+    return e;
+  return reload();
+}
+
+rtError
+rtRemoteLogStore::get(std::string const& key, std::string& value)
+{
+  std::unique_lock<std::mutex> lock(m_mutex);
+  if (m_fd == -1)
+    return RT_ERROR_INVALID_ARG;
+
+  rtError e = refresh();
+  if (e != RT_OK)
+    return e;
+
+  auto itr = m_entries.find(key);
+  if (itr == m_entries.end())
+    return RT_RESOURCE_NOT_FOUND;
+
+  if (m_filter && !m_filter(itr->second))
+  {
+    // someone may have put a good value since we looked
+    e = append(key + m_separator + "\n", [this, &key]()
+    {
+      auto cur = m_entries.find(key);
+      return cur != m_entries.end() && !m_filter(cur->second);
+    });
+    if (e != RT_OK)
+      rtLogWarn("failed to erase stale entry for %s. %s", key.c_str(), rtStrError(e));
+    return RT_RESOURCE_NOT_FOUND;
+  }
+
+  value = itr->second;
+  return RT_OK;
+}
+
+rtError
+rtRemoteLogStore::put(std::string const& key, std::string const& value)
+{
+  if (!validKey(key) || value.empty() || value.find('\n') != std::string::npos)
+    return RT_ERROR_INVALID_ARG;
+
+  std::unique_lock<std::mutex> lock(m_mutex);
+  return append(key + m_separator + value + "\n");
+}
+
+rtError
+rtRemoteLogStore::erase(std::string const& key)
+{
+  if (!validKey(key))
+    return RT_ERROR_INVALID_ARG;
+
+  std::unique_lock<std::mutex> lock(m_mutex);
+  return append(key + m_separator + "\n");
+}
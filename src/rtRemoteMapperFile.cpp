@@ -18,225 +18,66 @@ limitations under the License.
 
 #include "rtRemoteMapperFile.h"
 #include "rtRemoteMapper.h"
-#include "rtRemoteEndpoint.h"
+#include "rtRemoteEndPoint.h"
 #include "rtRemoteConfig.h"
-#include "rtRemoteFactory.h"
 #include "rtRemoteEnvironment.h"
 #include "rtError.h"
 
+#include <rtLog.h>
 #include <string>
-#include <string.h>
-#include <errno.h>
-#include <unistd.h>
-#include <sys/file.h>
-#include <sys/stat.h>
-#include <fcntl.h>
-#include <mutex>
-#include <thread>
 
 rtRemoteMapperFile::rtRemoteMapperFile(rtRemoteEnvironment* env)
 : rtRemoteIMapper(env)
+, m_store("::=")
 {
-  m_file_path = m_env->Config->resolver_file_db_path();
+  rtError e = m_store.open(m_env->Config->mapper_file_db_path());
+  if (e != RT_OK)
+    rtLogWarn("failed to open mapper database. %s", rtStrError(e));
 }
 
 rtRemoteMapperFile::~rtRemoteMapperFile()
 {
+  m_store.close();
 }
 
 rtError
-rtRemoteMapperFile::registerEndpoint(std::string const& objectId, rtRemoteEndpointPtr const& endpoint)
+rtRemoteMapperFile::registerEndpoint(std::string const& objectId, rtRemoteEndPointPtr const& endpoint)
 {
-  FILE* fp;
-  fp = fopen(m_file_path.c_str(), "r");
-  if (fp == nullptr)
-    return RT_FAIL;
-
-  // tmp file to write to while reading/checking contents of permanent file. renamed later.
-  std::string tmpPath = m_file_path + ".tmp";
-
-  char *line = NULL;
-  size_t len = 0;
-  int read = -1;
-
-  {
-    std::unique_lock<std::mutex> lock(m_mutex);
-    while ( access( tmpPath.c_str(), F_OK ) != -1 );
-    FILE* tmpFp = fopen(tmpPath.c_str(),"w");
-    if (tmpFp == nullptr)
-      return RT_FAIL;
-
-    // read line by line
-    while ( (read = getline(&line, &len, fp)) != -1)
-    {
-      if (line[read-1] == '\n')
-        line[read-1] = '\0';
-      std::string lineString(line);
-      size_t index = lineString.find("::=");
-      if (index != std::string::npos)
-      {
-        std::string readId = lineString.substr(0, index);
-        // if not the one we want to register, just copy record over
-        if (objectId.compare(readId) != 0)
-          fprintf(tmpFp, "%s\n", line);
-        // else overwrite it
-        else
-          rtLogWarn("overwriting existing registered endpoint: %s", line);
-      }
-    }
-    std::string result = objectId + "::=" + endpoint->toUriString();
-    fprintf(tmpFp, "%s\n", result.c_str());
-    fclose(tmpFp);
-    
-    if (rename(tmpPath.c_str(), m_file_path.c_str()))
-      return RT_FAIL;
-  } // end critical section
-
-  if (fp)
-    fclose(fp);
-  
-  return RT_OK;
+  if (!endpoint)
+    return RT_ERROR_INVALID_ARG;
+  return m_store.put(objectId, endpoint->toString());
 }
 
 rtError
 rtRemoteMapperFile::deregisterEndpoint(std::string const& objectId)
 {
-  rtError err = RT_FAIL;
-
-  FILE* fp;
-  fp = fopen(m_file_path.c_str(), "r");
-  if (fp == nullptr)
+  if (!isRegistered(objectId))
     return RT_FAIL;
-
-  // tmp file to write to while reading/checking contents of permanent file. renamed later.
-  std::string tmpPath = m_file_path + ".tmp";
-
-  char *line = NULL;
-  size_t len = 0;
-  int read = -1;
-
-  {
-    std::unique_lock<std::mutex> lock(m_mutex);
-    while ( access( tmpPath.c_str(), F_OK ) != -1 );
-    FILE* tmpFp = fopen(tmpPath.c_str(),"w");
-    if (tmpFp == nullptr)
-      return RT_FAIL;
-
-    // read line by line
-    while ( (read = getline(&line, &len, fp)) != -1)
-    {
-      if (line[read-1] == '\n')
-        line[read-1] = '\0';
-      std::string lineString(line);
-      size_t index = lineString.find("::=");
-      if (index != std::string::npos)
-      {
-        std::string readId = lineString.substr(0, index);
-        // copy over everything except for the one to be deregistered
-        if (objectId.compare(readId) != 0)
-          fprintf(tmpFp, "%s\n", line);
-        else
-          err = RT_OK;
-      }
-    }
-    fclose(tmpFp);
-    
-    if (rename(tmpPath.c_str(), m_file_path.c_str()))
-      return RT_FAIL;
-  } // end critical section
-    
-  if (fp)
-    fclose(fp);
-
-  return err;
+  return m_store.erase(objectId);
 }
 
 rtError
-rtRemoteMapperFile::lookupEndpoint(std::string const& objectId, rtRemoteEndpointPtr& /*endpoint*/)
+rtRemoteMapperFile::lookupEndpoint(std::string const& objectId, rtRemoteEndPointPtr& endpoint)
 {
-  FILE* fp;
-  fp = fopen(m_file_path.c_str(), "r");
-  if (fp == nullptr)
-    return RT_FAIL;
+  std::string objectUri;
+  rtError e = m_store.get(objectId, objectUri);
+  if (e != RT_OK)
+    return e;
 
-  char *line = NULL;
-  size_t len = 0;
-  int read = -1;
-
-  std::string objectUri;  
+  rtRemoteEndPoint* ep = rtRemoteEndPoint::fromString(objectUri);
+  if (!ep)
   {
-    // check if someone else is updating the file
-    std::string tmpPath = m_file_path + ".tmp";
-    while ( access( tmpPath.c_str(), F_OK ) != -1 );
-  
-    // read line by line
-    while ( (read = getline(&line, &len, fp)) != -1)
-    {
-      if (line[read-1] == '\n')
-        line[read-1] = '\0';
-      std::string lineString(line);
-      size_t index = lineString.find("::=");
-      if (index != std::string::npos)
-      {
-        std::string readId = lineString.substr(0, index);
-        if (objectId.compare(readId) == 0)
-          objectUri = lineString.substr(index+3, std::string::npos);
-      }
-    }
+    rtLogWarn("bad endpoint for %s: %s", objectId.c_str(), objectUri.c_str());
+    return RT_FAIL;
   }
 
-  if (fp)
-    fclose(fp);
-  
-  // result contains endpoint's URI (if registered)
-  if (!objectUri.empty())
-    return RT_OK;
-    // TODO: need to wait till Factory changes are integrated into odessa
-    //return m_env->Factory->createEndpoint(objectUri, endpoint);
-  else
-    return RT_FAIL;
+  endpoint.reset(ep);
+  return RT_OK;
 }
 
 bool
 rtRemoteMapperFile::isRegistered(std::string const& objectId)
 {
-  FILE* fp;
-  fp = fopen(m_file_path.c_str(), "r");
-  if (fp == nullptr)
-    return RT_FAIL;
-
-  char *line = NULL;
-  size_t len = 0;
-  int read = -1;
-
-  std::string objectUri;  
-  {
-    // check if someone else is updating the file
-    std::string tmpPath = m_file_path + ".tmp";
-    while ( access( tmpPath.c_str(), F_OK ) != -1 );
-  
-    // read line by line
-    while ( (read = getline(&line, &len, fp)) != -1)
-    {
-      if (line[read-1] == '\n')
-        line[read-1] = '\0';
-      std::string lineString(line);
-      size_t index = lineString.find("::=");
-      if (index != std::string::npos)
-      {
-        std::string readId = lineString.substr(0, index);
-        if (objectId.compare(readId) == 0)
-          objectUri = lineString.substr(index+3, std::string::npos);
-      }
-    }
-  }
-
-  if (fp)
-    fclose(fp);
-  
-  // result contains endpoint's URI (if registered)
-  if (!objectUri.empty())
-    return true;
-
-  return false;
+  std::string objectUri;
+  return m_store.get(objectId, objectUri) == RT_OK;
 }
@@ -17,41 +17,199 @@ limitations under the License.
 */
 
 #include "rtRemoteMapperSql.h"
-#include "rtRemoteEndpoint.h"
+#include "rtRemoteEndPoint.h"
+#include "rtRemoteConfig.h"
 #include "rtRemoteEnvironment.h"
 #include "rtError.h"
+
+#include <rtLog.h>
+#include <sqlite3.h>
 #include <string>
 
 rtRemoteMapperSql::rtRemoteMapperSql(rtRemoteEnvironment* env)
 : rtRemoteIMapper(env)
+, m_db(nullptr)
+, m_insert(nullptr)
+, m_delete(nullptr)
+, m_select(nullptr)
 {
-  // TODO
+  std::string path = m_env->Config->mapper_sql_db_path();
+  rtError e = open(path);
+  if (e != RT_OK)
+  {
+    rtLogWarn("failed to open mapper database %s. %s", path.c_str(), rtStrError(e));
+    close();
+  }
+}
+
+rtRemoteMapperSql::~rtRemoteMapperSql()
+{
+  close();
 }
 
 rtError
-rtRemoteMapperSql::registerEndpoint(std::string const& /*objectId*/, rtRemoteEndpointPtr const& /*endpoint*/)
+rtRemoteMapperSql::open(std::string const& path)
+{
+  int ret = sqlite3_open_v2(path.c_str(), &m_db, SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE
+    | SQLITE_OPEN_NOMUTEX, nullptr);
+  if (ret != SQLITE_OK)
+  {
+    rtLogError("sqlite3_open_v2: %s", m_db ? sqlite3_errmsg(m_db) : sqlite3_errstr(ret));
+    return RT_FAIL;
+  }
+
+  // other processes may be in the middle of a write, wait for them instead of failing
+  sqlite3_busy_timeout(m_db, m_env->Config->mapper_sql_busy_timeout_ms());
+
+  rtError e = exec("PRAGMA journal_mode=WAL");
+  if (e == RT_OK)
+    e = exec("PRAGMA synchronous=NORMAL");
+  if (e == RT_OK)
+    e = exec("CREATE TABLE IF NOT EXISTS endpoints ("
+      "object_id TEXT PRIMARY KEY NOT NULL, uri TEXT NOT NULL) WITHOUT ROWID");
+  if (e == RT_OK)
+    e = prepare("INSERT OR REPLACE INTO endpoints (object_id, uri) VALUES (?1, ?2)", &m_insert);
+  if (e == RT_OK)
+    e = prepare("DELETE FROM endpoints WHERE object_id = ?1", &m_delete);
+  if (e == RT_OK)
+    e = prepare("SELECT uri FROM endpoints WHERE object_id = ?1", &m_select);
+  return e;
+}
+
+void
+rtRemoteMapperSql::close()
 {
-  // TODO
-  return RT_FAIL;
+  sqlite3_finalize(m_insert);
+  sqlite3_finalize(m_delete);
+  sqlite3_finalize(m_select);
+  m_insert = m_delete = m_select = nullptr;
+
+  if (m_db)
+    sqlite3_close(m_db);
+  m_db = nullptr;
 }
 
 rtError
-rtRemoteMapperSql::deregisterEndpoint(std::string const& /*objectId*/)
+rtRemoteMapperSql::exec(char const* sql)
 {
-  // TODO
-  return RT_FAIL;
+  char* err = nullptr;
+  if (sqlite3_exec(m_db, sql, nullptr, nullptr, &err) != SQLITE_OK)
+  {
+    rtLogError("%s: %s", sql, err ? err : "unknown error");
+    sqlite3_free(err);
+    return RT_FAIL;
+  }
+  return RT_OK;
 }
 
 rtError
-rtRemoteMapperSql::lookupEndpoint(std::string const& /*objectId*/, rtRemoteEndpointPtr& /*endpoint*/)
+rtRemoteMapperSql::prepare(char const* sql, sqlite3_stmt** stmt)
 {
-  // TODO
-  return RT_FAIL;
+  if (sqlite3_prepare_v2(m_db, sql, -1, stmt, nullptr) != SQLITE_OK)
+  {
+    rtLogError("%s: %s", sql, sqlite3_errmsg(m_db));
+    return RT_FAIL;
+  }
+  return RT_OK;
+}
+
+rtError
+rtRemoteMapperSql::registerEndpoint(std::string const& objectId, rtRemoteEndPointPtr const& endpoint)
+{
+  if (!endpoint)
+    return RT_ERROR_INVALID_ARG;
+
+  std::string uri = endpoint->toString();
+
+  std::unique_lock<std::mutex> lock(m_mutex);
+  if (!m_insert)
+    return RT_FAIL;
+
+  sqlite3_bind_text(m_insert, 1, objectId.c_str(), static_cast<int>(objectId.size()), SQLITE_STATIC);
+  sqlite3_bind_text(m_insert, 2, uri.c_str(), static_cast<int>(uri.size()), SQLITE_STATIC);
+  int ret = sqlite3_step(m_insert);
+  sqlite3_reset(m_insert);
+  sqlite3_clear_bindings(m_insert);
+
+  if (ret != SQLITE_DONE)
+  {
+    rtLogWarn("failed to register %s. %s", objectId.c_str(), sqlite3_errmsg(m_db));
+    return RT_FAIL;
+  }
+  return RT_OK;
+}
+
+rtError
+rtRemoteMapperSql::deregisterEndpoint(std::string const& objectId)
+{
+  std::unique_lock<std::mutex> lock(m_mutex);
+  if (!m_delete)
+    return RT_FAIL;
+
+  sqlite3_bind_text(m_delete, 1, objectId.c_str(), static_cast<int>(objectId.size()), SQLITE_STATIC);
+  int ret = sqlite3_step(m_delete);
+  int changes = sqlite3_changes(m_db);
+  sqlite3_reset(m_delete);
+  sqlite3_clear_bindings(m_delete);
+
+  if (ret != SQLITE_DONE)
+  {
+    rtLogWarn("failed to deregister %s. %s", objectId.c_str(), sqlite3_errmsg(m_db));
+    return RT_FAIL;
+  }
+  return changes > 0 ? RT_OK : RT_FAIL;
+}
+
+rtError
+rtRemoteMapperSql::lookup(std::string const& objectId, std::string& uri)
+{
+  std::unique_lock<std::mutex> lock(m_mutex);
+  if (!m_select)
+    return RT_FAIL;
+
+  rtError e = RT_RESOURCE_NOT_FOUND;
+  sqlite3_bind_text(m_select, 1, objectId.c_str(), static_cast<int>(objectId.size()), SQLITE_STATIC);
+
+  int ret = sqlite3_step(m_select);
+  if (ret == SQLITE_ROW)
+  {
+    char const* s = reinterpret_cast<char const *>(sqlite3_column_text(m_select, 0));
+    uri.assign(s, sqlite3_column_bytes(m_select, 0));
+    e = RT_OK;
+  }
+  else if (ret != SQLITE_DONE)
+  {
+    rtLogWarn("failed to look up %s. %s", objectId.c_str(), sqlite3_errmsg(m_db));
+    e = RT_FAIL;
+  }
+
+  sqlite3_reset(m_select);
+  sqlite3_clear_bindings(m_select);
+  return e;
+}
+
+rtError
+rtRemoteMapperSql::lookupEndpoint(std::string const& objectId, rtRemoteEndPointPtr& endpoint)
+{
+  std::string uri;
+  rtError e = lookup(objectId, uri);
+  if (e != RT_OK)
+    return e;
+
+  rtRemoteEndPoint* ep = rtRemoteEndPoint::fromString(uri);
+  if (!ep)
+  {
+    rtLogWarn("bad endpoint for %s: %s", objectId.c_str(), uri.c_str());
+    return RT_FAIL;
+  }
+
+  endpoint.reset(ep);
+  return RT_OK;
 }
 
 bool
-rtRemoteMapperSql::isRegistered(std::string const& /*objectId*/)
+rtRemoteMapperSql::isRegistered(std::string const& objectId)
 {
-  // TODO
-  return false;
+  std::string uri;
+  return lookup(objectId, uri) == RT_OK;
 }
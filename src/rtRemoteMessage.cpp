@@ -60,6 +60,12 @@ namespace
   }
 }
 
+rtRemoteMessage::~rtRemoteMessage()
+{
+  for (int fd : m_fds)
+    ::close(fd);
+}
+
 rtRemoteCorrelationKey
 rtMessage_GetNextCorrelationKey()
 {
@@ -139,6 +145,33 @@ rtMessage_GetCorrelationKey(rapidjson::Document const& doc)
   return k;
 }
 
+bool
+rtMessage_IsWellFormed(rapidjson::Document const& doc)
+{
+  if (!doc.IsObject())
+    return false;
+
+  rapidjson::Value::ConstMemberIterator type = doc.FindMember(kFieldNameMessageType);
+  if (type == doc.MemberEnd() || !type->value.IsString())
+    return false;
+
+  rapidjson::Value::ConstMemberIterator key = doc.FindMember(kFieldNameCorrelationKey);
+  #ifdef RT_REMOTE_CORRELATION_KEY_IS_INT
+  if (key != doc.MemberEnd() && !key->value.IsUint())
+    return false;
+  #else
+  if (key != doc.MemberEnd() && !key->value.IsString())
+    return false;
+  #endif
+
+  rapidjson::Value::ConstMemberIterator id = doc.FindMember(kFieldNameObjectId);
+  if (id != doc.MemberEnd() && !id->value.IsString())
+    return false;
+
+  rapidjson::Value::ConstMemberIterator status = doc.FindMember(kFieldNameStatusMessage);
+  return status == doc.MemberEnd() || status->value.IsString();
+}
+
 char const*
 rtMessage_GetObjectId(rapidjson::Document const& doc)
 {
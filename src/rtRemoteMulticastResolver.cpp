@@ -22,9 +22,11 @@ limitations under the License.
 #include "rtRemoteConfig.h"
 #include "rtRemoteEnvironment.h"
 
-#include <condition_variable>
-#include <thread>
+#include <algorithm>
+#include <chrono>
 #include <mutex>
+#include <random>
+#include <thread>
 
 #include <rtLog.h>
 
@@ -50,6 +52,22 @@ limitations under the License.
 #include <rapidjson/filewritestream.h>
 #include <rapidjson/pointer.h>
 
+namespace
+{
+  // spread retransmits by +/-25% so processes that start together don't
+  // keep searching in lockstep
+  std::chrono::milliseconds
+  jitter(std::chrono::milliseconds interval)
+  {
+    static thread_local std::minstd_rand gen(std::random_device{}());
+    auto const spread = interval.count() / 4;
+    if (spread <= 0)
+      return interval;
+    std::uniform_int_distribution<long long> dist(-spread, spread);
+    return interval + std::chrono::milliseconds(dist(gen));
+  }
+}
+
 rtRemoteMulticastResolver::rtRemoteMulticastResolver(rtRemoteEnvironment* env)
   : m_mcast_fd(-1)
   , m_mcast_src_index(-1)
@@ -104,49 +122,46 @@ rtError rtRemoteMulticastResolver::sendSearchAndWait(const std::string& name, co
   }
 
 
-  rtRemoteMessagePtr searchResponse;
-  RequestMap::const_iterator itr;
+  // register before the first send so a fast reply can't be missed
+  std::future<rtRemoteMessagePtr> reply = m_pending_searches.add(seqId);
 
   using namespace std::chrono;
-  auto iterationIncrement = milliseconds(m_env->Config->resolver_spin_init_ms());
-  auto iterationTime = system_clock::now() + iterationIncrement;
-  auto timeout_ = system_clock::now() + milliseconds(timeout);
+  auto const maxInterval = milliseconds(m_env->Config->resolver_spin_max_ms());
+  auto interval = milliseconds(m_env->Config->resolver_spin_init_ms());
+  auto const deadline = steady_clock::now() + milliseconds(timeout);
 
-  // wait here until timeout expires or we get a response that matches out pid/seqid
-  std::unique_lock<std::mutex> lock(m_mutex);
-  itr = m_pending_searches.end();
-  do {
-
-    rtError err = rtSendDocument(doc, m_ucast_fd, &m_mcast_dest);
+  rtRemoteMessagePtr searchResponse;
+  rtError err = RT_OK;
+  while (true)
+  {
+    err = rtSendDocument(doc, m_ucast_fd, &m_mcast_dest);
     if (err != RT_OK)
-      return err;
-
-    rtLogInfo("Spinning for %llu ms", static_cast<long long unsigned int>(milliseconds(iterationIncrement).count()));
+      break;
 
-    m_cond.wait_until(lock, iterationTime, [this, seqId, &searchResponse] {
-      auto itr = this->m_pending_searches.find(seqId);
-      if (itr != this->m_pending_searches.end()) {
-        searchResponse = itr->second;
-        this->m_pending_searches.erase(itr);
-      }
-      return searchResponse != nullptr;
-    });
+    auto const retry = std::min(steady_clock::now() + jitter(interval), deadline);
+    rtLogDebug("waiting up to %lld ms for search response", static_cast<long long>(
+      duration_cast<milliseconds>(retry - steady_clock::now()).count()));
 
-    if (searchResponse)
+    if (reply.wait_until(retry) == std::future_status::ready)
     {
+      searchResponse = reply.get();
       rtLogInfo("Search response received for %s", seqId.toString().c_str());
       break;
     }
 
-    iterationIncrement += milliseconds(m_env->Config->resolver_spin_iteration_ms());
-    iterationTime = system_clock::now() + iterationIncrement;
+    if (steady_clock::now() >= deadline)
+      break;
 
-  } while (system_clock::now() < timeout_);
+    interval = std::min(interval * 2, maxInterval);
+  }
 
-  lock.unlock();
+  m_pending_searches.remove(seqId);
 
   response = searchResponse;
-  return searchResponse ? RT_OK : RT_RESOURCE_NOT_FOUND;
+  if (err != RT_OK)
+    return err;
+  // silence doesn't mean nobody has it, only that nobody answered in time
+  return searchResponse ? RT_OK : RT_ERROR_TIMEOUT;
 }
 
 rtError
@@ -390,9 +405,43 @@ rtRemoteMulticastResolver::onSearch(rtRemoteMessagePtr const& doc, sockaddr_stor
 
   rtRemoteCorrelationKey key = rtMessage_GetCorrelationKey(*doc);
 
+  auto ids = doc->FindMember(kFieldNameObjectIds);
+  if (ids != doc->MemberEnd() && ids->value.IsArray())
+  {
+    rapidjson::Document res;
+    res.SetObject();
+
+    rapidjson::Value hosted(rapidjson::kArrayType);
+    std::unique_lock<std::mutex> lock(m_mutex);
+    for (rapidjson::Value::ConstValueIterator id = ids->value.Begin(); id != ids->value.End(); ++id)
+    {
+      if (id->IsString() && m_hosted_objects.find(id->GetString()) != m_hosted_objects.end())
+        hosted.PushBack(rapidjson::Value(id->GetString(), id->GetStringLength(), res.GetAllocator()),
+          res.GetAllocator());
+    }
+    lock.unlock();
+
+    if (hosted.Empty())
+      return RT_OK;
+
+    res.AddMember(kFieldNameMessageType, kMessageTypeLocate, res.GetAllocator());
+    res.AddMember(kFieldNameObjectIds, hosted, res.GetAllocator());
+    res.AddMember(kFieldNameEndPoint, m_rpc_endpoint->toString(), res.GetAllocator());
+    res.AddMember(kFieldNameSenderId, senderId->value.GetInt(), res.GetAllocator());
+    res.AddMember(kFieldNameCorrelationKey, key.toString(), res.GetAllocator());
+
+    std::unique_ptr<rtRemoteEndPoint> tempEndPoint(rtRemoteEndPoint::fromString(
+      replyTo->value.GetString()));
+    sockaddr_storage replyToAddress = tempEndPoint->toSockAddr();
+
+    return rtSendDocument(res, m_ucast_fd, &replyToAddress);
+  }
+
   auto itr = m_hosted_objects.end();
 
   char const* objectId = rtMessage_GetObjectId(*doc);
+  if (objectId == nullptr)
+    return RT_ERROR_INVALID_ARG;
 
   std::unique_lock<std::mutex> lock(m_mutex);
   itr = m_hosted_objects.find(objectId);
@@ -423,14 +472,152 @@ rtRemoteMulticastResolver::onLocate(rtRemoteMessagePtr const& doc, sockaddr_stor
 {
   rtRemoteCorrelationKey key = rtMessage_GetCorrelationKey(*doc);
 
-  std::unique_lock<std::mutex> lock(m_mutex);
-  m_pending_searches[key] = doc;
-  lock.unlock();
-  m_cond.notify_all();
+  if (m_pending_searches.complete(key, doc))
+    return RT_OK;
+
+  std::shared_ptr<PendingBatch> batch;
+  {
+    std::unique_lock<std::mutex> lock(m_batch_mutex);
+    auto itr = m_pending_batches.find(key);
+    if (itr != m_pending_batches.end())
+      batch = itr->second;
+  }
+
+  // otherwise a late or duplicate reply
+  if (batch)
+    return onBatchLocate(batch, doc);
 
   return RT_OK;
 }
 
+rtError
+rtRemoteMulticastResolver::onBatchLocate(std::shared_ptr<PendingBatch> const& batch,
+  rtRemoteMessagePtr const& doc)
+{
+  auto rpc_endpoint = doc->FindMember(kFieldNameEndPoint);
+  if (rpc_endpoint == doc->MemberEnd())
+    return RT_ERROR_INVALID_ARG;
+
+  std::unique_ptr<rtRemoteEndPoint> e(rtRemoteEndPoint::fromString(rpc_endpoint->value.GetString()));
+  if (!e)
+    return RT_ERROR_INVALID_ARG;
+  sockaddr_storage const endpoint = e->toSockAddr();
+
+  std::unique_lock<std::mutex> lock(batch->Mutex);
+
+  // hosts that don't know about batched searches answer for object.id only
+  auto ids = doc->FindMember(kFieldNameObjectIds);
+  if (ids != doc->MemberEnd() && ids->value.IsArray())
+  {
+    for (rapidjson::Value::ConstValueIterator id = ids->value.Begin(); id != ids->value.End(); ++id)
+    {
+      if (id->IsString())
+        batch->Found[id->GetString()] = endpoint;
+    }
+  }
+  else if (char const* objectId = rtMessage_GetObjectId(*doc))
+  {
+    batch->Found[objectId] = endpoint;
+  }
+
+  lock.unlock();
+  batch->Cond.notify_all();
+  return RT_OK;
+}
+
+rtError
+rtRemoteMulticastResolver::sendSearch(rtRemoteCorrelationKey const& seqId,
+  std::vector<std::string> const& names)
+{
+  rapidjson::Document doc;
+  doc.SetObject();
+  doc.AddMember(kFieldNameMessageType, kMessageTypeSearch, doc.GetAllocator());
+  doc.AddMember(kFieldNameObjectId, names.front(), doc.GetAllocator());
+
+  rapidjson::Value ids(rapidjson::kArrayType);
+  for (std::string const& name : names)
+    ids.PushBack(rapidjson::Value(name.c_str(), name.size(), doc.GetAllocator()), doc.GetAllocator());
+  doc.AddMember(kFieldNameObjectIds, ids, doc.GetAllocator());
+
+  doc.AddMember(kFieldNameSenderId, m_pid, doc.GetAllocator());
+  doc.AddMember(kFieldNameCorrelationKey, seqId.toString(), doc.GetAllocator());
+
+  std::unique_ptr<rtRemoteIPEndPoint> responseEndpoint(rtRemoteIPEndPoint::
+    fromSockAddr("udp", m_ucast_endpoint));
+  doc.AddMember(kFieldNameReplyTo, responseEndpoint->toString(), doc.GetAllocator());
+
+  return rtSendDocument(doc, m_ucast_fd, &m_mcast_dest);
+}
+
+rtError
+rtRemoteMulticastResolver::locateObjects(std::vector<std::string> const& names,
+  std::map<std::string, sockaddr_storage>& endpoints, uint32_t timeout)
+{
+  if (m_ucast_fd == -1)
+  {
+    rtLogError("unicast socket not opened");
+    return RT_FAIL;
+  }
+
+  if (names.empty())
+    return RT_OK;
+
+  rtRemoteCorrelationKey seqId = rtMessage_GetNextCorrelationKey();
+  std::shared_ptr<PendingBatch> batch(new PendingBatch());
+  {
+    std::unique_lock<std::mutex> lock(m_batch_mutex);
+    m_pending_batches[seqId] = batch;
+  }
+
+  using namespace std::chrono;
+  auto const maxInterval = milliseconds(m_env->Config->resolver_spin_max_ms());
+  auto interval = milliseconds(m_env->Config->resolver_spin_init_ms());
+  auto const deadline = steady_clock::now() + milliseconds(timeout);
+
+  rtError err = RT_OK;
+  std::vector<std::string> missing(names);
+  while (true)
+  {
+    // retransmits only ask for what is still missing
+    err = sendSearch(seqId, missing);
+    if (err != RT_OK)
+      break;
+
+    auto const retry = std::min(steady_clock::now() + jitter(interval), deadline);
+
+    std::unique_lock<std::mutex> lock(batch->Mutex);
+    batch->Cond.wait_until(lock, retry, [&batch, &missing]
+    {
+      missing.erase(std::remove_if(missing.begin(), missing.end(), [&batch](std::string const& name)
+        { return batch->Found.find(name) != batch->Found.end(); }), missing.end());
+      return missing.empty();
+    });
+    lock.unlock();
+
+    if (missing.empty() || steady_clock::now() >= deadline)
+      break;
+
+    interval = std::min(interval * 2, maxInterval);
+  }
+
+  {
+    std::unique_lock<std::mutex> lock(m_batch_mutex);
+    m_pending_batches.erase(seqId);
+  }
+
+  std::unique_lock<std::mutex> lock(batch->Mutex);
+  for (std::string const& name : names)
+  {
+    auto itr = batch->Found.find(name);
+    if (itr != batch->Found.end())
+      endpoints[name] = itr->second;
+  }
+
+  if (err != RT_OK)
+    return err;
+  return missing.empty() ? RT_OK : RT_ERROR_TIMEOUT;
+}
+
 rtError
 rtRemoteMulticastResolver::locateObject(std::string const& name, sockaddr_storage& endpoint, uint32_t timeout)
 {
@@ -22,9 +22,11 @@ limitations under the License.
 #include "rtRemoteConfig.h"
 #include "rtRemoteEnvironment.h"
 
+#include <algorithm>
 #include <condition_variable>
 #include <thread>
 #include <mutex>
+#include <utility>
 
 #include <rtLog.h>
 
@@ -63,6 +65,8 @@ rtRemoteNameService::rtRemoteNameService(rtRemoteEnvironment* env)
   m_command_handlers.insert(CommandHandlerMap::value_type(kNsMessageTypeDeregister, &rtRemoteNameService::onDeregister));
   m_command_handlers.insert(CommandHandlerMap::value_type(kNsMessageTypeUpdate, &rtRemoteNameService::onUpdate));
   m_command_handlers.insert(CommandHandlerMap::value_type(kNsMessageTypeLookup, &rtRemoteNameService::onLookup));
+  m_command_handlers.insert(CommandHandlerMap::value_type(kNsMessageTypeSubscribe, &rtRemoteNameService::onSubscribe));
+  m_command_handlers.insert(CommandHandlerMap::value_type(kNsMessageTypeUnsubscribe, &rtRemoteNameService::onUnsubscribe));
 
   m_shutdown_pipe[0] = -1;
   m_shutdown_pipe[1] = -1;
@@ -193,100 +197,409 @@ rtRemoteNameService::openNsSocket()
   return RT_OK;
 }
 
+std::chrono::milliseconds
+rtRemoteNameService::leaseFrom(rtRemoteMessagePtr const& doc) const
+{
+  auto itr = doc->FindMember(kFieldNameLease);
+  if (itr != doc->MemberEnd() && itr->value.IsUint() && itr->value.GetUint() > 0)
+    return std::chrono::milliseconds(itr->value.GetUint());
+  return std::chrono::milliseconds(m_env->Config->resolver_unicast_lease_ms());
+}
+
+std::string
+rtRemoteNameService::renderLookupResponse(char const* objectId, sockaddr_storage const& endpoint)
+{
+  uint16_t ep_port = 0;
+  rtGetPort(endpoint, &ep_port);
+
+  rapidjson::Document doc;
+  doc.SetObject();
+  doc.AddMember(kFieldNameMessageType, kNsMessageTypeLookupResponse, doc.GetAllocator());
+  doc.AddMember(kFieldNameStatusMessage, kNsStatusSuccess, doc.GetAllocator());
+  doc.AddMember(kFieldNameObjectId, std::string(objectId), doc.GetAllocator());
+  doc.AddMember(kFieldNameIp, rtSocketAddressToString(endpoint), doc.GetAllocator());
+  doc.AddMember(kFieldNamePort, ep_port, doc.GetAllocator());
+
+  rapidjson::StringBuffer out;
+  rapidjson::Writer<rapidjson::StringBuffer> writer(out);
+  doc.Accept(writer);
+
+  // drop the closing brace, onLookup appends the per-request fields
+  std::string response(out.GetString(), out.GetSize());
+  response.pop_back();
+  return response;
+}
+
+rtError
+rtRemoteNameService::sendStatus(char const* messageType, rtRemoteMessagePtr const& req, bool success,
+  sockaddr_storage const& soc)
+{
+  char const* objectId = rtMessage_GetObjectId(*req);
+
+  rapidjson::Document doc;
+  doc.SetObject();
+  doc.AddMember(kFieldNameMessageType, rapidjson::StringRef(messageType), doc.GetAllocator());
+  doc.AddMember(kFieldNameStatusMessage, rapidjson::StringRef(success ? kNsStatusSuccess : kNsStatusFail),
+    doc.GetAllocator());
+  if (objectId)
+    doc.AddMember(kFieldNameObjectId, std::string(objectId), doc.GetAllocator());
+  doc.AddMember(kFieldNameCorrelationKey, rtMessage_GetCorrelationKey(*req).toString(), doc.GetAllocator());
+  return rtSendDocument(doc, m_ns_fd, &soc);
+}
+
 /**
  * Callback for registering objects and associated Well-known Endpoints
  */
 rtError
-rtRemoteNameService::onRegister(rtRemoteMessagePtr const& doc, sockaddr_storage const& /*soc*/)
+rtRemoteNameService::onRegister(rtRemoteMessagePtr const& doc, sockaddr_storage const& soc)
 {
-  RT_ASSERT(doc->HasMember(kFieldNameIp));
-  RT_ASSERT(doc->HasMember(kFieldNamePort));
-  
-  sockaddr_storage endpoint;
-  rtError err = rtParseAddress(endpoint, (*doc)[kFieldNameIp].GetString(),
-                (*doc)[kFieldNamePort].GetInt(), nullptr);
+  char const* objectId = rtMessage_GetObjectId(*doc);
+  if (!objectId)
+  {
+    sendStatus(kNsMessageTypeRegisterResponse, doc, false, soc);
+    return RT_ERROR_INVALID_ARG;
+  }
 
+  Registration reg;
+  rtError err = rtMessage_GetEndpoint(*doc, reg.Endpoint);
   if (err != RT_OK)
+  {
+    rtLogWarn("bad endpoint in registration of %s", objectId);
+    sendStatus(kNsMessageTypeRegisterResponse, doc, false, soc);
     return err;
-  
-  char const* objectId = rtMessage_GetObjectId(*doc);
-  
+  }
+
+  reg.Expires = std::chrono::steady_clock::now() + leaseFrom(doc);
+  reg.Response = renderLookupResponse(objectId, reg.Endpoint);
+
+  sockaddr_storage const endpoint = reg.Endpoint;
+
   std::unique_lock<std::mutex> lock(m_mutex);
-  m_registered_objects[objectId] = endpoint;
+  m_registered_objects[objectId] = std::move(reg);
   lock.unlock();
-  return RT_OK;
+
+  err = sendStatus(kNsMessageTypeRegisterResponse, doc, true, soc);
+  notify(kNsEventRegister, objectId, &endpoint);
+  return err;
 }
 
 /**
  * Callback for deregistering objects
  */
 rtError
-rtRemoteNameService::onDeregister(rtRemoteMessagePtr const& /*doc*/, sockaddr_storage const& /*soc*/)
+rtRemoteNameService::onDeregister(rtRemoteMessagePtr const& doc, sockaddr_storage const& soc)
 {
-  // TODO
-  return RT_OK;
+  char const* objectId = rtMessage_GetObjectId(*doc);
+  if (!objectId)
+    return RT_ERROR_INVALID_ARG;
+
+  std::unique_lock<std::mutex> lock(m_mutex);
+  bool const found = m_registered_objects.erase(objectId) != 0;
+  lock.unlock();
+
+  rtError err = sendStatus(kNsMessageTypeDeregisterResponse, doc, found, soc);
+  if (found)
+    notify(kNsEventDeregister, objectId, nullptr);
+  return err;
 }
 
+/**
+ * Renews the lease on a registration. If ip and port are present the
+ * endpoint is replaced too. Fails for unknown objects, the owner is
+ * expected to register again.
+ */
 rtError
-rtRemoteNameService::onUpdate(rtRemoteMessagePtr const& /*doc*/, sockaddr_storage const& /*soc*/)
+rtRemoteNameService::onUpdate(rtRemoteMessagePtr const& doc, sockaddr_storage const& soc)
 {
-  // TODO
-  return RT_OK;
+  char const* objectId = rtMessage_GetObjectId(*doc);
+  if (!objectId)
+    return RT_ERROR_INVALID_ARG;
+
+  sockaddr_storage endpoint;
+  bool const moved = doc->HasMember(kFieldNameIp) && doc->HasMember(kFieldNamePort);
+  if (moved)
+  {
+    rtError err = rtMessage_GetEndpoint(*doc, endpoint);
+    if (err != RT_OK)
+    {
+      rtLogWarn("bad endpoint in update of %s", objectId);
+      sendStatus(kNsMessageTypeUpdateResponse, doc, false, soc);
+      return err;
+    }
+  }
+
+  std::unique_lock<std::mutex> lock(m_mutex);
+  auto itr = m_registered_objects.find(objectId);
+  bool const found = itr != m_registered_objects.end();
+  if (found)
+  {
+    itr->second.Expires = std::chrono::steady_clock::now() + leaseFrom(doc);
+    if (moved)
+    {
+      itr->second.Endpoint = endpoint;
+      itr->second.Response = renderLookupResponse(objectId, endpoint);
+    }
+  }
+  lock.unlock();
+
+  rtError err = sendStatus(kNsMessageTypeUpdateResponse, doc, found, soc);
+  if (found && moved)
+    notify(kNsEventRegister, objectId, &endpoint);
+  return err;
 }
 
 rtError
 rtRemoteNameService::onLookup(rtRemoteMessagePtr const& doc, sockaddr_storage const& soc)
 {
   auto senderId = doc->FindMember(kFieldNameSenderId);
-  RT_ASSERT(senderId != doc->MemberEnd());
+  if (senderId == doc->MemberEnd() || !senderId->value.IsInt())
+    return RT_ERROR_INVALID_ARG;
   if (senderId->value.GetInt() == m_pid)
     return RT_OK;
 
-  rtRemoteCorrelationKey key = rtMessage_GetCorrelationKey(*doc);
-
-  auto itr = m_registered_objects.end();
+  auto ids = doc->FindMember(kNsFieldNameObjectIds);
+  if (ids != doc->MemberEnd())
+    return onLookupMany(doc, ids->value, soc);
 
   char const* objectId = rtMessage_GetObjectId(*doc);
+  if (!objectId)
+    return RT_ERROR_INVALID_ARG;
+
+  std::string response;
+  {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    auto itr = m_registered_objects.find(objectId);
+    if (itr != m_registered_objects.end() && itr->second.Expires > std::chrono::steady_clock::now())
+      response = itr->second.Response;
+  }
+
+  // say so, rather than leave the caller to time out, so it can cache the miss
+  if (response.empty())
+    return sendStatus(kNsMessageTypeLookupResponse, doc, false, soc);
+
+  // only the sender and correlation key differ between lookups of the same object
+  auto key = doc->FindMember(kFieldNameCorrelationKey);
+  if (key == doc->MemberEnd() || !key->value.IsString())
+    return RT_ERROR_INVALID_ARG;
+
+  // the writer escapes the key, whatever the sender put in it
+  rapidjson::StringBuffer tail;
+  rapidjson::Writer<rapidjson::StringBuffer> writer(tail);
+  writer.StartObject();
+  writer.Key(kFieldNameSenderId);
+  writer.Int(senderId->value.GetInt());
+  writer.Key(kFieldNameCorrelationKey);
+  writer.String(key->value.GetString(), key->value.GetStringLength());
+  writer.EndObject();
+
+  // splice its members in after the cached ones, dropping its opening brace
+  response += ',';
+  response.append(tail.GetString() + 1, tail.GetSize() - 1);
+
+  socklen_t len;
+  rtSocketGetLength(soc, &len);
+  ssize_t ret = sendto(m_ns_fd, response.data(), response.size(), 0,
+    reinterpret_cast<sockaddr const *>(&soc), len);
+  if (ret < 0)
+    return rtErrorFromErrno(errno);
+  return RT_OK;
+}
+
+/**
+ * Looks up every name in ns.object.ids at once. The reply lists the ones
+ * that are registered in ns.objects, each with object.id, ip and port.
+ * Names left out aren't registered.
+ */
+rtError
+rtRemoteNameService::onLookupMany(rtRemoteMessagePtr const& doc, rapidjson::Value const& ids,
+  sockaddr_storage const& soc)
+{
+  if (!ids.IsArray() || ids.Size() > kNsMaxLookupBatch)
+  {
+    rtLogWarn("bad %s in lookup", kNsFieldNameObjectIds);
+    return RT_ERROR_INVALID_ARG;
+  }
+
+  rapidjson::Document res;
+  res.SetObject();
+  res.AddMember(kFieldNameMessageType, kNsMessageTypeLookupResponse, res.GetAllocator());
+  res.AddMember(kFieldNameStatusMessage, kNsStatusSuccess, res.GetAllocator());
+
+  rapidjson::Value objects(rapidjson::kArrayType);
+  {
+    auto const now = std::chrono::steady_clock::now();
+
+    std::unique_lock<std::mutex> lock(m_mutex);
+    for (rapidjson::Value::ConstValueIterator id = ids.Begin(); id != ids.End(); ++id)
+    {
+      if (!id->IsString())
+        continue;
+
+      auto itr = m_registered_objects.find(id->GetString());
+      if (itr == m_registered_objects.end() || itr->second.Expires <= now)
+        continue;
+
+      uint16_t port = 0;
+      rtGetPort(itr->second.Endpoint, &port);
+
+      rapidjson::Value object(rapidjson::kObjectType);
+      object.AddMember(kFieldNameObjectId, itr->first, res.GetAllocator());
+      object.AddMember(kFieldNameIp, rtSocketAddressToString(itr->second.Endpoint), res.GetAllocator());
+      object.AddMember(kFieldNamePort, port, res.GetAllocator());
+      objects.PushBack(object, res.GetAllocator());
+    }
+  }
+
+  res.AddMember(kNsFieldNameObjects, objects, res.GetAllocator());
+  res.AddMember(kFieldNameSenderId, (*doc)[kFieldNameSenderId].GetInt(), res.GetAllocator());
+  res.AddMember(kFieldNameCorrelationKey, rtMessage_GetCorrelationKey(*doc).toString(), res.GetAllocator());
+  return rtSendDocument(res, m_ns_fd, &soc);
+}
+
+void
+rtRemoteNameService::purgeExpired()
+{
+  auto const now = std::chrono::steady_clock::now();
+  std::vector<std::string> expired;
 
   std::unique_lock<std::mutex> lock(m_mutex);
-  itr = m_registered_objects.find(objectId);
+  for (auto itr = m_registered_objects.begin(); itr != m_registered_objects.end();)
+  {
+    if (itr->second.Expires <= now)
+    {
+      rtLogInfo("lease expired for %s", itr->first.c_str());
+      expired.push_back(itr->first);
+      itr = m_registered_objects.erase(itr);
+    }
+    else
+    {
+      ++itr;
+    }
+  }
+
+  m_subscriptions.erase(std::remove_if(m_subscriptions.begin(), m_subscriptions.end(),
+    [now](Subscription const& sub) { return sub.Expires <= now; }), m_subscriptions.end());
   lock.unlock();
 
-  if (itr != m_registered_objects.end())
-  { // object is registered
-
-    // get IP and port
-    sockaddr_storage endpoint = itr->second;
-    std::string       ep_addr;
-    uint16_t          ep_port;
-    char buff[128];
-
-    void* addr = nullptr;
-    rtGetInetAddr(endpoint, &addr);
-
-    socklen_t len;
-    rtSocketGetLength(endpoint, &len);
-    char const* p = inet_ntop(endpoint.ss_family, addr, buff, len);
-    if (p)
-      ep_addr = p;
-    rtGetPort(endpoint, &ep_port);
-
-    // create and send response
-    rapidjson::Document doc;
-    doc.SetObject();
-    doc.AddMember(kFieldNameMessageType, kNsMessageTypeLookupResponse, doc.GetAllocator());
-    doc.AddMember(kFieldNameStatusMessage, kNsStatusSuccess, doc.GetAllocator());
-    doc.AddMember(kFieldNameObjectId, std::string(objectId), doc.GetAllocator());
-    doc.AddMember(kFieldNameIp, ep_addr, doc.GetAllocator());
-    doc.AddMember(kFieldNamePort, ep_port, doc.GetAllocator());
-    doc.AddMember(kFieldNameSenderId, senderId->value.GetInt(), doc.GetAllocator());
-    doc.AddMember(kFieldNameCorrelationKey, key.toString(), doc.GetAllocator());
+  for (std::string const& name : expired)
+    notify(kNsEventDeregister, name, nullptr);
+}
 
-    return rtSendDocument(doc, m_ns_fd, &soc);
+/**
+ * Subscribes the sender to register and deregister events for object.id,
+ * or for every name starting with it if ns.prefix is true. The current
+ * matches are sent as register events, on renewal as well.
+ */
+rtError
+rtRemoteNameService::onSubscribe(rtRemoteMessagePtr const& doc, sockaddr_storage const& soc)
+{
+  char const* pattern = rtMessage_GetObjectId(*doc);
+  if (!pattern)
+  {
+    sendStatus(kNsMessageTypeSubscribeResponse, doc, false, soc);
+    return RT_ERROR_INVALID_ARG;
+  }
+
+  Subscription sub;
+  sub.Pattern = pattern;
+  sub.Subscriber = soc;
+  sub.Expires = std::chrono::steady_clock::now() + leaseFrom(doc);
+
+  auto prefix = doc->FindMember(kNsFieldNamePrefix);
+  sub.Prefix = prefix != doc->MemberEnd() && prefix->value.IsBool() && prefix->value.GetBool();
+
+  bool renewed = false;
+  std::vector< std::pair<std::string, sockaddr_storage> > current;
+
+  std::unique_lock<std::mutex> lock(m_mutex);
+  for (Subscription& s : m_subscriptions)
+  {
+    if (s.Pattern == sub.Pattern && s.Prefix == sub.Prefix && rtSocketToString(s.Subscriber) == rtSocketToString(soc))
+    {
+      s.Expires = sub.Expires;
+      renewed = true;
+      break;
+    }
   }
+  if (!renewed)
+    m_subscriptions.push_back(sub);
+
+  // renewals get the matches too, the subscriber expires anything that
+  // isn't sent again
+  auto itr = sub.Prefix ? m_registered_objects.lower_bound(sub.Pattern) : m_registered_objects.find(sub.Pattern);
+  for (; itr != m_registered_objects.end() && sub.matches(itr->first); ++itr)
+  {
+    current.push_back(std::make_pair(itr->first, itr->second.Endpoint));
+    if (!sub.Prefix)
+      break;
+  }
+  lock.unlock();
+
+  rtError err = sendStatus(kNsMessageTypeSubscribeResponse, doc, true, soc);
+  for (auto const& obj : current)
+    sendEvent(kNsEventRegister, obj.first, &obj.second, soc);
+  return err;
+}
+
+rtError
+rtRemoteNameService::onUnsubscribe(rtRemoteMessagePtr const& doc, sockaddr_storage const& soc)
+{
+  char const* pattern = rtMessage_GetObjectId(*doc);
+  if (!pattern)
+    return RT_ERROR_INVALID_ARG;
+
+  std::string const subscriber = rtSocketToString(soc);
+
+  std::unique_lock<std::mutex> lock(m_mutex);
+  m_subscriptions.erase(std::remove_if(m_subscriptions.begin(), m_subscriptions.end(),
+    [pattern, &subscriber](Subscription const& sub)
+    {
+      return sub.Pattern == pattern && rtSocketToString(sub.Subscriber) == subscriber;
+    }), m_subscriptions.end());
   return RT_OK;
 }
 
+void
+rtRemoteNameService::notify(char const* event, std::string const& objectId, sockaddr_storage const* endpoint)
+{
+  std::vector<sockaddr_storage> subscribers;
+  {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    for (Subscription const& sub : m_subscriptions)
+    {
+      if (sub.matches(objectId))
+        subscribers.push_back(sub.Subscriber);
+    }
+  }
+
+  for (sockaddr_storage const& subscriber : subscribers)
+  {
+    rtError e = sendEvent(event, objectId, endpoint, subscriber);
+    if (e != RT_OK)
+      rtLogWarn("failed to send %s event to %s. %s", event, rtSocketToString(subscriber).c_str(), rtStrError(e));
+  }
+}
+
+rtError
+rtRemoteNameService::sendEvent(char const* event, std::string const& objectId,
+  sockaddr_storage const* endpoint, sockaddr_storage const& subscriber)
+{
+  rapidjson::Document doc;
+  doc.SetObject();
+  doc.AddMember(kFieldNameMessageType, kNsMessageTypeEvent, doc.GetAllocator());
+  doc.AddMember(kNsFieldNameEvent, rapidjson::StringRef(event), doc.GetAllocator());
+  doc.AddMember(kFieldNameObjectId, objectId, doc.GetAllocator());
+  if (endpoint)
+  {
+    uint16_t port = 0;
+    rtGetPort(*endpoint, &port);
+    doc.AddMember(kFieldNameIp, rtSocketAddressToString(*endpoint), doc.GetAllocator());
+    doc.AddMember(kFieldNamePort, port, doc.GetAllocator());
+  }
+  doc.AddMember(kFieldNameCorrelationKey, rtMessage_GetNextCorrelationKey().toString(), doc.GetAllocator());
+  return rtSendDocument(doc, m_ns_fd, &subscriber);
+}
+
 void
 rtRemoteNameService::runListener()
 {
@@ -294,9 +607,11 @@ rtRemoteNameService::runListener()
   buff.reserve(1024 * 1024);
   buff.resize(1024 * 1024);
 
+  auto const purgeInterval = std::chrono::milliseconds(m_env->Config->resolver_unicast_purge_interval_ms());
+  auto nextPurge = std::chrono::steady_clock::now() + purgeInterval;
+
   while (true)
   {
-    rtLogInfo("listening");
     int maxFd = 0;
 
     fd_set read_fds;
@@ -309,7 +624,19 @@ rtRemoteNameService::runListener()
     FD_ZERO(&err_fds);
     rtPushFd(&err_fds, m_ns_fd, &maxFd);
 
-    int ret = select(maxFd + 1, &read_fds, NULL, &err_fds, NULL);
+    auto now = std::chrono::steady_clock::now();
+    if (now >= nextPurge)
+    {
+      purgeExpired();
+      nextPurge = now + purgeInterval;
+    }
+
+    timeval timeout;
+    auto wait = std::chrono::duration_cast<std::chrono::microseconds>(nextPurge - now).count();
+    timeout.tv_sec = wait / 1000000;
+    timeout.tv_usec = wait % 1000000;
+
+    int ret = select(maxFd + 1, &read_fds, NULL, &err_fds, &timeout);
     if (ret == -1)
     {
       rtError e = rtErrorFromErrno(errno);
@@ -359,6 +686,12 @@ rtRemoteNameService::doDispatch(char const* buff, int n, sockaddr_storage* peer)
   if (err != RT_OK)
     return;
 
+  if (!rtMessage_IsWellFormed(*doc))
+  {
+    rtLogWarn("dropping malformed message from %s", rtSocketToString(*peer).c_str());
+    return;
+  }
+
   char const* message_type = rtMessage_GetMessageType(*doc);
 
   auto itr = m_command_handlers.find(message_type);
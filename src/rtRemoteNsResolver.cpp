@@ -22,7 +22,9 @@ limitations under the License.
 #include "rtRemoteConfig.h"
 #include "rtRemoteEnvironment.h"
 
-#include <condition_variable>
+#include <algorithm>
+#include <chrono>
+#include <sstream>
 #include <thread>
 #include <mutex>
 
@@ -59,6 +61,11 @@ rtRemoteNsResolver::rtRemoteNsResolver(rtRemoteEnvironment* env)
   memset(&m_static_endpoint, 0, sizeof(m_static_endpoint));
 
   m_command_handlers.insert(CommandHandlerMap::value_type(kNsMessageTypeLookupResponse, &rtRemoteNsResolver::onLocate));
+  m_command_handlers.insert(CommandHandlerMap::value_type(kNsMessageTypeRegisterResponse, &rtRemoteNsResolver::onLocate));
+  m_command_handlers.insert(CommandHandlerMap::value_type(kNsMessageTypeDeregisterResponse, &rtRemoteNsResolver::onLocate));
+  m_command_handlers.insert(CommandHandlerMap::value_type(kNsMessageTypeUpdateResponse, &rtRemoteNsResolver::onUpdateResponse));
+  m_command_handlers.insert(CommandHandlerMap::value_type(kNsMessageTypeSubscribeResponse, &rtRemoteNsResolver::onSubscribeResponse));
+  m_command_handlers.insert(CommandHandlerMap::value_type(kNsMessageTypeEvent, &rtRemoteNsResolver::onEvent));
 
   m_shutdown_pipe[0] = -1; m_shutdown_pipe[1] = -1;
   
@@ -80,15 +87,7 @@ rtRemoteNsResolver::~rtRemoteNsResolver()
 rtError
 rtRemoteNsResolver::open(sockaddr_storage const& rpc_endpoint)
 {
-  char buff[128];
-  void* addr = nullptr;
-  rtGetInetAddr(rpc_endpoint, &addr);
-  
-  socklen_t len;
-  rtSocketGetLength(rpc_endpoint, &len);
-  char const* p = inet_ntop(rpc_endpoint.ss_family, addr, buff, len);
-  if (p)
-    m_rpc_addr = p;
+  m_rpc_addr = rtSocketAddressToString(rpc_endpoint);
   rtGetPort(rpc_endpoint, &m_rpc_port);
 
   rtError err = init();
@@ -106,6 +105,27 @@ rtRemoteNsResolver::open(sockaddr_storage const& rpc_endpoint)
   }
 
   m_read_thread.reset(new std::thread(&rtRemoteNsResolver::runListener, this));
+
+  // names to have pushed rather than looked up, e.g. "com.acme.*,display"
+  std::stringstream patterns(m_env->Config->resolver_unicast_subscribe());
+  std::string pattern;
+  while (std::getline(patterns, pattern, ','))
+  {
+    pattern.erase(0, pattern.find_first_not_of(" \t"));
+    pattern.erase(pattern.find_last_not_of(" \t") + 1);
+
+    bool const prefix = !pattern.empty() && pattern.back() == '*';
+    if (prefix)
+      pattern.pop_back();
+    if (pattern.empty() && !prefix)
+      continue;
+
+    rtLogInfo("subscribing to %s%s", pattern.c_str(), prefix ? "*" : "");
+    err = subscribe(pattern, prefix);
+    if (err != RT_OK)
+      rtLogWarn("failed to subscribe to %s. %s", pattern.c_str(), rtStrError(err));
+  }
+
   return RT_OK;
 
 }
@@ -113,7 +133,23 @@ rtRemoteNsResolver::open(sockaddr_storage const& rpc_endpoint)
 rtError
 rtRemoteNsResolver::registerObject(std::string const& name, sockaddr_storage const& endpoint)
 {
-    return registerObject(name, endpoint, 3000);
+  if (m_static_fd == -1)
+  {
+    rtLogError("unicast socket not opened");
+    return RT_FAIL;
+  }
+
+  // don't wait for the name service, it may not be running yet. the
+  // heartbeat renews the lease and registers again once it answers.
+  {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_hosted_objects[name] = endpoint;
+  }
+
+  rtError err = sendRegistration(kNsMessageTypeRegister, name, endpoint, rtMessage_GetNextCorrelationKey());
+  if (err != RT_OK)
+    rtLogWarn("failed to send registration for %s, will retry. %s", name.c_str(), rtStrError(err));
+  return RT_OK;
 }
 
 rtError
@@ -125,80 +161,45 @@ rtRemoteNsResolver::registerObject(std::string const& name, sockaddr_storage con
     return RT_FAIL;
   }
 
-  std::string rpc_addr;
-  uint16_t rpc_port;
-  char buff[128];
-  void* addr = nullptr;
-  rtGetInetAddr(endpoint, &addr);
-  
-  socklen_t len;
-  rtSocketGetLength(endpoint, &len);
-  char const* p = inet_ntop(endpoint.ss_family, addr, buff, len);
-  if (p)
-    rpc_addr = p;
-  rtGetPort(endpoint, &rpc_port);
+  // keep the lease alive from now on, even if this attempt times out
+  {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_hosted_objects[name] = endpoint;
+  }
 
   rtError err = RT_OK;
   rtRemoteCorrelationKey seqId = rtMessage_GetNextCorrelationKey();
 
-  rapidjson::Document doc;
-  doc.SetObject();
-  doc.AddMember(kFieldNameMessageType, kNsMessageTypeRegister, doc.GetAllocator());
-  doc.AddMember(kFieldNameObjectId, name, doc.GetAllocator());
-  doc.AddMember(kFieldNameIp, rpc_addr, doc.GetAllocator());
-  doc.AddMember(kFieldNamePort, rpc_port, doc.GetAllocator());
-  doc.AddMember(kFieldNameSenderId, m_pid, doc.GetAllocator());
-  doc.AddMember(kFieldNameCorrelationKey, seqId.toString(), doc.GetAllocator());
-
-  err = rtSendDocument(doc, m_static_fd, &m_ns_dest);
+  std::future<rtRemoteMessagePtr> reply = m_pending_searches.add(seqId);
+  err = sendRegistration(kNsMessageTypeRegister, name, endpoint, seqId);
   if (err != RT_OK)
+  {
+    m_pending_searches.remove(seqId);
     return err;
+  }
 
   rtRemoteMessagePtr searchResponse;
-  RequestMap::const_iterator itr;
-
-  auto delay = std::chrono::system_clock::now() + std::chrono::milliseconds(timeout);
-
-  // wait here until timeout expires or we get a response that matches out pid/seqid
-  std::unique_lock<std::mutex> lock(m_mutex);
-  itr = m_pending_searches.end();
-  m_cond.wait_until(lock, delay, [this, seqId, &searchResponse]
-    {
-      auto itr = this->m_pending_searches.find(seqId);
-      if (itr != this->m_pending_searches.end())
-      {
-        searchResponse = itr->second;
-        this->m_pending_searches.erase(itr);
-      }
-      return searchResponse != nullptr;
-    });
-  lock.unlock();
+  if (reply.wait_for(std::chrono::milliseconds(timeout)) == std::future_status::ready)
+    searchResponse = reply.get();
+  else
+    m_pending_searches.remove(seqId);
 
   if (!searchResponse)
+    return RT_ERROR_TIMEOUT;
+
+  char const* message_type = rtMessage_GetMessageType(*searchResponse);
+  if (strcmp(message_type, kNsMessageTypeRegisterResponse) != 0)
+  {
+    rtLogWarn("unexpected response to lookup request. %s", message_type);
     return RT_FAIL;
+  }
 
-  // response is in itr
-  if (searchResponse)
+  if (strcmp(rtMessage_GetStatusMessage(*searchResponse), kNsStatusFail) == 0)
   {
-    char const* message_type = rtMessage_GetMessageType(*searchResponse);
-    
-    if (strcmp(message_type, kNsMessageTypeRegisterResponse) == 0)
-    {    
-      if (strcmp(rtMessage_GetStatusMessage(*searchResponse), kNsStatusFail) == 0)
-      {
-        rtLogWarn("ns register failed");
-        return RT_FAIL;
-      }
-      else
-      {
-        return RT_OK;
-      }
-    }
-    else
-    {
-      rtLogWarn("unexpected response to lookup request. %s", message_type);
-      return RT_FAIL;
-    }
+    rtLogWarn("ns register failed");
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_hosted_objects.erase(name);
+    return RT_FAIL;
   }
 
   return RT_OK;
@@ -214,6 +215,20 @@ rtRemoteNsResolver::locateObject(std::string const& name, sockaddr_storage& endp
     return RT_FAIL;
   }
 
+  {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    auto itr = m_known_objects.find(name);
+    if (itr != m_known_objects.end())
+    {
+      if (itr->second.Expires > std::chrono::steady_clock::now())
+      {
+        endpoint = itr->second.Endpoint;
+        return RT_OK;
+      }
+      m_known_objects.erase(itr);
+    }
+  }
+
   rtError err = RT_OK;
   rtRemoteCorrelationKey seqId = rtMessage_GetNextCorrelationKey();
 
@@ -224,35 +239,25 @@ rtRemoteNsResolver::locateObject(std::string const& name, sockaddr_storage& endp
   doc.AddMember(kFieldNameSenderId, m_pid, doc.GetAllocator());
   doc.AddMember(kFieldNameCorrelationKey, seqId.toString(), doc.GetAllocator());
 
+  std::future<rtRemoteMessagePtr> reply = m_pending_searches.add(seqId);
   err = rtSendDocument(doc, m_static_fd, &m_ns_dest);
   if (err != RT_OK)
+  {
+    m_pending_searches.remove(seqId);
     return err;
+  }
 
   rtRemoteMessagePtr searchResponse;
-  RequestMap::const_iterator itr;
-
-  auto delay = std::chrono::system_clock::now() + std::chrono::milliseconds(timeout);
+  if (reply.wait_for(std::chrono::milliseconds(timeout)) == std::future_status::ready)
+    searchResponse = reply.get();
+  else
+    m_pending_searches.remove(seqId);
 
-  // wait here until timeout expires or we get a response that matches out pid/seqid
-  std::unique_lock<std::mutex> lock(m_mutex);
-  itr = m_pending_searches.end();
-  
-  m_cond.wait_until(lock, delay, [this, seqId, &searchResponse]
-    {
-      auto itr = this->m_pending_searches.find(seqId);
-      if (itr != this->m_pending_searches.end())
-      {
-        searchResponse = itr->second;
-        this->m_pending_searches.erase(itr);
-      }
-      return searchResponse != nullptr;
-    });
-  lock.unlock();
 
   if (!searchResponse)
   {
     rtLogInfo("no search response");
-    return RT_FAIL;
+    return RT_ERROR_TIMEOUT;
   }
 
   // response is in itr
@@ -262,20 +267,20 @@ rtRemoteNsResolver::locateObject(std::string const& name, sockaddr_storage& endp
     
     if (strcmp(message_type, kNsMessageTypeLookupResponse) == 0)
     {    
-      if (strcmp(rtMessage_GetStatusMessage(*searchResponse), kNsStatusFail) == 0)
+      char const* status = rtMessage_GetStatusMessage(*searchResponse);
+      if (status && strcmp(status, kNsStatusFail) == 0)
       {
-        rtLogWarn("ns register failed");
-        return RT_FAIL;
+        rtLogDebug("%s isn't registered with the name service", name.c_str());
+        return RT_RESOURCE_NOT_FOUND;
       }
       else
       {
-        RT_ASSERT(searchResponse->HasMember(kFieldNameIp));
-        RT_ASSERT(searchResponse->HasMember(kFieldNamePort));
-        rtError err = rtParseAddress(endpoint, (*searchResponse)[kFieldNameIp].GetString(),
-          (*searchResponse)[kFieldNamePort].GetInt(), nullptr);
-        
+        rtError err = rtMessage_GetEndpoint(*searchResponse, endpoint);
         if (err != RT_OK)
+        {
+          rtLogWarn("bad endpoint in lookup response for %s", name.c_str());
           return err;
+        }
       }
     }
     else
@@ -288,6 +293,114 @@ rtRemoteNsResolver::locateObject(std::string const& name, sockaddr_storage& endp
   return RT_OK;
 }
 
+rtError
+rtRemoteNsResolver::locateObjects(std::vector<std::string> const& names,
+  std::map<std::string, sockaddr_storage>& endpoints, uint32_t timeout)
+{
+  if (m_static_fd == -1)
+  {
+    rtLogError("unicast socket not opened");
+    return RT_FAIL;
+  }
+
+  std::vector<std::string> remaining;
+  {
+    auto const now = std::chrono::steady_clock::now();
+
+    std::unique_lock<std::mutex> lock(m_mutex);
+    for (std::string const& name : names)
+    {
+      auto itr = m_known_objects.find(name);
+      if (itr != m_known_objects.end() && itr->second.Expires > now)
+        endpoints[name] = itr->second.Endpoint;
+      else
+        remaining.push_back(name);
+    }
+  }
+
+  if (remaining.empty())
+    return RT_OK;
+
+  rtError result = RT_OK;
+
+  using PendingLookup = std::pair< rtRemoteCorrelationKey, std::future<rtRemoteMessagePtr> >;
+  std::vector<PendingLookup> lookups;
+
+  for (size_t i = 0; i < remaining.size(); i += kNsMaxLookupBatch)
+  {
+    rtRemoteCorrelationKey seqId = rtMessage_GetNextCorrelationKey();
+
+    rapidjson::Document doc;
+    doc.SetObject();
+    doc.AddMember(kFieldNameMessageType, kNsMessageTypeLookup, doc.GetAllocator());
+
+    rapidjson::Value ids(rapidjson::kArrayType);
+    for (size_t j = i; j < remaining.size() && j < i + kNsMaxLookupBatch; ++j)
+      ids.PushBack(rapidjson::Value(remaining[j], doc.GetAllocator()), doc.GetAllocator());
+    doc.AddMember(kNsFieldNameObjectIds, ids, doc.GetAllocator());
+
+    doc.AddMember(kFieldNameSenderId, m_pid, doc.GetAllocator());
+    doc.AddMember(kFieldNameCorrelationKey, seqId.toString(), doc.GetAllocator());
+
+    std::future<rtRemoteMessagePtr> reply = m_pending_searches.add(seqId);
+    rtError err = rtSendDocument(doc, m_static_fd, &m_ns_dest);
+    if (err != RT_OK)
+    {
+      m_pending_searches.remove(seqId);
+      result = err;
+      continue;
+    }
+    lookups.push_back(PendingLookup(seqId, std::move(reply)));
+  }
+
+  auto const deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeout);
+  for (PendingLookup& lookup : lookups)
+  {
+    if (lookup.second.wait_until(deadline) != std::future_status::ready)
+    {
+      m_pending_searches.remove(lookup.first);
+      result = RT_ERROR_TIMEOUT;
+      continue;
+    }
+
+    rtRemoteMessagePtr res = lookup.second.get();
+    auto objects = res->FindMember(kNsFieldNameObjects);
+    if (objects == res->MemberEnd() || !objects->value.IsArray())
+    {
+      rtLogWarn("lookup response without %s", kNsFieldNameObjects);
+      result = RT_ERROR_PROTOCOL_ERROR;
+      continue;
+    }
+
+    for (rapidjson::Value::ConstValueIterator itr = objects->value.Begin(); itr != objects->value.End(); ++itr)
+    {
+      if (!itr->IsObject())
+        continue;
+
+      auto id = itr->FindMember(kFieldNameObjectId);
+      sockaddr_storage endpoint;
+      if (id == itr->MemberEnd() || !id->value.IsString() || rtMessage_GetEndpoint(*itr, endpoint) != RT_OK)
+      {
+        rtLogWarn("bad entry in lookup response");
+        continue;
+      }
+      endpoints[id->value.GetString()] = endpoint;
+    }
+  }
+
+  // a name the name service left out isn't registered. one that was in a
+  // batch that got no answer is unknown, and the error above says so.
+  if (result == RT_OK)
+  {
+    for (std::string const& name : remaining)
+    {
+      if (endpoints.find(name) == endpoints.end())
+        return RT_RESOURCE_NOT_FOUND;
+    }
+  }
+  return result;
+}
+
 rtError
 rtRemoteNsResolver::close()
 {
@@ -400,10 +513,8 @@ rtRemoteNsResolver::onLocate(rtRemoteMessagePtr const& doc, sockaddr_storage con
 {
   rtRemoteCorrelationKey key = rtMessage_GetCorrelationKey(*doc);
 
-  std::unique_lock<std::mutex> lock(m_mutex);
-  m_pending_searches[key] = doc;
-  lock.unlock();
-  m_cond.notify_all();
+  if (!m_pending_searches.complete(key, doc))
+    rtLogDebug("no one waiting for %s", key.toString().c_str());
 
   return RT_OK;
 }
@@ -416,6 +527,11 @@ rtRemoteNsResolver::runListener()
   buff.resize(1024 * 1024);
   rtLogInfo("running listener");
 
+  // renew a few times per lease so a lost datagram doesn't drop the registration
+  auto const heartbeatInterval = std::chrono::milliseconds(
+    std::max(m_env->Config->resolver_unicast_lease_ms() / 3, 1u));
+  auto nextHeartbeat = std::chrono::steady_clock::now() + heartbeatInterval;
+
   while (true)
   {
     int maxFd = 0;
@@ -430,7 +546,19 @@ rtRemoteNsResolver::runListener()
     FD_ZERO(&err_fds);
     rtPushFd(&err_fds, m_static_fd, &maxFd);
 
-    int ret = select(maxFd + 1, &read_fds, NULL, &err_fds, NULL);
+    auto now = std::chrono::steady_clock::now();
+    if (now >= nextHeartbeat)
+    {
+      sendHeartbeats();
+      nextHeartbeat = now + heartbeatInterval;
+    }
+
+    timeval timeout;
+    auto wait = std::chrono::duration_cast<std::chrono::microseconds>(nextHeartbeat - now).count();
+    timeout.tv_sec = wait / 1000000;
+    timeout.tv_usec = wait % 1000000;
+
+    int ret = select(maxFd + 1, &read_fds, NULL, &err_fds, &timeout);
     if (ret == -1)
     {
       rtError e = rtErrorFromErrno(errno);
@@ -479,6 +607,12 @@ rtRemoteNsResolver::doDispatch(char const* buff, int n, sockaddr_storage* peer)
   if (err != RT_OK)
     return;
 
+  if (!rtMessage_IsWellFormed(*doc))
+  {
+    rtLogWarn("dropping malformed message from %s", rtSocketToString(*peer).c_str());
+    return;
+  }
+
   char const* message_type = rtMessage_GetMessageType(*doc);
 
   auto itr = m_command_handlers.find(message_type);
@@ -500,7 +634,242 @@ rtRemoteNsResolver::doDispatch(char const* buff, int n, sockaddr_storage* peer)
 }
 
 rtError
-rtRemoteNsResolver::unregisterObject(std::string const& /*name*/)
+rtRemoteNsResolver::unregisterObject(std::string const& name)
+{
+  if (m_static_fd == -1)
+    return RT_FAIL;
+
+  {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_hosted_objects.erase(name);
+  }
+
+  rapidjson::Document doc;
+  doc.SetObject();
+  doc.AddMember(kFieldNameMessageType, kNsMessageTypeDeregister, doc.GetAllocator());
+  doc.AddMember(kFieldNameObjectId, name, doc.GetAllocator());
+  doc.AddMember(kFieldNameSenderId, m_pid, doc.GetAllocator());
+  doc.AddMember(kFieldNameCorrelationKey, rtMessage_GetNextCorrelationKey().toString(), doc.GetAllocator());
+  return rtSendDocument(doc, m_static_fd, &m_ns_dest);
+}
+
+rtError
+rtRemoteNsResolver::sendRegistration(char const* messageType, std::string const& name,
+  sockaddr_storage const& endpoint, rtRemoteCorrelationKey const& seqId)
+{
+  // a unix endpoint goes out as its path with port 0
+  uint16_t rpc_port = 0;
+  rtGetPort(endpoint, &rpc_port);
+
+  rapidjson::Document doc;
+  doc.SetObject();
+  doc.AddMember(kFieldNameMessageType, rapidjson::StringRef(messageType), doc.GetAllocator());
+  doc.AddMember(kFieldNameObjectId, name, doc.GetAllocator());
+  doc.AddMember(kFieldNameIp, rtSocketAddressToString(endpoint), doc.GetAllocator());
+  doc.AddMember(kFieldNamePort, rpc_port, doc.GetAllocator());
+  doc.AddMember(kFieldNameLease, m_env->Config->resolver_unicast_lease_ms(), doc.GetAllocator());
+  doc.AddMember(kFieldNameSenderId, m_pid, doc.GetAllocator());
+  doc.AddMember(kFieldNameCorrelationKey, seqId.toString(), doc.GetAllocator());
+  return rtSendDocument(doc, m_static_fd, &m_ns_dest);
+}
+
+rtError
+rtRemoteNsResolver::subscribe(std::string const& pattern, bool prefix)
+{
+  if (m_static_fd == -1)
+    return RT_FAIL;
+
+  rtRemoteCorrelationKey seqId = rtMessage_GetNextCorrelationKey();
+  {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    Subscription sub;
+    sub.Pattern = pattern;
+    sub.Prefix = prefix;
+    sub.Key = seqId.toString();
+    sub.Acked = false;
+    m_subscriptions.push_back(sub);
+  }
+  return sendSubscribe(kNsMessageTypeSubscribe, pattern, prefix, seqId);
+}
+
+rtError
+rtRemoteNsResolver::unsubscribe(std::string const& pattern)
+{
+  if (m_static_fd == -1)
+    return RT_FAIL;
+
+  {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    auto end = std::stable_partition(m_subscriptions.begin(), m_subscriptions.end(),
+      [&pattern](Subscription const& sub) { return sub.Pattern != pattern; });
+
+    SubscriptionList removed(end, m_subscriptions.end());
+    m_subscriptions.erase(end, m_subscriptions.end());
+    for (Subscription const& sub : removed)
+      forgetKnownObjects(sub);
+  }
+  return sendSubscribe(kNsMessageTypeUnsubscribe, pattern, false, rtMessage_GetNextCorrelationKey());
+}
+
+rtError
+rtRemoteNsResolver::sendSubscribe(char const* messageType, std::string const& pattern, bool prefix,
+  rtRemoteCorrelationKey const& seqId)
+{
+  rapidjson::Document doc;
+  doc.SetObject();
+  doc.AddMember(kFieldNameMessageType, rapidjson::StringRef(messageType), doc.GetAllocator());
+  doc.AddMember(kFieldNameObjectId, pattern, doc.GetAllocator());
+  doc.AddMember(kNsFieldNamePrefix, prefix, doc.GetAllocator());
+  doc.AddMember(kFieldNameLease, m_env->Config->resolver_unicast_lease_ms(), doc.GetAllocator());
+  doc.AddMember(kFieldNameSenderId, m_pid, doc.GetAllocator());
+  doc.AddMember(kFieldNameCorrelationKey, seqId.toString(), doc.GetAllocator());
+  return rtSendDocument(doc, m_static_fd, &m_ns_dest);
+}
+
+rtError
+rtRemoteNsResolver::onSubscribeResponse(rtRemoteMessagePtr const& doc, sockaddr_storage const& /*soc*/)
 {
-  return RT_ERROR_NOT_IMPLEMENTED;
+  char const* status = rtMessage_GetStatusMessage(*doc);
+  if (!status || strcmp(status, kNsStatusSuccess) != 0)
+    return RT_OK;
+
+  std::string const key = rtMessage_GetCorrelationKey(*doc).toString();
+
+  std::unique_lock<std::mutex> lock(m_mutex);
+  for (Subscription& sub : m_subscriptions)
+  {
+    if (sub.Key == key)
+    {
+      sub.Acked = true;
+      break;
+    }
+  }
+  return RT_OK;
+}
+
+void
+rtRemoteNsResolver::forgetKnownObjects(Subscription const& sub)
+{
+  for (auto itr = m_known_objects.begin(); itr != m_known_objects.end();)
+  {
+    bool covered = !sub.matches(itr->first);
+    for (Subscription const& other : m_subscriptions)
+    {
+      if (covered)
+        break;
+      if (&other != &sub && other.Acked && other.matches(itr->first))
+        covered = true;
+    }
+
+    if (covered)
+      ++itr;
+    else
+      itr = m_known_objects.erase(itr);
+  }
+}
+
+rtError
+rtRemoteNsResolver::onEvent(rtRemoteMessagePtr const& doc, sockaddr_storage const& /*soc*/)
+{
+  char const* objectId = rtMessage_GetObjectId(*doc);
+  auto event = doc->FindMember(kNsFieldNameEvent);
+  if (!objectId || event == doc->MemberEnd() || !event->value.IsString())
+    return RT_ERROR_INVALID_ARG;
+
+  if (strcmp(event->value.GetString(), kNsEventRegister) == 0)
+  {
+    sockaddr_storage endpoint;
+    rtError err = rtMessage_GetEndpoint(*doc, endpoint);
+    if (err != RT_OK)
+    {
+      rtLogWarn("bad endpoint in event for %s", objectId);
+      return err;
+    }
+
+    std::unique_lock<std::mutex> lock(m_mutex);
+    KnownObject& known = m_known_objects[objectId];
+    known.Endpoint = endpoint;
+    known.Expires = std::chrono::steady_clock::now() +
+      std::chrono::milliseconds(m_env->Config->resolver_unicast_lease_ms());
+  }
+  else if (strcmp(event->value.GetString(), kNsEventDeregister) == 0)
+  {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_known_objects.erase(objectId);
+  }
+
+  return RT_OK;
+}
+
+void
+rtRemoteNsResolver::sendHeartbeats()
+{
+  HostedObjectsMap hosted;
+  std::vector< std::pair<Subscription, rtRemoteCorrelationKey> > renewals;
+  {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    hosted = m_hosted_objects;
+
+    auto const now = std::chrono::steady_clock::now();
+    for (auto itr = m_known_objects.begin(); itr != m_known_objects.end();)
+    {
+      if (itr->second.Expires <= now)
+        itr = m_known_objects.erase(itr);
+      else
+        ++itr;
+    }
+
+    // nothing pushed for a subscription the name service didn't confirm
+    // can be trusted. the next acked renewal sends the matches again.
+    for (Subscription& sub : m_subscriptions)
+    {
+      if (!sub.Acked)
+      {
+        rtLogDebug("subscription for %s not acknowledged", sub.Pattern.c_str());
+        forgetKnownObjects(sub);
+      }
+    }
+
+    for (Subscription& sub : m_subscriptions)
+    {
+      rtRemoteCorrelationKey seqId = rtMessage_GetNextCorrelationKey();
+      sub.Key = seqId.toString();
+      sub.Acked = false;
+      renewals.push_back(std::make_pair(sub, seqId));
+    }
+  }
+
+  // subscriptions are leased like registrations
+  for (auto const& renewal : renewals)
+    sendSubscribe(kNsMessageTypeSubscribe, renewal.first.Pattern, renewal.first.Prefix, renewal.second);
+
+  for (auto const& obj : hosted)
+  {
+    rtError e = sendRegistration(kNsMessageTypeUpdate, obj.first, obj.second,
+      rtMessage_GetNextCorrelationKey());
+    if (e != RT_OK)
+      rtLogWarn("failed to renew lease for %s. %s", obj.first.c_str(), rtStrError(e));
+  }
+}
+
+rtError
+rtRemoteNsResolver::onUpdateResponse(rtRemoteMessagePtr const& doc, sockaddr_storage const& /*soc*/)
+{
+  char const* status = rtMessage_GetStatusMessage(*doc);
+  char const* objectId = rtMessage_GetObjectId(*doc);
+  if (!status || !objectId || strcmp(status, kNsStatusFail) != 0)
+    return RT_OK;
+
+  // the name service forgot about us, probably restarted. register again.
+  sockaddr_storage endpoint;
+  {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    auto itr = m_hosted_objects.find(objectId);
+    if (itr == m_hosted_objects.end())
+      return RT_OK;
+    endpoint = itr->second;
+  }
+
+  rtLogInfo("lease for %s lost, registering again", objectId);
+  return sendRegistration(kNsMessageTypeRegister, objectId, endpoint, rtMessage_GetNextCorrelationKey());
 }
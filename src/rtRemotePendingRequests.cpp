@@ -0,0 +1,66 @@
+/*
+
+pxCore Copyright 2005-2018 John Robinson
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+*/
+
+#include "rtRemotePendingRequests.h"
+
+#include <functional>
+#include <string>
+
+rtRemotePendingRequests::Shard&
+rtRemotePendingRequests::shardFor(rtRemoteCorrelationKey const& key)
+{
+  size_t const h = std::hash<std::string>()(key.toString());
+  return m_shards[h % kShardCount];
+}
+
+std::future<rtRemoteMessagePtr>
+rtRemotePendingRequests::add(rtRemoteCorrelationKey const& key)
+{
+  std::promise<rtRemoteMessagePtr> p;
+  std::future<rtRemoteMessagePtr> f = p.get_future();
+
+  Shard& shard = shardFor(key);
+  std::unique_lock<std::mutex> lock(shard.Mutex);
+  shard.Requests[key] = std::move(p);
+  return f;
+}
+
+bool
+rtRemotePendingRequests::complete(rtRemoteCorrelationKey const& key, rtRemoteMessagePtr const& doc)
+{
+  std::promise<rtRemoteMessagePtr> p;
+  {
+    Shard& shard = shardFor(key);
+    std::unique_lock<std::mutex> lock(shard.Mutex);
+    auto itr = shard.Requests.find(key);
+    if (itr == shard.Requests.end())
+      return false;
+    p = std::move(itr->second);
+    shard.Requests.erase(itr);
+  }
+  p.set_value(doc);
+  return true;
+}
+
+void
+rtRemotePendingRequests::remove(rtRemoteCorrelationKey const& key)
+{
+  Shard& shard = shardFor(key);
+  std::unique_lock<std::mutex> lock(shard.Mutex);
+  shard.Requests.erase(key);
+}
@@ -29,10 +29,11 @@ limitations under the License.
 #include "rtRemoteValueWriter.h"
 #include "rtRemoteConfig.h"
 #include "rtRemoteFactory.h"
+#include "rtRemoteLocateCache.h"
+#include "rtRemoteTimerService.h"
 
 #include <limits>
 #include <sstream>
-#include <set>
 #include <algorithm>
 
 #include <sys/stat.h>
@@ -42,6 +43,7 @@ limitations under the License.
 #include <string.h>
 #include <unistd.h>
 #include <fcntl.h>
+#include <signal.h>
 #include <rtLog.h>
 #include <dirent.h>
 
@@ -58,96 +60,47 @@ namespace
     return true;
   } // isValidPid
 
-  int
-  parsePid(char const* s)
-  {
-    int pid = -1;
-
-    char const* p = s + strlen(s) - 1;
-    while (p && *p)
-    {
-      if (!isdigit(*p))
-        break;
-      p--;
-    }
-    if (p)
-    {
-      p++;
-      pid = strtol(p, nullptr, 10);
-    }
-    return pid;
-  } // parsePid
-
+  // Only our own socket directory is scanned and only names that look like
+  // one of our sockets are checked. ESRCH from kill(pid, 0) means the owner
+  // is gone; EPERM means it's alive and belongs to another user.
   void
-  cleanupStaleUnixSockets()
+  cleanupStaleUnixSockets(std::string const& dir)
   {
-    DIR* d = opendir("/proc/");
+    DIR* d = opendir(dir.c_str());
     if (!d)
     {
       rtError e = rtErrorFromErrno(errno);
-      rtLogWarn("failed to open directory /proc. %s", rtStrError(e));
+      rtLogWarn("failed to open directory %s. %s", dir.c_str(), rtStrError(e));
       return;
     }
 
-    dirent* entry = reinterpret_cast<dirent *>(malloc(1024));
-    dirent* result = nullptr;
-
-    std::set<int> active_pids;
+    size_t const prefixLength = strlen(kUnixSocketNamePrefix);
 
-    int ret = 0;
-    do
+    dirent* entry = nullptr;
+    while ((entry = readdir(d)) != nullptr)
     {
-      ret = readdir_r(d, entry, &result);
-      if (ret == 0 && (result != nullptr))
-      {
-        if (isValidPid(result->d_name))
-        {
-          int pid = static_cast<int>(strtol(result->d_name, nullptr, 10));
-          active_pids.insert(pid);
-        }
-      }
-    }
-    while ((result != nullptr) && ret == 0);
-    closedir(d);
+      if (strncmp(entry->d_name, kUnixSocketNamePrefix, prefixLength) != 0)
+        continue;
 
-    d = opendir("/tmp");
-    if (!d)
-    {
-      rtError e = rtErrorFromErrno(errno);
-      rtLogWarn("failed to open directory /tmp. %s", rtStrError(e));
-      return;
-    }
+      char const* s = entry->d_name + prefixLength;
+      if (*s == '\0' || !isValidPid(s))
+        continue;
 
-    char path[UNIX_PATH_MAX];
-    do
-    {
-      ret = readdir_r(d, entry, &result);
-      if (ret == 0 && (result != nullptr))
+      pid_t pid = static_cast<pid_t>(strtol(s, nullptr, 10));
+      if (kill(pid, 0) == 0 || errno != ESRCH)
+        continue;
+
+      std::string path = dir + "/" + entry->d_name;
+      rtLogInfo("removing inactive unix socket %s", path.c_str());
+      if (unlink(path.c_str()) == -1 && errno != ENOENT)
       {
-        memset(path, 0, sizeof(path));
-        strcpy(path, "/tmp/");
-        strcat(path, result->d_name);
-        if (strncmp(path, kUnixSocketTemplateRoot, strlen(kUnixSocketTemplateRoot)) == 0)
-        {
-          int pid = parsePid(result->d_name);
-          if (active_pids.find(pid) == active_pids.end())
-          {
-            rtLogInfo("removing inactive unix socket %s", path);
-            int ret = unlink(path);
-            if (ret == -1)
-            {
-              rtError e = rtErrorFromErrno(errno);
-              rtLogWarn("failed to remove inactive unix socket %s. %s",
-                path, rtStrError(e));
-            }
-          }
-        }
+        rtError e = rtErrorFromErrno(errno);
+        rtLogWarn("failed to remove inactive unix socket %s. %s",
+          path.c_str(), rtStrError(e));
       }
     }
-    while ((result != nullptr) && ret == 0);
 
     closedir(d);
-    free(entry);
   } // cleanupStaleUnixSockets
 
   bool
@@ -163,40 +116,77 @@ namespace
     return false;
   } // isUnixDomain
 
+  // abstract names live in the kernel only, so nothing is left behind on
+  // a crash and there's nothing to unlink or clean up. Linux only.
   bool
-  sameEndpoint(sockaddr_storage const& addr1, sockaddr_storage const& addr2)
+  isAbstractUnixDomain(rtRemoteEnvironment* env)
   {
-    if (addr1.ss_family != addr2.ss_family)
+    if (!isUnixDomain(env) || !env->Config->server_socket_abstract())
       return false;
 
-    if (addr1.ss_family == AF_INET)
-    {
-      sockaddr_in const* in1 = reinterpret_cast<sockaddr_in const*>(&addr1);
-      sockaddr_in const* in2 = reinterpret_cast<sockaddr_in const*>(&addr2);
+    #ifdef __APPLE__
+    rtLogWarn("abstract unix sockets are not supported on this platform, using %s",
+      env->Config->server_socket_dir().c_str());
+    return false;
+    #else
+    return true;
+    #endif
+  } // isAbstractUnixDomain
 
-      if (in1->sin_port != in2->sin_port)
-        return false;
+  // the bytes that identify a peer, so equal endpoints give equal keys no
+  // matter how the sockaddr was filled in
+  std::string
+  endpointKey(sockaddr_storage const& addr)
+  {
+    std::string key(1, static_cast<char>(addr.ss_family));
 
-      return in1->sin_addr.s_addr == in2->sin_addr.s_addr;
+    if (addr.ss_family == AF_INET)
+    {
+      sockaddr_in const* in = reinterpret_cast<sockaddr_in const*>(&addr);
+      key.append(reinterpret_cast<char const *>(&in->sin_port), sizeof(in->sin_port));
+      key.append(reinterpret_cast<char const *>(&in->sin_addr), sizeof(in->sin_addr));
     }
-
-    if (addr1.ss_family == AF_UNIX)
+    else if (addr.ss_family == AF_INET6)
     {
-      sockaddr_un const* un1 = reinterpret_cast<sockaddr_un const*>(&addr1);
-      sockaddr_un const* un2 = reinterpret_cast<sockaddr_un const*>(&addr2);
-
-      return 0 == strncmp(un1->sun_path, un2->sun_path, UNIX_PATH_MAX);
+      sockaddr_in6 const* in6 = reinterpret_cast<sockaddr_in6 const*>(&addr);
+      key.append(reinterpret_cast<char const *>(&in6->sin6_port), sizeof(in6->sin6_port));
+      key.append(reinterpret_cast<char const *>(&in6->sin6_addr), sizeof(in6->sin6_addr));
+      key.append(reinterpret_cast<char const *>(&in6->sin6_scope_id), sizeof(in6->sin6_scope_id));
+    }
+    else if (addr.ss_family == AF_UNIX)
+    {
+      key.append(rtUnixSocketPath(addr));
     }
+    // anything else (a client with no stream left) only matches itself by family
+    return key;
+  } // endpointKey
 
-    RT_ASSERT(false);
-    return false;
-  } // sameEndpoint
+  // one entry per pooled connection to a peer
+  std::string
+  clientKey(sockaddr_storage const& addr, uint32_t slot)
+  {
+    return std::to_string(slot) + "|" + endpointKey(addr);
+  } // clientKey
+
+  // what's left of a locate timeout for connecting. never zero, that
+  // would mean the default connect timeout
+  uint32_t
+  remainingTime(std::chrono::steady_clock::time_point deadline)
+  {
+    using namespace std::chrono;
+    auto remaining = duration_cast<milliseconds>(deadline - steady_clock::now()).count();
+    return remaining > 1 ? static_cast<uint32_t>(remaining) : 1;
+  } // remainingTime
 } // namespace
 
 rtRemoteServer::rtRemoteServer(rtRemoteEnvironment* env)
   : m_listen_fd(-1)
+  , m_sweep_timer(0)
+  , m_reconnect_stopped(false)
   , m_resolver(nullptr)
   , m_keep_alive_interval(std::numeric_limits<uint32_t>::max())
+  , m_pool_size(std::max<uint32_t>(1, env->Config->client_pool_size()))
+  , m_socket_options(rtRemoteSocketOptions::fromConfig(*env->Config))
   , m_env(env)
 {
   memset(&m_rpc_endpoint, 0, sizeof(m_rpc_endpoint));
@@ -214,6 +204,9 @@ rtRemoteServer::rtRemoteServer(rtRemoteEnvironment* env)
   m_command_handlers.insert(CommandHandlerMap::value_type(kMessageTypeOpenSessionRequest, 
     rtRemoteCallback<rtRemoteMessageHandler>(&rtRemoteServer::onOpenSession_Dispatch, this)));
 
+  m_command_handlers.insert(CommandHandlerMap::value_type(kMessageTypeOpenSessionResponse,
+    rtRemoteCallback<rtRemoteMessageHandler>(&rtRemoteServer::onOpenSessionResponse_Dispatch, this)));
+
   m_command_handlers.insert(CommandHandlerMap::value_type(kMessageTypeGetByNameRequest,
     rtRemoteCallback<rtRemoteMessageHandler>(&rtRemoteServer::onGet_Dispatch, this)));
 
@@ -238,6 +231,21 @@ rtRemoteServer::rtRemoteServer(rtRemoteEnvironment* env)
 
 rtRemoteServer::~rtRemoteServer()
 {
+  if (m_sweep_timer)
+    m_env->Timers->cancel(m_sweep_timer);
+
+  {
+    std::unique_lock<std::mutex> lock(m_reconnect_mutex);
+    m_reconnect_stopped = true;
+    m_reconnect_queue.clear();
+  }
+  m_reconnect_cond.notify_all();
+  if (m_reconnect_thread)
+  {
+    m_reconnect_thread->join();
+    m_reconnect_thread.reset();
+  }
+
   if (m_shutdown_pipe[0] != -1)
   {
     char buff[] = {"shutdown"};
@@ -253,10 +261,17 @@ rtRemoteServer::~rtRemoteServer()
       m_thread->join();
       m_thread.reset();
     }
+
+    // the pipe is never drained, so every acceptor sees it
+    for (auto& t : m_accept_threads)
+      t->join();
+    m_accept_threads.clear();
   }
 
   if (m_listen_fd != -1)
     ::close(m_listen_fd);
+  for (int fd : m_reuseport_fds)
+    ::close(fd);
   if (m_shutdown_pipe[0] != -1)
     ::close(m_shutdown_pipe[0]);
   if (m_shutdown_pipe[1] != -1)
@@ -264,6 +279,15 @@ rtRemoteServer::~rtRemoteServer()
 
   if (m_resolver)
   {
+    // don't leave entries behind in shared registries like the file resolver
+    std::set<std::string> registered;
+    {
+      std::unique_lock<std::mutex> lock(m_mutex);
+      registered.swap(m_registered_objects);
+    }
+    for (std::string const& objectId : registered)
+      m_resolver->unregisterObject(objectId);
+
     m_resolver->close();
     delete m_resolver;
   }
@@ -276,7 +300,7 @@ rtRemoteServer::open()
   if (err != RT_OK)
     return err;
 
-  m_resolver = rtRemoteFactory::rtRemoteCreateResolver(m_env);
+  m_resolver = new rtRemoteLocateCache(m_env, rtRemoteFactory::rtRemoteCreateResolver(m_env));
   err = start();
   if (err != RT_OK)
   {
@@ -297,6 +321,9 @@ rtRemoteServer::registerObject(std::string const& objectId, rtObjectRef const& o
     m_env->ObjectCache->markUnevictable(objectId, true);
   }
   m_resolver->registerObject(objectId, m_rpc_endpoint);
+
+  std::unique_lock<std::mutex> lock(m_mutex);
+  m_registered_objects.insert(objectId);
   return RT_OK;
 }
 
@@ -315,6 +342,11 @@ rtRemoteServer::unregisterObject(std::string const& objectId)
     }
   }
 
+  {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_registered_objects.erase(objectId);
+  }
+
   if (m_resolver)
   {
     e = m_resolver->unregisterObject(objectId);
@@ -331,8 +363,6 @@ rtRemoteServer::unregisterObject(std::string const& objectId)
 void
 rtRemoteServer::runListener()
 {
-  time_t lastKeepAliveCheck = 0;
-
   while (true)
   {
     int maxFd = 0;
@@ -347,11 +377,8 @@ rtRemoteServer::runListener()
     FD_ZERO(&errFds);
     rtPushFd(&errFds, m_listen_fd, &maxFd);
 
-    timeval timeout;
-    timeout.tv_sec = 1; // TODO: move to rtremote.conf (rt.remote.server.select.timeout)
-    timeout.tv_usec = 0;
-
-    int ret = select(maxFd + 1, &readFds, NULL, &errFds, &timeout);
+    // housekeeping is on the timer thread, nothing to wake up for
+    int ret = select(maxFd + 1, &readFds, NULL, &errFds, NULL);
     if (ret == -1)
     {
       rtError e = rtErrorFromErrno(errno);
@@ -369,42 +396,122 @@ rtRemoteServer::runListener()
 
     if (FD_ISSET(m_listen_fd, &readFds))
       doAccept(m_listen_fd);
+  }
+}
+
+// Extra SO_REUSEPORT listeners. The kernel spreads incoming connections
+// across them and the main listener.
+void
+rtRemoteServer::runAcceptor(int fd)
+{
+  while (true)
+  {
+    int maxFd = 0;
+
+    fd_set readFds;
+    FD_ZERO(&readFds);
+    rtPushFd(&readFds, fd, &maxFd);
+    rtPushFd(&readFds, m_shutdown_pipe[0], &maxFd);
 
-    time_t now = time(nullptr);
-    if (now - lastKeepAliveCheck > 1)
+    int ret = select(maxFd + 1, &readFds, NULL, NULL, NULL);
+    if (ret == -1)
     {
-      rtError err = removeStaleObjects();
-      if (err == RT_OK)
-        lastKeepAliveCheck = now;
+      rtError e = rtErrorFromErrno(errno);
+      if (errno != EINTR)
+        rtLogWarn("select failed: %s", rtStrError(e));
+      continue;
     }
+
+    if (FD_ISSET(m_shutdown_pipe[0], &readFds))
+      return;
+
+    if (FD_ISSET(fd, &readFds))
+      doAccept(fd);
   }
 }
 
+// Takes every pending connection, not just one, so a burst of reconnects
+// doesn't sit in the backlog waiting for the next wakeup. The listen
+// socket is non-blocking, the loop ends at EAGAIN.
 void
 rtRemoteServer::doAccept(int fd)
 {
-  sockaddr_storage remoteEndpoint;
-  memset(&remoteEndpoint, 0, sizeof(remoteEndpoint));
-
-  socklen_t len = sizeof(sockaddr_storage);
+  sockaddr_storage localEndpoint;
+  memset(&localEndpoint, 0, sizeof(sockaddr_storage));
+  rtGetSockName(fd, localEndpoint);
 
-  int ret = accept(fd, reinterpret_cast<sockaddr *>(&remoteEndpoint), &len);
-  if (ret == -1)
+  while (true)
   {
-    rtError e = rtErrorFromErrno(errno);
-    rtLogWarn("error accepting new tcp connect. %s", rtStrError(e));
-    return;
+    sockaddr_storage remoteEndpoint;
+    memset(&remoteEndpoint, 0, sizeof(remoteEndpoint));
+
+    socklen_t len = sizeof(sockaddr_storage);
+
+    // streams do blocking reads and writes, so only CLOEXEC here
+    #ifdef __APPLE__
+    int ret = accept(fd, reinterpret_cast<sockaddr *>(&remoteEndpoint), &len);
+    if (ret != -1)
+      fcntl(ret, F_SETFD, fcntl(ret, F_GETFD) | FD_CLOEXEC);
+    #else
+    int ret = accept4(fd, reinterpret_cast<sockaddr *>(&remoteEndpoint), &len, SOCK_CLOEXEC);
+    #endif
+    if (ret == -1)
+    {
+      if (errno == EINTR || errno == ECONNABORTED)
+        continue;
+      if (errno != EAGAIN && errno != EWOULDBLOCK)
+      {
+        rtError e = rtErrorFromErrno(errno);
+        rtLogWarn("error accepting new tcp connect. %s", rtStrError(e));
+      }
+      return;
+    }
+    rtLogInfo("new connection from %s with fd:%d", rtSocketToString(remoteEndpoint).c_str(), ret);
+
+    // not every option is inherited from the listener everywhere
+    rtApplySocketOptions(ret, remoteEndpoint.ss_family, m_socket_options);
+
+    std::shared_ptr<rtRemoteClient> newClient(new rtRemoteClient(m_env, ret, localEndpoint, remoteEndpoint));
+
+    rtRemotePeerCredentials creds;
+    if (newClient->getPeerCredentials(creds))
+      rtLogInfo("local peer on fd:%d is pid:%d uid:%d", ret, static_cast<int>(creds.pid),
+        static_cast<int>(creds.uid));
+
+    newClient->setStateChangedHandler(&rtRemoteServer::onClientStateChanged_Dispatch, this);
+    newClient->open();
+
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_connected_clients.push_back(newClient);
   }
-  rtLogInfo("new connection from %s with fd:%d", rtSocketToString(remoteEndpoint).c_str(), ret);
+}
 
-  sockaddr_storage localEndpoint;
-  memset(&localEndpoint, 0, sizeof(sockaddr_storage));
-  rtGetSockName(fd, localEndpoint);
+// called with m_mutex held
+void
+rtRemoteServer::removeFromClientTable(std::shared_ptr<rtRemoteClient> const& client)
+{
+  // by the key it went in under. the endpoint may have changed since.
+  std::string const& key = client->getTableKey();
+  if (key.empty())
+    return;
 
-  std::shared_ptr<rtRemoteClient> newClient(new rtRemoteClient(m_env, ret, localEndpoint, remoteEndpoint));
-  newClient->setStateChangedHandler(&rtRemoteServer::onClientStateChanged_Dispatch, this);
-  newClient->open();
-  m_connected_clients.push_back(newClient);
+  auto itr = m_object_map.find(key);
+  if (itr != m_object_map.end() && itr->second.get() == client.get())
+    m_object_map.erase(itr);
+}
+
+// called with m_mutex held
+void
+rtRemoteServer::addToClientTable(std::shared_ptr<rtRemoteClient> const& client)
+{
+  std::string const& key = client->getTableKey();
+  if (key.empty())
+    return;
+
+  // a findObject may have opened a new connection while this one was
+  // down, keep that one
+  if (!m_object_map.insert(ClientMap::value_type(key, client)).second)
+    rtLogDebug("client table already has %s", key.c_str());
 }
 
 rtError
@@ -413,10 +520,35 @@ rtRemoteServer::onClientStateChanged(std::shared_ptr<rtRemoteClient> const& clie
 {
   rtError e = RT_ERROR_OBJECT_NOT_FOUND;
 
-  if (state == rtRemoteClient::State::Shutdown)
+  if (state == rtRemoteClient::State::Reconnecting)
+  {
+    // the client will look its objects up again, make sure that isn't
+    // answered from the cache. new finds get a fresh connection meanwhile.
+    rtLogInfo("client reconnecting");
+    if (m_resolver)
+      m_resolver->invalidateEndpoint(client->getRemoteEndpoint());
+
+    std::unique_lock<std::mutex> lock(m_mutex);
+    removeFromClientTable(client);
+    e = RT_OK;
+  }
+  else if (state == rtRemoteClient::State::Started)
+  {
+    // reconnected, findObject can share it again
+    std::unique_lock<std::mutex> lock(m_mutex);
+    addToClientTable(client);
+    e = RT_OK;
+  }
+  else if (state == rtRemoteClient::State::Shutdown)
   {
     rtLogInfo("client shutdown");
+    if (m_resolver)
+      m_resolver->invalidateEndpoint(client->getRemoteEndpoint());
     std::unique_lock<std::mutex> lock(m_mutex);
+
+    // don't hand out a dead connection to the next findObject
+    removeFromClientTable(client);
+
     auto itr = std::remove_if(
       m_connected_clients.begin(),
       m_connected_clients.end(),
@@ -497,6 +629,8 @@ rtRemoteServer::start()
   try
   {
     m_thread.reset(new std::thread(&rtRemoteServer::runListener, this));
+    for (int fd : m_reuseport_fds)
+      m_accept_threads.emplace_back(new std::thread(&rtRemoteServer::runAcceptor, this, fd));
   }
   catch (std::exception const& err)
   {
@@ -504,6 +638,14 @@ rtRemoteServer::start()
     return RT_FAIL;
   }
 
+  std::chrono::milliseconds sweepInterval(m_env->Config->server_sweep_interval_ms());
+  m_sweep_timer = m_env->Timers->schedule(sweepInterval, [this]
+  {
+    rtError e = removeStaleObjects();
+    if (e != RT_OK)
+      rtLogWarn("failed to remove stale objects. %s", rtStrError(e));
+  });
+
   return RT_OK;
 }
 
@@ -517,6 +659,8 @@ rtRemoteServer::findObject(std::string const& objectId, rtObjectRef& obj, uint32
   // if object is not registered with us locally, then check network
   if (!obj)
   {
+    auto const deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeout);
+
     sockaddr_storage objectEndpoint;
     err = m_resolver->locateObject(objectId, objectEndpoint, timeout);
 
@@ -524,73 +668,209 @@ rtRemoteServer::findObject(std::string const& objectId, rtObjectRef& obj, uint32
     rtSocketToString(objectEndpoint).c_str());
 
     if (err == RT_OK)
-    {
-      std::shared_ptr<rtRemoteClient> client;
-      std::string const endpointName = rtSocketToString(objectEndpoint);
+      err = openRemoteObject(objectId, objectEndpoint, obj, remainingTime(deadline), cb, cbdata);
+  }
 
-      std::unique_lock<std::mutex> lock(m_mutex);
-      auto itr = m_object_map.find(endpointName);
-      if (itr != m_object_map.end())
-        client = itr->second;
+  return (obj ? RT_OK : RT_FAIL);
+}
 
-      // if a client is already "hosting" this object, 
-      // then just re-use it
-      for (auto i : m_object_map)
-      {
-        if (sameEndpoint(i.second->getRemoteEndpoint(), objectEndpoint))
-        {
-          client = i.second;
-          break;
-        }
-      }
-      m_mutex.unlock();
+rtError
+rtRemoteServer::findObjects(std::vector<std::string> const& objectIds, std::vector<rtObjectRef>& objs,
+  uint32_t timeout, clientDisconnectedCallback cb, void *cbdata)
+{
+  objs.assign(objectIds.size(), rtObjectRef());
 
-      if (!client)
-      {
-        client.reset(new rtRemoteClient(m_env, objectEndpoint));
-        client->setStateChangedHandler(&rtRemoteServer::onClientStateChanged_Dispatch, this);
-        err = client->open();
-        if (err != RT_OK)
-        {
-          rtLogWarn("failed to start new client. %s", rtStrError(err));
-          return err;
-        }
+  std::vector<std::string> remoteIds;
+  for (size_t i = 0; i < objectIds.size(); ++i)
+  {
+    objs[i] = m_env->ObjectCache->findObject(objectIds[i]);
+    if (!objs[i])
+      remoteIds.push_back(objectIds[i]);
+  }
 
-        // we have race condition here. if the transport doesn't exist, two threads may
-        // create one but only one will get inserted into the m_connected_client map. I'm not
-        // sure that this really matters much
-        std::unique_lock<std::mutex> lock(m_mutex);
-        m_object_map.insert(ClientMap::value_type(endpointName, client));
-      }
+  rtError result = RT_OK;
+  if (remoteIds.empty())
+    return result;
 
-      if (client)
-      {
-        rtRemoteObject* remote(new rtRemoteObject(objectId, client));
-        err = client->startSession(objectId);
-        if (err == RT_OK)
-          obj = remote;
-
-        ClientDisconnectedCB CB = {cb, cbdata};
-        auto ditr = m_disconnected_callback_map.find(client.get());
-        if (ditr == m_disconnected_callback_map.end())
-        {
-            std::vector<ClientDisconnectedCB> new_cb_vector;
-            new_cb_vector.push_back(CB);
-            m_disconnected_callback_map.insert(ClientDisconnectedCBMap::value_type(client.get(), new_cb_vector));
-        }
-        else
-        {
-            auto cbitr = std::find_if(ditr->second.begin(), ditr->second.end(),
-                    [CB](const ClientDisconnectedCB &cb) { return cb == CB; });
+  auto const deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeout);
 
-            if(cbitr == ditr->second.end())
-                ditr->second.push_back(CB);
-        }
-      }
+  // one round trip for everything that isn't local
+  std::map<std::string, sockaddr_storage> endpoints;
+  m_resolver->locateObjects(remoteIds, endpoints, timeout);
+
+  for (size_t i = 0; i < objectIds.size(); ++i)
+  {
+    if (objs[i])
+      continue;
+
+    auto itr = endpoints.find(objectIds[i]);
+    if (itr != endpoints.end())
+      openRemoteObject(objectIds[i], itr->second, objs[i], remainingTime(deadline), cb, cbdata);
+
+    if (!objs[i])
+      result = RT_FAIL;
+  }
+
+  return result;
+}
+
+// Returns connection number slot to endpoint, opening it if there isn't
+// one. Callers that ask for the same connection while it is being opened
+// wait for that connect instead of starting their own.
+rtError
+rtRemoteServer::getClient(sockaddr_storage const& endpoint, uint32_t slot, uint32_t timeout,
+  std::shared_ptr<rtRemoteClient>& client)
+{
+  std::string const key = clientKey(endpoint, slot);
+
+  std::unique_lock<std::mutex> lock(m_mutex);
+  auto itr = m_object_map.find(key);
+  if (itr != m_object_map.end())
+  {
+    client = itr->second;
+    return RT_OK;
+  }
+
+  auto pitr = m_pending_connects.find(key);
+  if (pitr != m_pending_connects.end())
+  {
+    std::shared_ptr<PendingConnect> pending = pitr->second;
+    m_connect_cond.wait(lock, [&pending] { return pending->Done; });
+    client = pending->Client;
+    return pending->Status;
+  }
+
+  std::shared_ptr<PendingConnect> pending(new PendingConnect());
+  m_pending_connects.insert(PendingConnectMap::value_type(key, pending));
+  lock.unlock();
+
+  std::shared_ptr<rtRemoteClient> newClient(new rtRemoteClient(m_env, endpoint));
+  newClient->setTableKey(key);
+  newClient->setStateChangedHandler(&rtRemoteServer::onClientStateChanged_Dispatch, this);
+  rtError err = newClient->open(timeout);
+  if (err != RT_OK)
+  {
+    rtLogWarn("failed to start new client. %s", rtStrError(err));
+    m_resolver->invalidateEndpoint(endpoint);
+    newClient.reset();
+  }
+
+  lock.lock();
+  if (newClient)
+    m_object_map.insert(ClientMap::value_type(key, newClient));
+  m_pending_connects.erase(key);
+  pending->Client = newClient;
+  pending->Status = err;
+  pending->Done = true;
+  lock.unlock();
+  m_connect_cond.notify_all();
+
+  client = newClient;
+  return err;
+}
+
+rtError
+rtRemoteServer::openRemoteObject(std::string const& objectId, sockaddr_storage const& objectEndpoint,
+  rtObjectRef& obj, uint32_t timeout, clientDisconnectedCallback cb, void *cbdata)
+{
+  // an object always uses the same connection in the pool, so its calls
+  // stay in order. different objects spread over the pool.
+  uint32_t const slot = m_pool_size > 1
+    ? static_cast<uint32_t>(std::hash<std::string>()(objectId) % m_pool_size)
+    : 0;
+
+  std::shared_ptr<rtRemoteClient> client;
+  rtError err = getClient(objectEndpoint, slot, timeout, client);
+  if (err != RT_OK)
+    return err;
+
+  if (client)
+  {
+    rtRemoteObject* remote(new rtRemoteObject(objectId, client));
+    err = client->startSession(objectId);
+    if (err == RT_OK)
+    {
+      obj = remote;
+      client->addLocatedObject(objectId);
+    }
+    else
+      m_resolver->invalidate(objectId);
+
+    ClientDisconnectedCB CB = {cb, cbdata};
+    std::unique_lock<std::mutex> lock(m_mutex);
+    auto ditr = m_disconnected_callback_map.find(client.get());
+    if (ditr == m_disconnected_callback_map.end())
+    {
+        std::vector<ClientDisconnectedCB> new_cb_vector;
+        new_cb_vector.push_back(CB);
+        m_disconnected_callback_map.insert(ClientDisconnectedCBMap::value_type(client.get(), new_cb_vector));
+    }
+    else
+    {
+        auto cbitr = std::find_if(ditr->second.begin(), ditr->second.end(),
+                [CB](const ClientDisconnectedCB &cb) { return cb == CB; });
+
+        if(cbitr == ditr->second.end())
+            ditr->second.push_back(CB);
     }
   }
 
-  return (obj ? RT_OK : RT_FAIL);
+  return err;
+}
+
+void
+rtRemoteServer::queueReconnect(std::shared_ptr<rtRemoteClient> const& client)
+{
+  std::unique_lock<std::mutex> lock(m_reconnect_mutex);
+  if (m_reconnect_stopped)
+    return;
+
+  // most processes never reconnect, so the thread starts on first use
+  if (!m_reconnect_thread)
+  {
+    try
+    {
+      m_reconnect_thread.reset(new std::thread(&rtRemoteServer::runReconnects, this));
+    }
+    catch (std::exception const& err)
+    {
+      rtLogError("failed to start reconnect thread. %s", err.what());
+      return;
+    }
+  }
+
+  m_reconnect_queue.push_back(client);
+  m_reconnect_cond.notify_all();
+}
+
+void
+rtRemoteServer::runReconnects()
+{
+  std::unique_lock<std::mutex> lock(m_reconnect_mutex);
+  while (true)
+  {
+    m_reconnect_cond.wait(lock, [this] { return m_reconnect_stopped || !m_reconnect_queue.empty(); });
+    if (m_reconnect_stopped)
+      return;
+
+    std::shared_ptr<rtRemoteClient> client = m_reconnect_queue.front().lock();
+    m_reconnect_queue.pop_front();
+    if (!client)
+      continue;
+
+    lock.unlock();
+    client->runReconnect(this);
+    client.reset();
+    lock.lock();
+  }
+}
+
+rtError
+rtRemoteServer::locateObject(std::string const& objectId, sockaddr_storage& endpoint, uint32_t timeout)
+{
+  if (!m_resolver)
+    return RT_FAIL;
+  return m_resolver->locateObject(objectId, endpoint, timeout);
 }
 
 rtError
@@ -640,11 +920,26 @@ rtRemoteServer::openRpcListener()
   char path[UNIX_PATH_MAX];
 
   memset(path, 0, sizeof(path));
-  cleanupStaleUnixSockets();
 
-  if (isUnixDomain(m_env))
+  if (isAbstractUnixDomain(m_env))
+  {
+    rtError e = rtCreateAbstractSocketName(0, path, sizeof(path));
+    if (e != RT_OK)
+      return e;
+
+    rtParseAddress(m_rpc_endpoint, path, 0, nullptr);
+  }
+  else if (isUnixDomain(m_env))
   {
-    rtError e = rtCreateUnixSocketName(0, path, sizeof(path));
+    std::string const dir = m_env->Config->server_socket_dir();
+
+    rtError e = rtCreateSocketDirectory(dir.c_str());
+    if (e != RT_OK)
+      return e;
+
+    cleanupStaleUnixSockets(dir);
+
+    e = rtCreateUnixSocketName(dir.c_str(), 0, path, sizeof(path));
     if (e != RT_OK)
       return e;
 
@@ -681,11 +976,17 @@ rtRemoteServer::openRpcListener()
 
   fcntl(m_listen_fd, F_SETFD, fcntl(m_listen_fd, F_GETFD) | FD_CLOEXEC);
 
-  if (m_rpc_endpoint.ss_family != AF_UNIX)
+  bool const reusePort = m_rpc_endpoint.ss_family != AF_UNIX
+    && m_env->Config->server_accept_threads() > 1;
+
+  // buffer sizes have to be on the listener to count for the handshake
+  rtApplySocketOptions(m_listen_fd, m_rpc_endpoint.ss_family, m_socket_options);
+
+  if (reusePort)
   {
     uint32_t one = 1;
-    if (-1 == setsockopt(m_listen_fd, SOL_TCP, TCP_NODELAY, &one, sizeof(one)))
-      rtLogError("setting TCP_NODELAY failed");
+    if (-1 == setsockopt(m_listen_fd, SOL_SOCKET, SO_REUSEPORT, &one, sizeof(one)))
+      rtLogError("setting SO_REUSEPORT failed");
   }
 
   socklen_t len;
@@ -710,7 +1011,7 @@ rtRemoteServer::openRpcListener()
     return e;
   }
 
-  ret = listen(m_listen_fd, 2);
+  ret = listen(m_listen_fd, m_env->Config->server_listen_backlog());
   if (ret < 0)
   {
     rtError e = rtErrorFromErrno(errno);
@@ -718,6 +1019,51 @@ rtRemoteServer::openRpcListener()
     return e;
   }
 
+  if (reusePort)
+    return openReusePortListeners();
+
+  return RT_OK;
+}
+
+// more listeners on the port the first one got, each served by its own
+// acceptor thread
+rtError
+rtRemoteServer::openReusePortListeners()
+{
+  socklen_t len;
+  rtSocketGetLength(m_rpc_endpoint, &len);
+
+  int const backlog = m_env->Config->server_listen_backlog();
+  for (int i = 1; i < m_env->Config->server_accept_threads(); ++i)
+  {
+    int fd = socket(m_rpc_endpoint.ss_family, SOCK_STREAM, 0);
+    if (fd < 0)
+    {
+      rtError e = rtErrorFromErrno(errno);
+      rtLogError("failed to create socket. %s", rtStrError(e));
+      return e;
+    }
+    fcntl(fd, F_SETFD, fcntl(fd, F_GETFD) | FD_CLOEXEC);
+    fcntl(fd, F_SETFL, O_NONBLOCK);
+
+    rtApplySocketOptions(fd, m_rpc_endpoint.ss_family, m_socket_options);
+
+    uint32_t one = 1;
+    if (setsockopt(fd, SOL_SOCKET, SO_REUSEPORT, &one, sizeof(one)) == -1
+      || ::bind(fd, reinterpret_cast<sockaddr *>(&m_rpc_endpoint), len) == -1
+      || listen(fd, backlog) == -1)
+    {
+      // the main listener still works
+      rtError e = rtErrorFromErrno(errno);
+      rtLogWarn("failed to open extra listener. %s", rtStrError(e));
+      ::close(fd);
+      break;
+    }
+    m_reuseport_fds.push_back(fd);
+  }
+
+  rtLogInfo("%d extra listeners on %s", static_cast<int>(m_reuseport_fds.size()),
+    rtSocketToString(m_rpc_endpoint).c_str());
   return RT_OK;
 }
 
@@ -749,7 +1095,7 @@ rtRemoteServer::onOpenSession(std::shared_ptr<rtRemoteClient>& client, rtRemoteM
 
   rtError err = RT_OK;
 
-  rtRemoteMessagePtr res(new rapidjson::Document());
+  rtRemoteMessagePtr res(new rtRemoteMessage());
   res->SetObject();
   res->AddMember(kFieldNameMessageType, kMessageTypeOpenSessionResponse, res->GetAllocator());
   res->AddMember(kFieldNameObjectId, std::string(objectId), res->GetAllocator());
@@ -759,13 +1105,21 @@ rtRemoteServer::onOpenSession(std::shared_ptr<rtRemoteClient>& client, rtRemoteM
   return err;
 }
 
+// responses to pipelined session opens, and to ones that timed out, have
+// nobody waiting on them
+rtError
+rtRemoteServer::onOpenSessionResponse(std::shared_ptr<rtRemoteClient>& /*client*/, rtRemoteMessagePtr const& /*doc*/)
+{
+  return RT_OK;
+}
+
 rtError
 rtRemoteServer::onGet(std::shared_ptr<rtRemoteClient>& client, rtRemoteMessagePtr const& doc)
 {
   rtRemoteCorrelationKey key = rtMessage_GetCorrelationKey(*doc);
   char const* objectId = rtMessage_GetObjectId(*doc);
 
-  rtRemoteMessagePtr res(new rapidjson::Document());
+  rtRemoteMessagePtr res(new rtRemoteMessage());
   res->SetObject();
   res->AddMember(kFieldNameMessageType, kMessageTypeGetByNameResponse, res->GetAllocator());
   res->AddMember(kFieldNameCorrelationKey, key.toString(), res->GetAllocator());
@@ -809,7 +1163,7 @@ rtRemoteServer::onGet(std::shared_ptr<rtRemoteClient>& client, rtRemoteMessagePt
         if (name)
         {
           rtFunctionRef ref = value.toFunction();
-          rtRemoteFunction* remoteFunc = dynamic_cast<rtRemoteFunction *>(ref.getPtr());
+          rtRemoteFunction* remoteFunc = rtRemoteFunction::fromFunction(ref.getPtr());
           if (remoteFunc != nullptr)
             val.AddMember(kFieldNameFunctionName, remoteFunc->getName(), res->GetAllocator());
           else
@@ -847,7 +1201,7 @@ rtRemoteServer::onSet(std::shared_ptr<rtRemoteClient>& client, rtRemoteMessagePt
   rtRemoteCorrelationKey key = rtMessage_GetCorrelationKey(*doc);
   char const* objectId = rtMessage_GetObjectId(*doc);
 
-  rtRemoteMessagePtr res(new rapidjson::Document());
+  rtRemoteMessagePtr res(new rtRemoteMessage());
   res->SetObject();
   res->AddMember(kFieldNameMessageType, kMessageTypeSetByNameResponse, res->GetAllocator());
   res->AddMember(kFieldNameCorrelationKey, key.toString(), res->GetAllocator());
@@ -870,7 +1224,7 @@ rtRemoteServer::onSet(std::shared_ptr<rtRemoteClient>& client, rtRemoteMessagePt
     RT_ASSERT(itr != doc->MemberEnd());
 
     if (itr != doc->MemberEnd())
-      err = rtRemoteValueReader::read(m_env, value, itr->value, client);
+      err = rtRemoteValueReader::read(m_env, value, itr->value, *doc, client);
 
     if (err == RT_OK)
     {
@@ -901,7 +1255,7 @@ rtRemoteServer::onMethodCall(std::shared_ptr<rtRemoteClient>& client, rtRemoteMe
   char const* objectId = rtMessage_GetObjectId(*doc);
   rtError err   = RT_OK;
 
-  rtRemoteMessagePtr res(new rapidjson::Document());
+  rtRemoteMessagePtr res(new rtRemoteMessage());
   res->SetObject();
   res->AddMember(kFieldNameMessageType, kMessageTypeMethodCallResponse, res->GetAllocator());
   res->AddMember(kFieldNameCorrelationKey, key.toString(), res->GetAllocator());
@@ -943,7 +1297,7 @@ rtRemoteServer::onMethodCall(std::shared_ptr<rtRemoteClient>& client, rtRemoteMe
         for (rapidjson::Value::ConstValueIterator itr = args.Begin(); itr != args.End(); ++itr)
         {
           rtValue arg;
-          rtRemoteValueReader::read(m_env, arg, *itr, client);
+          rtRemoteValueReader::read(m_env, arg, *itr, *doc, client);
           argv.push_back(arg);
         }
       }
@@ -998,7 +1352,7 @@ rtRemoteServer::onKeepAlive(std::shared_ptr<rtRemoteClient>& client, rtRemoteMes
     rtLogWarn("got keep-alive without any interesting information");
   }
 
-  rtRemoteMessagePtr res(new rapidjson::Document());
+  rtRemoteMessagePtr res(new rtRemoteMessage());
   res->SetObject();
   res->AddMember(kFieldNameCorrelationKey, key.toString(), res->GetAllocator());
   res->AddMember(kFieldNameMessageType, kMessageTypeKeepAliveResponse, res->GetAllocator());
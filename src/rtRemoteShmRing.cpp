@@ -0,0 +1,414 @@
+/*
+
+pxCore Copyright 2005-2018 John Robinson
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+*/
+
+#include "rtRemoteShmRing.h"
+
+#include <rtLog.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <new>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#ifdef __linux__
+#include <sys/eventfd.h>
+#include <sys/syscall.h>
+#endif
+
+#ifndef MFD_CLOEXEC
+#define MFD_CLOEXEC 0x0001U
+#endif
+
+#define kShmRingMagic 0x72745348
+#define kShmHeaderSize 256
+
+static_assert(ATOMIC_INT_LOCK_FREE == 2, "shared memory ring needs lock free 32 bit atomics");
+
+// Head and Tail are free running byte counts. Size is a power of two so the
+// offsets stay correct when they wrap. Waiting is raised by a producer
+// that found the ring full, so the consumer knows to signal space.
+struct rtRemoteShmRing::Header
+{
+  uint32_t              Magic;
+  uint32_t              Size;
+  std::atomic<uint32_t> Closed;
+  std::atomic<uint32_t> Waiting;
+  char                  Pad0[48];
+  std::atomic<uint32_t> Head;
+  char                  Pad1[60];
+  std::atomic<uint32_t> Tail;
+  char                  Pad2[60];
+};
+
+namespace
+{
+  uint32_t
+  roundUpToPowerOfTwo(uint32_t n)
+  {
+    uint32_t size = 4096;
+    while (size < n && size < (1u << 30))
+      size <<= 1;
+    return size;
+  }
+
+  int
+  remainingMillis(std::chrono::steady_clock::time_point deadline)
+  {
+    auto left = std::chrono::duration_cast<std::chrono::milliseconds>(
+      deadline - std::chrono::steady_clock::now()).count();
+    return left > 0 ? static_cast<int>(left) : 0;
+  }
+}
+
+rtRemoteShmRing::rtRemoteShmRing(int memFd, int eventFd, int spaceFd, void* base, size_t mappedSize)
+  : m_mem_fd(memFd)
+  , m_event_fd(eventFd)
+  , m_space_fd(spaceFd)
+  , m_base(base)
+  , m_mapped_size(mappedSize)
+  , m_header(reinterpret_cast<Header *>(base))
+  , m_data(reinterpret_cast<char *>(base) + kShmHeaderSize)
+  , m_size(static_cast<uint32_t>(mappedSize - kShmHeaderSize))
+  , m_index(0)
+{
+  static_assert(sizeof(Header) <= kShmHeaderSize, "ring header too big");
+}
+
+rtRemoteShmRing::~rtRemoteShmRing()
+{
+  if (m_base)
+    munmap(m_base, m_mapped_size);
+  if (m_mem_fd != -1)
+    ::close(m_mem_fd);
+  if (m_event_fd != -1)
+    ::close(m_event_fd);
+  if (m_space_fd != -1)
+    ::close(m_space_fd);
+}
+
+rtError
+rtRemoteShmRing::create(uint32_t size, std::unique_ptr<rtRemoteShmRing>& ring)
+{
+#ifdef __linux__
+  size = roundUpToPowerOfTwo(size);
+
+  int memFd = static_cast<int>(syscall(SYS_memfd_create, "rt_remote_shm", MFD_CLOEXEC));
+  if (memFd == -1)
+  {
+    rtError e = rtErrorFromErrno(errno);
+    rtLogError("failed to create shared memory. %s", rtStrError(e));
+    return e;
+  }
+
+  size_t mappedSize = kShmHeaderSize + size;
+  if (ftruncate(memFd, static_cast<off_t>(mappedSize)) == -1)
+  {
+    rtError e = rtErrorFromErrno(errno);
+    rtLogError("failed to size shared memory. %s", rtStrError(e));
+    ::close(memFd);
+    return e;
+  }
+
+  int eventFd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+  int spaceFd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+  if (eventFd == -1 || spaceFd == -1)
+  {
+    rtError e = rtErrorFromErrno(errno);
+    rtLogError("failed to create eventfd. %s", rtStrError(e));
+    ::close(memFd);
+    if (eventFd != -1)
+      ::close(eventFd);
+    if (spaceFd != -1)
+      ::close(spaceFd);
+    return e;
+  }
+
+  void* base = mmap(nullptr, mappedSize, PROT_READ | PROT_WRITE, MAP_SHARED, memFd, 0);
+  if (base == MAP_FAILED)
+  {
+    rtError e = rtErrorFromErrno(errno);
+    rtLogError("failed to map shared memory. %s", rtStrError(e));
+    ::close(memFd);
+    ::close(eventFd);
+    ::close(spaceFd);
+    return e;
+  }
+
+  Header* header = new (base) Header();
+  header->Magic = kShmRingMagic;
+  header->Size = size;
+  header->Closed.store(0);
+  header->Waiting.store(0);
+  header->Head.store(0);
+  header->Tail.store(0);
+
+  ring.reset(new rtRemoteShmRing(memFd, eventFd, spaceFd, base, mappedSize));
+  return RT_OK;
+#else
+  (void) size;
+  (void) ring;
+  return RT_ERROR_NOT_IMPLEMENTED;
+#endif
+}
+
+rtError
+rtRemoteShmRing::attach(int memFd, int eventFd, int spaceFd, std::unique_ptr<rtRemoteShmRing>& ring)
+{
+  // the size comes from the file, which the peer can't change under a
+  // mapping the way it can change the header
+  struct stat st;
+  if (fstat(memFd, &st) == -1 || st.st_size <= kShmHeaderSize
+    || st.st_size > static_cast<off_t>(kShmHeaderSize) + (1u << 30))
+  {
+    rtLogError("shared memory fd %d is not a ring", memFd);
+    ::close(memFd);
+    ::close(eventFd);
+    ::close(spaceFd);
+    return RT_ERROR_INVALID_ARG;
+  }
+
+  size_t mappedSize = static_cast<size_t>(st.st_size);
+  uint32_t size = static_cast<uint32_t>(mappedSize - kShmHeaderSize);
+  if ((size & (size - 1)) != 0)
+  {
+    rtLogError("shared memory fd %d has a bad ring size %u", memFd, size);
+    ::close(memFd);
+    ::close(eventFd);
+    ::close(spaceFd);
+    return RT_ERROR_PROTOCOL_ERROR;
+  }
+
+  void* base = mmap(nullptr, mappedSize, PROT_READ | PROT_WRITE, MAP_SHARED, memFd, 0);
+  if (base == MAP_FAILED)
+  {
+    rtError e = rtErrorFromErrno(errno);
+    rtLogError("failed to map shared memory. %s", rtStrError(e));
+    ::close(memFd);
+    ::close(eventFd);
+    ::close(spaceFd);
+    return e;
+  }
+
+  ring.reset(new rtRemoteShmRing(memFd, eventFd, spaceFd, base, mappedSize));
+
+  Header const* header = ring->m_header;
+  if (header->Magic != kShmRingMagic || header->Size != size
+    || header->Head.load() != 0 || header->Tail.load() != 0)
+  {
+    rtLogError("shared memory fd %d has a bad ring header", memFd);
+    ring.reset();
+    return RT_ERROR_PROTOCOL_ERROR;
+  }
+
+  return RT_OK;
+}
+
+rtError
+rtRemoteShmRing::write(iovec const* iov, int n, uint32_t timeoutMillis)
+{
+  uint32_t const size = m_size;
+  uint32_t head = m_index;
+
+  auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeoutMillis);
+
+  for (int i = 0; i < n; ++i)
+  {
+    char const* p = static_cast<char const *>(iov[i].iov_base);
+    size_t left = iov[i].iov_len;
+
+    while (left > 0)
+    {
+      if (m_header->Closed.load(std::memory_order_acquire))
+        return RT_ERROR_STREAM_CLOSED;
+
+      uint32_t tail = m_header->Tail.load(std::memory_order_acquire);
+      uint32_t used = head - tail;
+      if (used > size)
+      {
+        rtLogError("shared memory ring tail %u is out of range", tail);
+        return RT_ERROR_PROTOCOL_ERROR;
+      }
+
+      uint32_t space = size - used;
+      if (space == 0)
+      {
+        // publish what we have so the reader can make room, then wait for
+        // it to say it did
+        m_header->Head.store(head, std::memory_order_release);
+        m_index = head;
+        signal(m_event_fd);
+
+        int millis = remainingMillis(deadline);
+        bool woken = millis > 0;
+        if (woken)
+        {
+          // look at Tail again after raising the flag. The reader stores
+          // Tail before it checks the flag, so one of us sees the other.
+          m_header->Waiting.store(1, std::memory_order_seq_cst);
+          if (m_header->Tail.load(std::memory_order_seq_cst) == tail)
+            woken = waitFor(m_space_fd, millis);
+          m_header->Waiting.store(0, std::memory_order_seq_cst);
+        }
+        if (!woken)
+        {
+          rtLogWarn("timed out waiting for room in shared memory ring");
+          return RT_ERROR_TIMEOUT;
+        }
+        continue;
+      }
+
+      uint32_t chunk = static_cast<uint32_t>(std::min(left, static_cast<size_t>(space)));
+      uint32_t offset = head & (size - 1);
+      uint32_t first = std::min(chunk, size - offset);
+
+      memcpy(m_data + offset, p, first);
+      if (chunk > first)
+        memcpy(m_data, p + first, chunk - first);
+
+      head += chunk;
+      p += chunk;
+      left -= chunk;
+    }
+  }
+
+  m_header->Head.store(head, std::memory_order_release);
+  m_index = head;
+  signal(m_event_fd);
+  return RT_OK;
+}
+
+rtError
+rtRemoteShmRing::read(char* buff, uint32_t n, uint32_t timeoutMillis)
+{
+  uint32_t const size = m_size;
+  uint32_t tail = m_index;
+
+  auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeoutMillis);
+
+  while (n > 0)
+  {
+    uint32_t head = m_header->Head.load(std::memory_order_acquire);
+    uint32_t avail = head - tail;
+    if (avail > size)
+    {
+      rtLogError("shared memory ring head %u is out of range", head);
+      return RT_ERROR_PROTOCOL_ERROR;
+    }
+
+    if (avail == 0)
+    {
+      if (m_header->Closed.load(std::memory_order_acquire))
+        return rtErrorFromErrno(ENOTCONN);
+
+      int millis = remainingMillis(deadline);
+      if (millis == 0 || !waitFor(m_event_fd, millis))
+      {
+        rtLogWarn("timed out waiting for data in shared memory ring");
+        return RT_ERROR_TIMEOUT;
+      }
+      continue;
+    }
+
+    uint32_t chunk = std::min(n, avail);
+    uint32_t offset = tail & (size - 1);
+    uint32_t first = std::min(chunk, size - offset);
+
+    memcpy(buff, m_data + offset, first);
+    if (chunk > first)
+      memcpy(buff + first, m_data, chunk - first);
+
+    tail += chunk;
+    buff += chunk;
+    n -= chunk;
+
+    m_header->Tail.store(tail, std::memory_order_seq_cst);
+    m_index = tail;
+
+    if (m_header->Waiting.load(std::memory_order_seq_cst))
+      signal(m_space_fd);
+  }
+
+  return RT_OK;
+}
+
+bool
+rtRemoteShmRing::isEmpty() const
+{
+  return m_header->Head.load(std::memory_order_acquire) == m_index;
+}
+
+uint32_t
+rtRemoteShmRing::available() const
+{
+  // a bad Head is caught by read()
+  return std::min(m_header->Head.load(std::memory_order_acquire) - m_index, m_size);
+}
+
+void
+rtRemoteShmRing::clearSignal()
+{
+  drain(m_event_fd);
+}
+
+void
+rtRemoteShmRing::close()
+{
+  m_header->Closed.store(1, std::memory_order_release);
+  signal(m_event_fd);
+  signal(m_space_fd);
+}
+
+void
+rtRemoteShmRing::signal(int fd)
+{
+  uint64_t one = 1;
+  ssize_t n = ::write(fd, &one, sizeof(one));
+  (void) n;
+}
+
+void
+rtRemoteShmRing::drain(int fd)
+{
+  uint64_t count = 0;
+  ssize_t n = ::read(fd, &count, sizeof(count));
+  (void) n;
+}
+
+bool
+rtRemoteShmRing::waitFor(int fd, int timeoutMillis)
+{
+  pollfd pfd;
+  pfd.fd = fd;
+  pfd.events = POLLIN;
+  pfd.revents = 0;
+
+  int ret = poll(&pfd, 1, timeoutMillis);
+  if (ret <= 0)
+    return ret == -1 && errno == EINTR;
+
+  drain(fd);
+  return true;
+}
@@ -17,17 +17,26 @@ limitations under the License.
 */
 
 #include "rtRemoteSocketUtils.h"
+#include "rtRemoteConfig.h"
 
+#include <algorithm>
+#include <chrono>
 #include <cstdio>
 #include <sstream>
 
+#include <limits.h>
+#include <stddef.h>
 #include <netinet/in.h>
 #include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
 #include <arpa/inet.h>
 #include <net/if.h>
 #include <ifaddrs.h>
 #include <string.h>
 #include <netdb.h>
+#include <sys/uio.h>
+#include <sys/stat.h>
 #include <unistd.h>
 
 #include <rtLog.h>
@@ -36,6 +45,327 @@ limitations under the License.
 #include <rapidjson/stringbuffer.h>
 #include <rapidjson/writer.h>
 
+// set on the length word of a frame that is followed by attachments:
+//   [u32 json length | flag][json][u32 count]([u32 length][bytes])...
+#define kFrameFlagAttachments 0x80000000u
+#define kMaxAttachmentsPerFrame 4096
+#define kMaxFileDescriptorsPerFrame 8
+
+namespace
+{
+  // sendmsg until every byte has gone out. Large frames may be accepted by
+  // the kernel in pieces. Any descriptors ride along with the first piece.
+  rtError
+  sendAll(int fd, iovec* iov, int n, int const* fds, int numFds)
+  {
+    int flags = 0;
+    #ifndef __APPLE__
+    flags = MSG_NOSIGNAL;
+    #endif
+
+    char control[CMSG_SPACE(sizeof(int) * kMaxFileDescriptorsPerFrame)];
+
+    while (n > 0)
+    {
+      struct msghdr msg;
+      memset(&msg, '\0', sizeof(msg));
+      msg.msg_iov = iov;
+      msg.msg_iovlen = std::min(n, static_cast<int>(IOV_MAX));
+
+      if (numFds > 0)
+      {
+        RT_ASSERT(numFds <= kMaxFileDescriptorsPerFrame);
+        memset(control, 0, sizeof(control));
+        msg.msg_control = control;
+        msg.msg_controllen = CMSG_SPACE(sizeof(int) * numFds);
+
+        cmsghdr* cmsg = CMSG_FIRSTHDR(&msg);
+        cmsg->cmsg_level = SOL_SOCKET;
+        cmsg->cmsg_type = SCM_RIGHTS;
+        cmsg->cmsg_len = CMSG_LEN(sizeof(int) * numFds);
+        memcpy(CMSG_DATA(cmsg), fds, sizeof(int) * numFds);
+      }
+
+      ssize_t sent = sendmsg(fd, &msg, flags);
+      if (sent < 0)
+      {
+        if (errno == EINTR)
+          continue;
+        rtError e = rtErrorFromErrno(errno);
+        rtLogError("failed to send message. %s", rtStrError(e));
+        return e;
+      }
+
+      numFds = 0;
+
+      size_t count = static_cast<size_t>(sent);
+      while (n > 0 && count >= iov->iov_len)
+      {
+        count -= iov->iov_len;
+        ++iov;
+        --n;
+      }
+      if (n > 0)
+      {
+        iov->iov_base = static_cast<char *>(iov->iov_base) + count;
+        iov->iov_len -= count;
+      }
+    }
+
+    return RT_OK;
+  }
+
+  rtError
+  writeFrame(rapidjson::StringBuffer const& buff, rtRemoteAttachmentList const* attachments,
+    rtRemoteFrameWriter const& out)
+  {
+    size_t const numAttachments = attachments ? attachments->size() : 0;
+
+    // network order length words. sized up front so iovecs can point into it
+    std::vector<uint32_t> words(numAttachments + 2);
+    std::vector<iovec> iov;
+    iov.reserve(numAttachments * 2 + 3);
+
+    uint32_t header = static_cast<uint32_t>(buff.GetSize());
+    if (numAttachments > 0)
+      header |= kFrameFlagAttachments;
+    words[0] = htonl(header);
+
+    iov.push_back({ &words[0], sizeof(uint32_t) });
+    iov.push_back({ const_cast<char *>(buff.GetString()), buff.GetSize() });
+
+    if (numAttachments > 0)
+    {
+      words[1] = htonl(static_cast<uint32_t>(numAttachments));
+      iov.push_back({ &words[1], sizeof(uint32_t) });
+
+      for (size_t i = 0; i < numAttachments; ++i)
+      {
+        rtRemoteAttachment const& a = (*attachments)[i];
+        words[i + 2] = htonl(a.Length);
+        iov.push_back({ &words[i + 2], sizeof(uint32_t) });
+        iov.push_back({ const_cast<char *>(a.Data), a.Length });
+      }
+    }
+
+    return out(&iov[0], static_cast<int>(iov.size()));
+  }
+
+  rtError
+  discardBytes(rtRemoteFrameReader const& in, uint32_t n)
+  {
+    char buff[4096];
+    while (n > 0)
+    {
+      uint32_t chunk = std::min(n, static_cast<uint32_t>(sizeof(buff)));
+      rtError e = in(buff, chunk);
+      if (e != RT_OK)
+        return e;
+      n -= chunk;
+    }
+    return RT_OK;
+  }
+
+  // reads each attachment straight into its own buffer. One that is over
+  // the limit is drained and left empty so the stream stays in sync. A frame
+  // whose attachments add up to more than maxFrameBytes fails.
+  rtError
+  readAttachments(rtRemoteFrameReader const& in, rtRemoteAttachmentList& attachments,
+    uint32_t maxAttachmentSize, uint32_t maxFrameBytes)
+  {
+    uint64_t total = 0;
+    uint32_t count = 0;
+    rtError e = in(reinterpret_cast<char *>(&count), 4);
+    if (e != RT_OK)
+      return e;
+
+    count = ntohl(count);
+    if (count > kMaxAttachmentsPerFrame)
+    {
+      rtLogError("frame has %u attachments, limit is %d", count, kMaxAttachmentsPerFrame);
+      return RT_ERROR_PROTOCOL_ERROR;
+    }
+
+    attachments.reserve(count);
+    for (uint32_t i = 0; i < count; ++i)
+    {
+      uint32_t length = 0;
+      e = in(reinterpret_cast<char *>(&length), 4);
+      if (e != RT_OK)
+        return e;
+      length = ntohl(length);
+
+      total += length;
+      if (total > maxFrameBytes)
+      {
+        rtLogError("frame attachments exceed %u bytes", maxFrameBytes);
+        return RT_ERROR_PROTOCOL_ERROR;
+      }
+
+      rtRemoteAttachment a;
+      a.Data = nullptr;
+      a.Length = 0;
+
+      if (length > maxAttachmentSize)
+      {
+        rtLogWarn("discarding attachment of %u bytes, limit is %u", length, maxAttachmentSize);
+        e = discardBytes(in, length);
+        if (e != RT_OK)
+          return e;
+      }
+      else
+      {
+        // extra nul so string values can be used in place
+        std::shared_ptr<std::vector<char>> data(new std::vector<char>(length + 1));
+        (*data)[length] = '\0';
+        if (length > 0)
+        {
+          e = in(&(*data)[0], length);
+          if (e != RT_OK)
+            return e;
+        }
+        a.Data = &(*data)[0];
+        a.Length = length;
+        a.Owner = data;
+      }
+      attachments.push_back(a);
+    }
+
+    return RT_OK;
+  }
+
+  // everything after the length word
+  rtError
+  readFrameBody(rtRemoteFrameReader const& in, uint32_t header, rtRemoteSocketBuffer& buff,
+    rtRemoteMessagePtr& doc, uint32_t maxAttachmentSize, uint32_t maxFrameAttachmentBytes)
+  {
+    bool const hasAttachments = (header & kFrameFlagAttachments) != 0;
+    int n = static_cast<int>(header & ~kFrameFlagAttachments);
+    int capacity = static_cast<int>(buff.capacity());
+
+    if (n > capacity)
+    {
+      rtLogWarn("buffer capacity %d not big enough for message size: %d", capacity, n);
+      // TODO: should drain, and discard message
+      RT_ASSERT(false);
+      return RT_FAIL;
+    }
+
+    buff.resize(n + 1);
+    buff[n] = '\0';
+
+    rtError err = in(&buff[0], static_cast<uint32_t>(n));
+    if (err != RT_OK)
+    {
+      rtLogError("failed to read payload message of length %d", n);
+      return err;
+    }
+
+    #ifdef RT_RPC_DEBUG
+    rtLogDebug("read (%d):\n***IN***\t\"%.*s\"\n", static_cast<int>(buff.size()), static_cast<int>(buff.size()), &buff[0]);
+    #endif
+
+    rtRemoteAttachmentList attachments;
+    if (hasAttachments)
+    {
+      err = readAttachments(in, attachments, maxAttachmentSize, maxFrameAttachmentBytes);
+      if (err != RT_OK)
+        return err;
+    }
+
+    err = rtParseMessage(&buff[0], n, doc);
+    if (err == RT_OK && hasAttachments)
+      doc->setAttachments(std::move(attachments));
+
+    return err;
+  }
+
+  // reads the length word with recvmsg so descriptors sent along with the
+  // frame are picked up
+  rtError
+  readHeader(int fd, uint32_t* header, std::vector<int>& fds)
+  {
+    char control[CMSG_SPACE(sizeof(int) * kMaxFileDescriptorsPerFrame)];
+
+    iovec iov;
+    iov.iov_base = header;
+    iov.iov_len = sizeof(uint32_t);
+
+    struct msghdr msg;
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control;
+    msg.msg_controllen = sizeof(control);
+
+    int flags = 0;
+    #ifdef MSG_CMSG_CLOEXEC
+    flags = MSG_CMSG_CLOEXEC;
+    #endif
+
+    ssize_t n = 0;
+    do
+    {
+      n = recvmsg(fd, &msg, flags);
+    }
+    while (n == -1 && errno == EINTR);
+
+    if (n == 0)
+      return rtErrorFromErrno(ENOTCONN);
+
+    if (n == -1)
+    {
+      rtError e = rtErrorFromErrno(errno);
+      rtLogError("failed to read from fd %d. %s", fd, rtStrError(e));
+      return e;
+    }
+
+    for (cmsghdr* cmsg = CMSG_FIRSTHDR(&msg); cmsg != nullptr; cmsg = CMSG_NXTHDR(&msg, cmsg))
+    {
+      if (cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SCM_RIGHTS)
+      {
+        int count = static_cast<int>((cmsg->cmsg_len - CMSG_LEN(0)) / sizeof(int));
+        int const* p = reinterpret_cast<int const *>(CMSG_DATA(cmsg));
+        fds.insert(fds.end(), p, p + count);
+      }
+    }
+
+    if (n < static_cast<ssize_t>(sizeof(uint32_t)))
+      return rtReadUntil(fd, reinterpret_cast<char *>(header) + n, static_cast<int>(sizeof(uint32_t) - n));
+
+    return RT_OK;
+  }
+
+  // starts a non-blocking connect. in progress is RT_ERROR_IN_PROGRESS,
+  // anything else but RT_OK means this endpoint is out
+  rtError
+  startConnect(sockaddr_storage const& endpoint, rtRemoteSocketOptions const* opts, int& fd)
+  {
+    fd = socket(endpoint.ss_family, SOCK_STREAM, 0);
+    if (fd < 0)
+      return rtErrorFromErrno(errno);
+
+    fcntl(fd, F_SETFD, fcntl(fd, F_GETFD) | FD_CLOEXEC);
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+
+    if (opts)
+      rtApplySocketOptions(fd, endpoint.ss_family, *opts);
+
+    socklen_t len;
+    rtSocketGetLength(endpoint, &len);
+
+    int ret = ::connect(fd, reinterpret_cast<sockaddr const *>(&endpoint), len);
+    if (ret == 0)
+      return RT_OK;
+    if (errno == EINPROGRESS)
+      return RT_ERROR_IN_PROGRESS;
+
+    rtError e = rtErrorFromErrno(errno);
+    rtCloseSocket(fd);
+    return e;
+  }
+}
+
 #ifndef RT_REMOTE_LOOPBACK_ONLY
 static rtError
 rtFindFirstInetInterface(char* name, size_t len)
@@ -88,6 +418,15 @@ rtParseAddress(sockaddr_storage& ss, char const* addr, uint16_t port, uint32_t*
     return RT_OK;
   }
 
+  if (addr[0] == '@')
+  {
+    sockaddr_un *unAddr = reinterpret_cast<sockaddr_un*>(&ss);
+    memset(unAddr->sun_path, 0, UNIX_PATH_MAX);
+    unAddr->sun_family = AF_UNIX;
+    strncpy(unAddr->sun_path + 1, addr + 1, UNIX_PATH_MAX - 1);
+    return RT_OK;
+  }
+
   sockaddr_in* v4 = reinterpret_cast<sockaddr_in *>(&ss);
   ret = inet_pton(AF_INET, addr, &v4->sin_addr);
 
@@ -141,6 +480,19 @@ rtParseAddress(sockaddr_storage& ss, char const* addr, uint16_t port, uint32_t*
   return RT_OK;
 }
 
+rtError
+rtMessage_GetEndpoint(rapidjson::Value const& doc, sockaddr_storage& ss)
+{
+  rapidjson::Value::ConstMemberIterator ip = doc.FindMember(kFieldNameIp);
+  rapidjson::Value::ConstMemberIterator port = doc.FindMember(kFieldNamePort);
+  if (ip == doc.MemberEnd() || !ip->value.IsString() || port == doc.MemberEnd() || !port->value.IsUint()
+    || port->value.GetUint() > 65535)
+    return RT_ERROR_INVALID_ARG;
+
+  memset(&ss, 0, sizeof(ss));
+  return rtParseAddress(ss, ip->value.GetString(), static_cast<uint16_t>(port->value.GetUint()), nullptr);
+}
+
 rtError
 rtSocketGetLength(sockaddr_storage const& ss, socklen_t* len)
 {
@@ -152,7 +504,14 @@ rtSocketGetLength(sockaddr_storage const& ss, socklen_t* len)
   else if (ss.ss_family == AF_INET6)
     *len = sizeof(sockaddr_in6);
   else if (ss.ss_family == AF_UNIX)
-    *len = sizeof(sockaddr_un);
+  {
+    // abstract names are matched on their exact length, not the whole of sun_path
+    sockaddr_un const* un = reinterpret_cast<sockaddr_un const *>(&ss);
+    if (un->sun_path[0] == '\0' && un->sun_path[1] != '\0')
+      *len = offsetof(sockaddr_un, sun_path) + 1 + strnlen(un->sun_path + 1, UNIX_PATH_MAX - 1);
+    else
+      *len = sizeof(sockaddr_un);
+  }
   else
     *len = sizeof(sockaddr_storage);
 
@@ -314,7 +673,7 @@ rtSocketToString(sockaddr_storage const& ss)
   memset(addrBuff, 0, sizeof(addrBuff));
   if (ss.ss_family == AF_UNIX)
   {
-    strncpy(addrBuff, reinterpret_cast<char const *>(addr), sizeof(addrBuff) -1);
+    strncpy(addrBuff, rtUnixSocketPath(ss).c_str(), sizeof(addrBuff) -1);
     port = 0;
   }
   else
@@ -331,6 +690,38 @@ rtSocketToString(sockaddr_storage const& ss)
   return buff.str();
 }
 
+std::string
+rtUnixSocketPath(sockaddr_storage const& ss)
+{
+  if (ss.ss_family != AF_UNIX)
+    return std::string();
+
+  sockaddr_un const* un = reinterpret_cast<sockaddr_un const *>(&ss);
+  if (un->sun_path[0] != '\0')
+    return std::string(un->sun_path, strnlen(un->sun_path, UNIX_PATH_MAX));
+
+  // an unnamed socket, like the peer of an accepted connection, has no path
+  std::string path(un->sun_path + 1, strnlen(un->sun_path + 1, UNIX_PATH_MAX - 1));
+  if (!path.empty())
+    path.insert(path.begin(), '@');
+  return path;
+}
+
+std::string
+rtSocketAddressToString(sockaddr_storage const& ss)
+{
+  if (ss.ss_family == AF_UNIX)
+    return rtUnixSocketPath(ss);
+
+  void* addr = nullptr;
+  if (rtGetInetAddr(ss, &addr) != RT_OK || !addr)
+    return std::string();
+
+  char buff[INET6_ADDRSTRLEN];
+  char const* p = inet_ntop(ss.ss_family, addr, buff, sizeof(buff));
+  return p ? std::string(p) : std::string();
+}
+
 rtError
 rtSendDocument(rapidjson::Document const& doc, int fd, sockaddr_storage const* dest)
 {
@@ -377,75 +768,141 @@ rtSendDocument(rapidjson::Document const& doc, int fd, sockaddr_storage const* d
   }
   else
   {
-    // send length first
-    int n = buff.GetSize();
-    n = htonl(n);
+    return writeFrame(buff, nullptr, [fd](iovec* iov, int n) { return sendAll(fd, iov, n, nullptr, 0); });
+  }
 
-    struct msghdr msg;
-    struct iovec iov[2];
-    memset (&msg, '\0', sizeof (msg));
-    msg.msg_iov = iov;
-    msg.msg_iovlen = 2;
-    iov[0].iov_base = &n;
-    iov[0].iov_len = sizeof(n);
-    iov[1].iov_base = const_cast<char*>(buff.GetString());
-    iov[1].iov_len = buff.GetSize();
+  return RT_OK;
+}
 
-    int flags = 0;
-    #ifndef __APPLE__
-    flags = MSG_NOSIGNAL;
-    #endif
+rtError
+rtWriteFrame(rtRemoteMessage const& m, rtRemoteFrameWriter const& out)
+{
+  rapidjson::StringBuffer buff;
+  rapidjson::Writer<rapidjson::StringBuffer> writer(buff);
+  m.Accept(writer);
 
-    while (sendmsg (fd, &msg, flags) < 0)
-    {
-      if (errno == EINTR)
-        continue;
-      rtError e = rtErrorFromErrno(errno);
-      rtLogError("failed to send message. %s", rtStrError(e));
-      return e;
-    }
-  }
+  rtRemoteAttachmentList const& attachments = m.getAttachments();
 
-  return RT_OK;
+  #ifdef RT_RPC_DEBUG
+  rtLogDebug("send (%d) +%d attachments:\n***OUT***\t\"%.*s\"\n",
+    static_cast<int>(buff.GetSize()),
+    static_cast<int>(attachments.size()),
+    static_cast<int>(buff.GetSize()),
+    buff.GetString());
+  #endif
+
+  return writeFrame(buff, &attachments, out);
 }
 
 rtError
-rtReadMessage(int fd, rtRemoteSocketBuffer& buff, rtRemoteMessagePtr& doc)
+rtSendMessage(rtRemoteMessage const& m, int fd, int const* fds, int numFds)
 {
-  rtError err = RT_OK;
+  if (numFds > kMaxFileDescriptorsPerFrame)
+    return RT_ERROR_INVALID_ARG;
+
+  if (m.getAttachments().empty() && numFds == 0)
+    return rtSendDocument(m, fd, nullptr);
 
-  int n = 0;
-  int capacity = static_cast<int>(buff.capacity());
+  return rtWriteFrame(m, [fd, fds, numFds](iovec* iov, int n) { return sendAll(fd, iov, n, fds, numFds); });
+}
 
-  err = rtReadUntil(fd, reinterpret_cast<char *>(&n), 4);
+rtError
+rtReadFrame(rtRemoteFrameReader const& in, rtRemoteSocketBuffer& buff, rtRemoteMessagePtr& doc,
+  uint32_t maxAttachmentSize, uint32_t maxFrameAttachmentBytes)
+{
+  uint32_t header = 0;
+  rtError err = in(reinterpret_cast<char *>(&header), 4);
   if (err != RT_OK)
     return err;
 
-  n = ntohl(n);
+  return readFrameBody(in, ntohl(header), buff, doc, maxAttachmentSize, maxFrameAttachmentBytes);
+}
+
+rtError
+rtGetFrameLength(char const* p, uint32_t n, uint32_t maxMessageSize, uint32_t maxFrameAttachmentBytes,
+  uint32_t* length)
+{
+  *length = 0;
 
-  if (n > capacity)
+  auto wordAt = [p](uint64_t offset)
   {
-    rtLogWarn("buffer capacity %d not big enough for message size: %d", capacity, n);
-    // TODO: should drain, and discard message
-    RT_ASSERT(false);
-    return RT_FAIL;
+    uint32_t word = 0;
+    memcpy(&word, p + offset, sizeof(word));
+    return ntohl(word);
+  };
+
+  if (n < 4)
+    return RT_OK;
+
+  uint32_t const header = wordAt(0);
+  uint32_t const size = header & ~kFrameFlagAttachments;
+  if (size > maxMessageSize)
+  {
+    rtLogError("frame of %u bytes is over the %u byte limit", size, maxMessageSize);
+    return RT_ERROR_PROTOCOL_ERROR;
   }
 
-  buff.resize(n + 1);
-  buff[n] = '\0';
+  uint64_t offset = 4 + static_cast<uint64_t>(size);
+  if ((header & kFrameFlagAttachments) != 0)
+  {
+    if (offset + 4 > n)
+      return RT_OK;
 
-  err = rtReadUntil(fd, &buff[0], n);
-  if (err != RT_OK)
+    uint32_t const count = wordAt(offset);
+    if (count > kMaxAttachmentsPerFrame)
+    {
+      rtLogError("frame has %u attachments, limit is %d", count, kMaxAttachmentsPerFrame);
+      return RT_ERROR_PROTOCOL_ERROR;
+    }
+    offset += 4;
+
+    uint64_t total = 0;
+    for (uint32_t i = 0; i < count; ++i)
+    {
+      if (offset + 4 > n)
+        return RT_OK;
+
+      uint32_t const attachmentLength = wordAt(offset);
+      total += attachmentLength;
+      if (total > maxFrameAttachmentBytes)
+      {
+        rtLogError("frame attachments exceed %u bytes", maxFrameAttachmentBytes);
+        return RT_ERROR_PROTOCOL_ERROR;
+      }
+      offset += 4 + static_cast<uint64_t>(attachmentLength);
+    }
+  }
+
+  if (offset <= n)
+    *length = static_cast<uint32_t>(offset);
+  return RT_OK;
+}
+
+rtError
+rtReadMessage(int fd, rtRemoteSocketBuffer& buff, rtRemoteMessagePtr& doc, uint32_t maxAttachmentSize,
+  uint32_t maxFrameAttachmentBytes)
+{
+  uint32_t header = 0;
+  std::vector<int> fds;
+
+  rtError err = readHeader(fd, &header, fds);
+  if (err == RT_OK)
   {
-    rtLogError("failed to read payload message of length %d from socket", n);
-    return err;
+    err = readFrameBody([fd](char* p, uint32_t n) { return rtReadUntil(fd, p, static_cast<int>(n)); },
+      ntohl(header), buff, doc, maxAttachmentSize, maxFrameAttachmentBytes);
   }
 
-  #ifdef RT_RPC_DEBUG
-  rtLogDebug("read (%d):\n***IN***\t\"%.*s\"\n", static_cast<int>(buff.size()), static_cast<int>(buff.size()), &buff[0]);
-  #endif
+  if (err == RT_OK)
+  {
+    doc->setFileDescriptors(std::move(fds));
+  }
+  else
+  {
+    for (int f : fds)
+      ::close(f);
+  }
 
-  return rtParseMessage(&buff[0], n, doc);
+  return err;
 }
 
 rtError
@@ -457,7 +914,7 @@ rtParseMessage(char const* buff, int n, rtRemoteMessagePtr& doc)
   if (!buff)
     return RT_FAIL;
 
-  doc.reset(new rapidjson::Document());
+  doc.reset(new rtRemoteMessage());
 
   rapidjson::MemoryStream stream(buff, n);
   if (doc->ParseStream<rapidjson::kParseDefaultFlags>(stream).HasParseError())
@@ -485,9 +942,7 @@ rtGetPeerName(int fd, sockaddr_storage& endpoint)
   sockaddr_storage addr;
   memset(&addr, 0, sizeof(sockaddr_storage));
 
-  socklen_t len;
-  rtSocketGetLength(endpoint, &len);
-
+  socklen_t len = sizeof(sockaddr_storage);
   int ret = getpeername(fd, (sockaddr *)&addr, &len);
   if (ret == -1)
   {
@@ -506,9 +961,7 @@ rtGetSockName(int fd, sockaddr_storage& endpoint)
   sockaddr_storage addr;
   memset(&addr, 0, sizeof(sockaddr_storage));
 
-  socklen_t len;
-  rtSocketGetLength(endpoint, &len);
-
+  socklen_t len = sizeof(sockaddr_storage);
   int ret = getsockname(fd, (sockaddr *)&addr, &len);
   if (ret == -1)
   {
@@ -556,15 +1009,135 @@ rtGetDefaultInterface(sockaddr_storage& addr, uint16_t port)
 }
 
 rtError
-rtCreateUnixSocketName(pid_t pid, char* buff, int n)
+rtConnectSocket(std::vector<sockaddr_storage> const& endpoints, uint32_t timeout, uint32_t stagger,
+  int& fd, size_t* index, rtRemoteSocketOptions const* opts)
 {
-  if (!buff)
+  using namespace std::chrono;
+
+  fd = kInvalidSocket;
+
+  auto const deadline = steady_clock::now() + milliseconds(timeout);
+  auto nextStart = steady_clock::now();
+
+  std::vector<pollfd> pending;
+  std::vector<size_t> pendingIndex;
+  size_t next = 0;
+  size_t winner = endpoints.size();
+  rtError result = RT_ERROR_TIMEOUT;
+
+  while (winner == endpoints.size())
+  {
+    auto now = steady_clock::now();
+
+    // start the next endpoint once the last one has had its head start,
+    // or right away if nothing else is in flight
+    if (next < endpoints.size() && (now >= nextStart || pending.empty()))
+    {
+      int s = kInvalidSocket;
+      rtError e = startConnect(endpoints[next], opts, s);
+      if (e == RT_OK)
+      {
+        fd = s;
+        winner = next;
+        break;
+      }
+      else if (e == RT_ERROR_IN_PROGRESS)
+      {
+        pollfd p;
+        p.fd = s;
+        p.events = POLLOUT;
+        p.revents = 0;
+        pending.push_back(p);
+        pendingIndex.push_back(next);
+      }
+      else
+      {
+        rtLogDebug("connect to %s failed. %s", rtSocketToString(endpoints[next]).c_str(), rtStrError(e));
+        result = e;
+      }
+      nextStart = now + milliseconds(stagger);
+      ++next;
+      continue;
+    }
+
+    if (pending.empty())
+      break; // all of them failed
+
+    if (now >= deadline)
+    {
+      result = RT_ERROR_TIMEOUT;
+      break;
+    }
+
+    auto wakeup = deadline;
+    if (next < endpoints.size())
+      wakeup = std::min(wakeup, nextStart);
+
+    int wait = static_cast<int>(duration_cast<milliseconds>(wakeup - now).count());
+    int ret = poll(&pending[0], pending.size(), std::max(wait, 0));
+    if (ret == -1 && errno != EINTR)
+    {
+      result = rtErrorFromErrno(errno);
+      break;
+    }
+
+    for (size_t i = 0; ret > 0 && i < pending.size();)
+    {
+      if (pending[i].revents == 0)
+      {
+        ++i;
+        continue;
+      }
+
+      int err = 0;
+      socklen_t len = sizeof(err);
+      if (getsockopt(pending[i].fd, SOL_SOCKET, SO_ERROR, &err, &len) == -1)
+        err = errno;
+
+      if (err == 0)
+      {
+        fd = pending[i].fd;
+        winner = pendingIndex[i];
+        pending.erase(pending.begin() + i);
+        break;
+      }
+
+      result = rtErrorFromErrno(err);
+      rtLogDebug("connect to %s failed. %s", rtSocketToString(endpoints[pendingIndex[i]]).c_str(),
+        rtStrError(result));
+      rtCloseSocket(pending[i].fd);
+      pending.erase(pending.begin() + i);
+      pendingIndex.erase(pendingIndex.begin() + i);
+
+      // don't wait out the head start for one that already failed
+      nextStart = steady_clock::now();
+    }
+  }
+
+  // the losers
+  for (pollfd& p : pending)
+    rtCloseSocket(p.fd);
+
+  if (winner == endpoints.size())
+    return result;
+
+  // streams do blocking reads and writes
+  fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) & ~O_NONBLOCK);
+  if (index)
+    *index = winner;
+  return RT_OK;
+}
+
+rtError
+rtCreateUnixSocketName(char const* dir, pid_t pid, char* buff, int n)
+{
+  if (!dir || !buff)
     return RT_ERROR_INVALID_ARG;
 
   if (pid == 0)
     pid = getpid();
 
-  int count = snprintf(buff, n, "%s.%d", kUnixSocketTemplateRoot, pid);
+  int count = snprintf(buff, n, "%s/%s%d", dir, kUnixSocketNamePrefix, pid);
   if (count >= n)
   {
     rtLogError("truncated socket path %d <= %d", n, count);
@@ -574,6 +1147,202 @@ rtCreateUnixSocketName(pid_t pid, char* buff, int n)
   return RT_OK;
 }
 
+rtError
+rtCreateAbstractSocketName(pid_t pid, char* buff, int n)
+{
+  if (!buff)
+    return RT_ERROR_INVALID_ARG;
+
+  if (pid == 0)
+    pid = getpid();
+
+  int count = snprintf(buff, n, "@%s%d", kUnixSocketNamePrefix, pid);
+  if (count >= n)
+  {
+    rtLogError("truncated socket name %d <= %d", n, count);
+    return RT_FAIL;
+  }
+
+  return RT_OK;
+}
+
+rtError
+rtGetPeerCredentials(int fd, rtRemotePeerCredentials& creds)
+{
+  #ifdef __APPLE__
+  creds.pid = -1;
+  if (getpeereid(fd, &creds.uid, &creds.gid) == -1)
+  {
+    rtError e = rtErrorFromErrno(errno);
+    rtLogWarn("failed to get peer credentials for fd:%d. %s", fd, rtStrError(e));
+    return e;
+  }
+  #else
+  ucred cred;
+  socklen_t len = sizeof(cred);
+  if (getsockopt(fd, SOL_SOCKET, SO_PEERCRED, &cred, &len) == -1)
+  {
+    rtError e = rtErrorFromErrno(errno);
+    rtLogWarn("failed to get peer credentials for fd:%d. %s", fd, rtStrError(e));
+    return e;
+  }
+  creds.pid = cred.pid;
+  creds.uid = cred.uid;
+  creds.gid = cred.gid;
+  #endif
+  return RT_OK;
+}
+
+rtRemoteSocketOptions
+rtRemoteSocketOptions::fromConfig(rtRemoteConfig const& conf)
+{
+  rtRemoteSocketOptions opts;
+  opts.NoDelay = conf.stream_tcp_nodelay();
+  opts.SendBufferSize = conf.stream_so_sndbuf();
+  opts.ReceiveBufferSize = conf.stream_so_rcvbuf();
+  opts.QuickAck = conf.stream_tcp_quickack();
+  opts.BusyPollUsec = conf.stream_busy_poll_us();
+  opts.KeepAlive = conf.stream_tcp_keepalive();
+  opts.KeepAliveIdle = conf.stream_tcp_keepalive_idle_s();
+  opts.KeepAliveInterval = conf.stream_tcp_keepalive_interval_s();
+  opts.KeepAliveCount = conf.stream_tcp_keepalive_count();
+
+  int32_t userTimeout = conf.stream_tcp_user_timeout_ms();
+  if (userTimeout < 0)
+  {
+    rtLogWarn("ignoring negative rt.rpc.stream.tcp_user_timeout_ms %d", userTimeout);
+    userTimeout = 0;
+  }
+  opts.UserTimeout = static_cast<uint32_t>(userTimeout);
+  return opts;
+}
+
+rtError
+rtApplySocketOptions(int fd, int family, rtRemoteSocketOptions const& opts)
+{
+  rtError result = RT_OK;
+
+  auto setOption = [fd, &result](int level, int name, char const* label, int value)
+  {
+    if (setsockopt(fd, level, name, &value, sizeof(value)) == -1)
+    {
+      result = rtErrorFromErrno(errno);
+      rtLogWarn("setting %s to %d on fd:%d failed. %s", label, value, fd, rtStrError(result));
+    }
+  };
+
+  if (opts.SendBufferSize > 0)
+    setOption(SOL_SOCKET, SO_SNDBUF, "SO_SNDBUF", opts.SendBufferSize);
+  if (opts.ReceiveBufferSize > 0)
+    setOption(SOL_SOCKET, SO_RCVBUF, "SO_RCVBUF", opts.ReceiveBufferSize);
+
+  #ifdef SO_BUSY_POLL
+  if (opts.BusyPollUsec > 0)
+    setOption(SOL_SOCKET, SO_BUSY_POLL, "SO_BUSY_POLL", opts.BusyPollUsec);
+  #endif
+
+  if (family != AF_INET && family != AF_INET6)
+    return result;
+
+  if (opts.NoDelay)
+    setOption(IPPROTO_TCP, TCP_NODELAY, "TCP_NODELAY", 1);
+
+  // the kernel drops back to delayed acks on its own, rtRemoteStream sets
+  // it again after each read
+  #ifdef TCP_QUICKACK
+  if (opts.QuickAck)
+    setOption(IPPROTO_TCP, TCP_QUICKACK, "TCP_QUICKACK", 1);
+  #endif
+
+  if (opts.KeepAlive)
+  {
+    setOption(SOL_SOCKET, SO_KEEPALIVE, "SO_KEEPALIVE", 1);
+
+    #if defined(TCP_KEEPIDLE)
+    if (opts.KeepAliveIdle > 0)
+      setOption(IPPROTO_TCP, TCP_KEEPIDLE, "TCP_KEEPIDLE", opts.KeepAliveIdle);
+    #elif defined(TCP_KEEPALIVE)
+    if (opts.KeepAliveIdle > 0)
+      setOption(IPPROTO_TCP, TCP_KEEPALIVE, "TCP_KEEPALIVE", opts.KeepAliveIdle);
+    #endif
+
+    #ifdef TCP_KEEPINTVL
+    if (opts.KeepAliveInterval > 0)
+      setOption(IPPROTO_TCP, TCP_KEEPINTVL, "TCP_KEEPINTVL", opts.KeepAliveInterval);
+    #endif
+
+    #ifdef TCP_KEEPCNT
+    if (opts.KeepAliveCount > 0)
+      setOption(IPPROTO_TCP, TCP_KEEPCNT, "TCP_KEEPCNT", opts.KeepAliveCount);
+    #endif
+  }
+
+  #ifdef TCP_USER_TIMEOUT
+  if (opts.UserTimeout > 0)
+    setOption(IPPROTO_TCP, TCP_USER_TIMEOUT, "TCP_USER_TIMEOUT", static_cast<int>(opts.UserTimeout));
+  #endif
+
+  return result;
+}
+
+rtError
+rtCreateSocketDirectory(char const* dir)
+{
+  if (!dir)
+    return RT_ERROR_INVALID_ARG;
+
+  // shared by every user's processes, so it's made sticky and world
+  // writable just like /tmp. chmod because mkdir is subject to umask.
+  if (mkdir(dir, 01777) == 0)
+  {
+    if (chmod(dir, 01777) == -1)
+    {
+      rtError e = rtErrorFromErrno(errno);
+      rtLogWarn("failed to set mode on %s. %s", dir, rtStrError(e));
+    }
+    return RT_OK;
+  }
+
+  if (errno != EEXIST)
+  {
+    rtError e = rtErrorFromErrno(errno);
+    rtLogError("failed to create socket directory %s. %s", dir, rtStrError(e));
+    return e;
+  }
+
+  // someone else got there first. don't put sockets where another user
+  // could swap them out: it has to be a real directory owned by us or
+  // root that is either sticky like /tmp or private to its owner.
+  struct stat st;
+  if (lstat(dir, &st) == -1)
+  {
+    rtError e = rtErrorFromErrno(errno);
+    rtLogError("failed to stat socket directory %s. %s", dir, rtStrError(e));
+    return e;
+  }
+
+  if (!S_ISDIR(st.st_mode))
+  {
+    rtLogError("socket directory %s is not a directory", dir);
+    return rtErrorFromErrno(ENOTDIR);
+  }
+
+  if (st.st_uid != geteuid() && st.st_uid != 0)
+  {
+    rtLogError("socket directory %s is owned by uid %d", dir, static_cast<int>(st.st_uid));
+    return rtErrorFromErrno(EPERM);
+  }
+
+  mode_t const mode = st.st_mode & 07777;
+  if (mode != 01777 && (mode & 077) != 0)
+  {
+    rtLogError("socket directory %s has unsafe mode %04o", dir, static_cast<unsigned>(mode));
+    return rtErrorFromErrno(EPERM);
+  }
+
+  return RT_OK;
+}
+
 rtError
 rtParseAddress(sockaddr_storage& ss, char const* s)
 {
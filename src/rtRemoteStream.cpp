@@ -23,22 +23,77 @@ limitations under the License.
 #include "rtRemoteStreamSelector.h"
 
 #include <algorithm>
+#include <chrono>
+#include <map>
 #include <memory>
+#include <string>
 #include <thread>
 #include <vector>
 
 #include <unistd.h>
 #include <errno.h>
 #include <fcntl.h>
+#include <poll.h>
+#include <string.h>
 #include <rtLog.h>
 
+// unix peers that turned shared memory down or didn't answer in time, and
+// when they may be asked again
+static std::mutex gShmMutex;
+static std::map<std::string, std::chrono::steady_clock::time_point> gShmRefused;
+
+static bool
+isShmRefused(std::string const& peer)
+{
+  std::unique_lock<std::mutex> lock(gShmMutex);
+  auto itr = gShmRefused.find(peer);
+  if (itr == gShmRefused.end())
+    return false;
+  if (std::chrono::steady_clock::now() < itr->second)
+    return true;
+  gShmRefused.erase(itr);
+  return false;
+}
+
+static void
+setShmRefused(std::string const& peer, uint32_t retryMillis)
+{
+  std::unique_lock<std::mutex> lock(gShmMutex);
+  gShmRefused[peer] = std::chrono::steady_clock::now() + std::chrono::milliseconds(retryMillis);
+}
+
+static void
+clearShmRefused(std::string const& peer)
+{
+  std::unique_lock<std::mutex> lock(gShmMutex);
+  gShmRefused.erase(peer);
+}
+
 rtRemoteStream::rtRemoteStream(rtRemoteEnvironment* env, int fd, sockaddr_storage const& local_endpoint,
   sockaddr_storage const& remote_endpoint)
   : m_fd(fd)
   , m_env(env)
+  , m_has_peer_credentials(false)
+  , m_quick_ack(env->Config->stream_tcp_quickack())
+  , m_shm_pending_key(kInvalidCorrelationKey)
+  , m_shm_rx_started(false)
 {
   memcpy(&m_remote_endpoint, &remote_endpoint, sizeof(m_remote_endpoint));
   memcpy(&m_local_endpoint, &local_endpoint, sizeof(m_local_endpoint));
+  memset(&m_peer_credentials, 0, sizeof(m_peer_credentials));
+
+  // accepted connections arrive here already connected
+  if (m_fd != kInvalidSocket && m_remote_endpoint.ss_family == AF_UNIX)
+    readPeerCredentials();
+}
+
+void
+rtRemoteStream::readPeerCredentials()
+{
+  m_has_peer_credentials = rtGetPeerCredentials(m_fd, m_peer_credentials) == RT_OK;
+  if (m_has_peer_credentials)
+    rtLogDebug("peer on fd %d is pid:%d uid:%d gid:%d", m_fd, static_cast<int>(m_peer_credentials.pid),
+      static_cast<int>(m_peer_credentials.uid), static_cast<int>(m_peer_credentials.gid));
 }
 
 rtRemoteStream::~rtRemoteStream()
@@ -57,6 +112,12 @@ rtRemoteStream::open()
 rtError
 rtRemoteStream::close()
 {
+  {
+    std::unique_lock<std::mutex> lock(m_send_mutex);
+    if (m_shm_tx)
+      m_shm_tx->close();
+  }
+
   if (m_fd != kInvalidSocket)
   {
     // rtRemoteStreamSelector will remove dead streams on its own
@@ -75,43 +136,28 @@ rtRemoteStream::close()
 }
 
 rtError
-rtRemoteStream::connect()
+rtRemoteStream::connect(uint32_t timeout)
 {
   RT_ASSERT(m_fd == kInvalidSocket);
-  return connectTo(m_remote_endpoint);
+  return connectTo(std::vector<sockaddr_storage>(1, m_remote_endpoint), timeout);
 }
 
 rtError
-rtRemoteStream::connectTo(sockaddr_storage const& endpoint)
+rtRemoteStream::connectTo(std::vector<sockaddr_storage> const& endpoints, uint32_t timeout)
 {
-  m_fd = socket(endpoint.ss_family, SOCK_STREAM, 0);
-  if (m_fd < 0)
-  {
-    rtError e = rtErrorFromErrno(errno);
-    rtLogError("failed to create socket. %s", rtStrError(e));
-    return e;
-  }
-  fcntl(m_fd, F_SETFD, fcntl(m_fd, F_GETFD) | FD_CLOEXEC);
-
-  if (endpoint.ss_family != AF_UNIX)
-  {
-    uint32_t one = 1;
-    if (-1 == setsockopt(m_fd, SOL_TCP, TCP_NODELAY, &one, sizeof(one)))
-      rtLogError("setting TCP_NODELAY failed");
-  }
-
-  socklen_t len;
-  rtSocketGetLength(endpoint, &len);
-
-  int ret = ::connect(m_fd, reinterpret_cast<sockaddr const *>(&endpoint), len);
-  if (ret < 0)
+  size_t index = 0;
+  rtRemoteSocketOptions const opts = rtRemoteSocketOptions::fromConfig(*m_env->Config);
+  rtError e = rtConnectSocket(endpoints, timeout, m_env->Config->stream_connect_stagger_ms(), m_fd,
+    &index, &opts);
+  if (e != RT_OK)
   {
-    rtError e = rtErrorFromErrno(errno);
     rtLogError("failed to connect to remote rpc endpoint. %s", rtStrError(e));
-    rtCloseSocket(m_fd);
     return e;
   }
 
+  if (endpoints[index].ss_family == AF_UNIX)
+    readPeerCredentials();
+
   rtGetSockName(m_fd, m_local_endpoint);
   rtGetPeerName(m_fd, m_remote_endpoint);
 
@@ -126,14 +172,204 @@ rtRemoteStream::connectTo(sockaddr_storage const& endpoint)
 rtError
 rtRemoteStream::send(rtRemoteMessagePtr const& msg)
 {
-  return rtSendDocument(*msg, m_fd, nullptr);
+  rtError e = RT_OK;
+  {
+    // a message with attachments may take several writes
+    std::unique_lock<std::mutex> lock(m_send_mutex);
+    if (!m_shm_tx)
+      return rtSendMessage(*msg, m_fd);
+
+    uint32_t timeout = static_cast<uint32_t>(m_env->Config->environment_request_timeout());
+    e = rtWriteFrame(*msg, [this, timeout](iovec* iov, int n)
+      { return m_shm_tx->write(iov, n, timeout); });
+    if (e == RT_OK)
+      return RT_OK;
+  }
+
+  // the ring may hold part of a frame now, and the peer would read
+  // whatever comes next as the rest of it
+  rtLogWarn("failed to write to shared memory, closing fd %d. %s", m_fd, rtStrError(e));
+  this->close();
+  return e;
+}
+
+rtError
+rtRemoteStream::openSharedMemory(uint32_t ringSize, uint32_t timeout)
+{
+  if (m_fd == kInvalidSocket || m_remote_endpoint.ss_family != AF_UNIX)
+    return RT_ERROR_INVALID_OPERATION;
+
+  std::string const peer = rtUnixSocketPath(m_remote_endpoint);
+  if (isShmRefused(peer))
+    return RT_ERROR_INVALID_OPERATION;
+
+  std::unique_ptr<rtRemoteShmRing> tx;
+  std::unique_ptr<rtRemoteShmRing> rx;
+
+  rtError e = rtRemoteShmRing::create(ringSize, tx);
+  if (e == RT_OK)
+    e = rtRemoteShmRing::create(ringSize, rx);
+  if (e != RT_OK)
+    return e;
+
+  rtRemoteCorrelationKey k = rtMessage_GetNextCorrelationKey();
+
+  rtRemoteMessagePtr req(new rtRemoteMessage());
+  req->SetObject();
+  req->AddMember(kFieldNameMessageType, kMessageTypeShmOpenRequest, req->GetAllocator());
+  req->AddMember(kFieldNameCorrelationKey, k.toString(), req->GetAllocator());
+
+  // our tx is the peer's rx
+  int fds[] = { tx->memFd(), tx->eventFd(), tx->spaceFd(), rx->memFd(), rx->eventFd(), rx->spaceFd() };
+  {
+    std::unique_lock<std::mutex> lock(m_send_mutex);
+    e = rtSendMessage(*req, m_fd, fds, 6);
+  }
+  if (e != RT_OK)
+    return e;
+
+  // the stream isn't registered with the selector yet, so nobody else is
+  // reading this socket
+  pollfd pfd;
+  pfd.fd = m_fd;
+  pfd.events = POLLIN;
+  pfd.revents = 0;
+
+  int ret = poll(&pfd, 1, static_cast<int>(timeout));
+  if (ret == 0)
+  {
+    // keep the offer open, onIncomingMessage takes the rings if the reply
+    // still shows up
+    m_shm_pending_tx = std::move(tx);
+    m_shm_pending_rx = std::move(rx);
+    m_shm_pending_key = k;
+    setShmRefused(peer, m_env->Config->stream_shm_retry_ms());
+    return RT_ERROR_TIMEOUT;
+  }
+  if (ret == -1)
+    return rtErrorFromErrno(errno);
+
+  rtRemoteSocketBuffer buff;
+  buff.reserve(m_env->Config->stream_socket_buffer_size());
+
+  rtRemoteMessagePtr res;
+  e = rtReadMessage(m_fd, buff, res, m_env->Config->stream_max_attachment_size(),
+    m_env->Config->stream_max_frame_attachment_bytes());
+  if (e != RT_OK)
+    return e;
+
+  char const* type = rtMessage_GetMessageType(*res);
+  if (!type || strcmp(type, kMessageTypeShmOpenResponse) != 0 || rtMessage_GetCorrelationKey(*res) != k)
+  {
+    rtLogWarn("unexpected reply to %s", kMessageTypeShmOpenRequest);
+    return RT_ERROR_PROTOCOL_ERROR;
+  }
+
+  e = rtMessage_GetStatusCode(*res);
+  if (e != RT_OK)
+  {
+    setShmRefused(peer, m_env->Config->stream_shm_retry_ms());
+    return e;
+  }
+
+  m_shm_rx = std::move(rx);
+  {
+    std::unique_lock<std::mutex> lock(m_send_mutex);
+    m_shm_tx = std::move(tx);
+  }
+
+  rtLogInfo("using shared memory for fd %d", m_fd);
+  return RT_OK;
+}
+
+rtError
+rtRemoteStream::onSharedMemoryRequest(rtRemoteMessagePtr const& req)
+{
+  std::vector<int> fds = req->takeFileDescriptors();
+
+  std::unique_ptr<rtRemoteShmRing> tx;
+  std::unique_ptr<rtRemoteShmRing> rx;
+
+  rtError status = RT_OK;
+  if (!m_env->Config->stream_shm_enable())
+  {
+    status = RT_ERROR_INVALID_OPERATION;
+  }
+  else if (fds.size() != 6)
+  {
+    rtLogWarn("%s carried %d descriptors, expected 6", kMessageTypeShmOpenRequest, static_cast<int>(fds.size()));
+    status = RT_ERROR_PROTOCOL_ERROR;
+  }
+  else
+  {
+    // attach() owns the descriptors from here on
+    status = rtRemoteShmRing::attach(fds[0], fds[1], fds[2], rx);
+    if (status == RT_OK)
+    {
+      status = rtRemoteShmRing::attach(fds[3], fds[4], fds[5], tx);
+    }
+    else
+    {
+      ::close(fds[3]);
+      ::close(fds[4]);
+      ::close(fds[5]);
+    }
+    fds.clear();
+  }
+
+  for (int fd : fds)
+    ::close(fd);
+
+  rtRemoteMessagePtr res(new rtRemoteMessage());
+  res->SetObject();
+  res->AddMember(kFieldNameMessageType, kMessageTypeShmOpenResponse, res->GetAllocator());
+  res->AddMember(kFieldNameCorrelationKey, rtMessage_GetCorrelationKey(*req).toString(), res->GetAllocator());
+  rtMessage_SetStatus(*res, status);
+
+  // the response has to go over the socket, everything after it uses the ring
+  std::unique_lock<std::mutex> lock(m_send_mutex);
+  rtError e = rtSendMessage(*res, m_fd);
+  if (e == RT_OK && status == RT_OK)
+  {
+    m_shm_tx = std::move(tx);
+    m_shm_rx = std::move(rx);
+    rtLogInfo("using shared memory for fd %d", m_fd);
+  }
+  return e;
+}
+
+// the peer reads its socket and its ring, and writes only to the ring
+// after this reply, so taking the rings now keeps everything in order
+rtError
+rtRemoteStream::onLateSharedMemoryResponse(rtRemoteMessagePtr const& res)
+{
+  if (!m_shm_pending_rx || rtMessage_GetCorrelationKey(*res) != m_shm_pending_key)
+  {
+    rtLogWarn("unexpected %s", kMessageTypeShmOpenResponse);
+    return RT_OK;
+  }
+
+  std::unique_ptr<rtRemoteShmRing> tx = std::move(m_shm_pending_tx);
+  std::unique_ptr<rtRemoteShmRing> rx = std::move(m_shm_pending_rx);
+  if (rtMessage_GetStatusCode(*res) != RT_OK)
+    return RT_OK;
+
+  clearShmRefused(rtUnixSocketPath(m_remote_endpoint));
+  m_shm_rx = std::move(rx);
+  {
+    std::unique_lock<std::mutex> lock(m_send_mutex);
+    m_shm_tx = std::move(tx);
+  }
+
+  rtLogInfo("using shared memory for fd %d after a late reply", m_fd);
+  return RT_OK;
 }
 
 rtRemoteAsyncHandle
 rtRemoteStream::sendWithWait(rtRemoteMessagePtr const& msg, rtRemoteCorrelationKey k)
 {
   rtRemoteAsyncHandle asyncHandle(m_env, k);
-  rtError e = rtSendDocument(*msg, m_fd, nullptr);
+  rtError e = send(msg);
   if (e != RT_OK)
     asyncHandle.complete(rtRemoteMessagePtr(), e);
   return asyncHandle;
@@ -160,7 +396,8 @@ rtRemoteStream::onIncomingMessage(rtRemoteSocketBuffer& buff)
   std::shared_ptr<CallbackHandler> handler = m_callback_handler.lock();
 
   rtRemoteMessagePtr doc = nullptr;
-  rtError e = rtReadMessage(m_fd, buff, doc);
+  rtError e = rtReadMessage(m_fd, buff, doc, m_env->Config->stream_max_attachment_size(),
+    m_env->Config->stream_max_frame_attachment_bytes());
   if (e != RT_OK)
   {
     if (e == rtErrorFromErrno(ENOTCONN) && handler)
@@ -176,12 +413,126 @@ rtRemoteStream::onIncomingMessage(rtRemoteSocketBuffer& buff)
     rtLogDebug("failed to read message. %s", rtStrError(e));
   }
 
+  #ifdef TCP_QUICKACK
+  if (m_quick_ack && m_remote_endpoint.ss_family != AF_UNIX)
+  {
+    int one = 1;
+    setsockopt(m_fd, IPPROTO_TCP, TCP_QUICKACK, &one, sizeof(one));
+  }
+  #endif
+
+  if (e == RT_OK)
+  {
+    char const* type = rtMessage_GetMessageType(*doc);
+    if (type && strcmp(type, kMessageTypeShmOpenRequest) == 0)
+      return onSharedMemoryRequest(doc);
+    if (type && strcmp(type, kMessageTypeShmOpenResponse) == 0)
+      return onLateSharedMemoryResponse(doc);
+  }
+
   if (e == RT_OK && handler)
     e = handler->onMessage(doc);
 
   return RT_OK;
 }
 
+// handles whatever is already queued on the socket without waiting for more
+rtError
+rtRemoteStream::drainSocket(rtRemoteSocketBuffer& buff)
+{
+  pollfd pfd;
+  pfd.fd = m_fd;
+  pfd.events = POLLIN;
+
+  while (m_fd != kInvalidSocket)
+  {
+    pfd.revents = 0;
+    if (poll(&pfd, 1, 0) <= 0 || (pfd.revents & (POLLIN | POLLHUP)) == 0)
+      break;
+
+    rtError e = onIncomingMessage(buff);
+    if (e != RT_OK)
+      return e;
+  }
+
+  return RT_OK;
+}
+
+rtError
+rtRemoteStream::onIncomingSharedMemory(rtRemoteSocketBuffer& buff)
+{
+  std::shared_ptr<CallbackHandler> handler = m_callback_handler.lock();
+
+  // after a late switch the peer may have sent on the socket before it
+  // moved to the ring. All of that is queued on the socket by the time
+  // anything shows up in the ring, so handle it first.
+  if (!m_shm_rx_started)
+  {
+    rtError e = drainSocket(buff);
+    if (e != RT_OK)
+      return e;
+    m_shm_rx_started = true;
+  }
+
+  uint32_t maxMessageSize = static_cast<uint32_t>(buff.capacity());
+  uint32_t maxAttachmentSize = m_env->Config->stream_max_attachment_size();
+  uint32_t maxFrameAttachmentBytes = m_env->Config->stream_max_frame_attachment_bytes();
+
+  // the writer signals once per write, so take everything that is there.
+  // The tail of a frame that isn't all there yet waits in m_shm_rx_buff,
+  // this thread never blocks on the ring.
+  m_shm_rx->clearSignal();
+
+  rtError e = RT_OK;
+  for (uint32_t n = m_shm_rx->available(); e == RT_OK && n > 0; n = m_shm_rx->available())
+  {
+    size_t end = m_shm_rx_buff.size();
+    m_shm_rx_buff.resize(end + n);
+    e = m_shm_rx->read(&m_shm_rx_buff[end], n, 0);
+
+    size_t offset = 0;
+    while (e == RT_OK)
+    {
+      uint32_t length = 0;
+      e = rtGetFrameLength(m_shm_rx_buff.data() + offset, static_cast<uint32_t>(m_shm_rx_buff.size() - offset),
+        maxMessageSize, maxFrameAttachmentBytes, &length);
+      if (e != RT_OK || length == 0)
+        break;
+
+      char const* p = m_shm_rx_buff.data() + offset;
+      offset += length;
+
+      rtRemoteMessagePtr doc;
+      e = rtReadFrame([&p](char* out, uint32_t count)
+        {
+          memcpy(out, p, count);
+          p += count;
+          return RT_OK;
+        }, buff, doc, maxAttachmentSize, maxFrameAttachmentBytes);
+
+      if (e == RT_OK && handler)
+        handler->onMessage(doc);
+    }
+
+    m_shm_rx_buff.erase(m_shm_rx_buff.begin(), m_shm_rx_buff.begin() + offset);
+  }
+
+  if (e != RT_OK)
+  {
+    rtLogWarn("failed to read from shared memory. %s", rtStrError(e));
+    if (handler)
+    {
+      auto self = shared_from_this();
+      rtError err = handler->onStateChanged(self, State::Closed);
+      if (err != RT_OK)
+        rtLogWarn("failed to invoke state changed handler. %s", rtStrError(err));
+    }
+    return e;
+  }
+
+  return RT_OK;
+}
+
 rtError
 rtRemoteStream::setCallbackHandler(std::shared_ptr<CallbackHandler> const& handler)
 {
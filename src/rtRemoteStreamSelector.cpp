@@ -18,6 +18,7 @@ limitations under the License.
 
 #include "rtRemoteStreamSelector.h"
 #include "rtRemoteConfig.h"
+#include "rtRemoteEnvironment.h"
 #include "rtRemoteStream.h"
 #include "rtRemoteSocketUtils.h"
 #include "rtError.h"
@@ -31,6 +32,7 @@ limitations under the License.
 rtRemoteStreamSelector::rtRemoteStreamSelector(rtRemoteEnvironment* env)
   : m_env(env)
   , m_running(false)
+  , m_keep_alive_timer(0)
 {
   int ret = pipe2(m_shutdown_pipe, O_CLOEXEC);
   if (ret == -1)
@@ -56,6 +58,9 @@ rtRemoteStreamSelector::start()
   m_running = true;
   rtLogInfo("starting StreamSelector");
   pthread_create(&m_thread, nullptr, &rtRemoteStreamSelector::pollFds, this);
+
+  std::chrono::seconds keepAliveInterval(m_env->Config->stream_keep_alive_interval());
+  m_keep_alive_timer = m_env->Timers->schedule(keepAliveInterval, [this] { sendKeepAlives(); });
   return RT_OK;
 }
 
@@ -73,6 +78,9 @@ rtRemoteStreamSelector::shutdown()
 {
   char buff[] = { "shudown" };
 
+  m_env->Timers->cancel(m_keep_alive_timer);
+  m_keep_alive_timer = 0;
+
   {
     std::unique_lock<std::mutex> lock(m_mutex);
     m_running = false;
@@ -103,9 +111,6 @@ rtRemoteStreamSelector::doPollFds()
   rtRemoteSocketBuffer buff;
   buff.reserve(m_env->Config->stream_socket_buffer_size());
 
-  const auto keepAliveInterval = std::chrono::seconds(m_env->Config->stream_keep_alive_interval());
-  auto lastKeepAliveSent = std::chrono::steady_clock::now();
-
   while (true)
   {
     int maxFd = 0;
@@ -139,6 +144,8 @@ rtRemoteStreamSelector::doPollFds()
     {
       rtPushFd(&readFds, s->m_fd, &maxFd);
       rtPushFd(&errFds, s->m_fd, &maxFd);
+      if (s->m_shm_rx)
+        rtPushFd(&readFds, s->m_shm_rx->eventFd(), &maxFd);
     }
     }
     rtPushFd(&readFds, m_shutdown_pipe[0], &maxFd);
@@ -161,17 +168,19 @@ rtRemoteStreamSelector::doPollFds()
       return RT_OK;
     }
 
-    auto now = std::chrono::steady_clock::now();
-    bool sentKeepAlive = false;
-
     std::unique_lock<std::mutex> lock(m_mutex);
     for (int i = 0, n = static_cast<int>(m_streams.size()); i < n; ++i)
     {
       rtError e = RT_OK;
       std::shared_ptr<rtRemoteStream> s = m_streams[i];
-      if (FD_ISSET(s->m_fd, &readFds))
+      bool const socketReady = FD_ISSET(s->m_fd, &readFds);
+      bool const ringReady = s->m_shm_rx && FD_ISSET(s->m_shm_rx->eventFd(), &readFds);
+      if (socketReady || ringReady)
       {
-        e = s->onIncomingMessage(buff);
+        if (socketReady)
+          e = s->onIncomingMessage(buff);
+        if (e == RT_OK && ringReady)
+          e = s->onIncomingSharedMemory(buff);
         if (e != RT_OK)
         {
           rtLogWarn("error dispatching message. %s", rtStrError(e));
@@ -184,21 +193,6 @@ rtRemoteStreamSelector::doPollFds()
         // TODO
         rtLogError("error on fd: %d", s->m_fd);
       }
-
-      if (s && s->isOpen() && (now - lastKeepAliveSent) > keepAliveInterval)
-      {
-        sentKeepAlive = true;
-
-        // This really isn't inactivity, it's more like a timer enve
-        e = s->onInactivity();
-        if (e != RT_OK)
-          rtLogWarn("error sending keep alive. %s", rtStrError(e));
-      }
-    }
-
-    if (sentKeepAlive)
-    {
-      lastKeepAliveSent = now;
     }
 
     // remove all dead streams
@@ -211,3 +205,25 @@ rtRemoteStreamSelector::doPollFds()
 
   return RT_OK;
 }
+
+// runs on the timer thread
+void
+rtRemoteStreamSelector::sendKeepAlives()
+{
+  std::vector< std::shared_ptr<rtRemoteStream> > streams;
+  {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    streams = m_streams;
+  }
+
+  for (auto const& s : streams)
+  {
+    if (!s || !s->isOpen())
+      continue;
+
+    // This really isn't inactivity, it's more like a timer event
+    rtError e = s->onInactivity();
+    if (e != RT_OK)
+      rtLogWarn("error sending keep alive. %s", rtStrError(e));
+  }
+}
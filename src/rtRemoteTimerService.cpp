@@ -0,0 +1,164 @@
+/*
+
+pxCore Copyright 2005-2018 John Robinson
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+*/
+
+#include "rtRemoteTimerService.h"
+
+#include <rtLog.h>
+
+rtRemoteTimerService::rtRemoteTimerService()
+  : m_next_id(1)
+  , m_current(0)
+  , m_running(false)
+{
+}
+
+rtRemoteTimerService::~rtRemoteTimerService()
+{
+  shutdown();
+}
+
+rtError
+rtRemoteTimerService::start()
+{
+  std::unique_lock<std::mutex> lock(m_mutex);
+  if (m_running)
+    return RT_OK;
+
+  m_running = true;
+  try
+  {
+    m_thread.reset(new std::thread(&rtRemoteTimerService::run, this));
+  }
+  catch (std::exception const& err)
+  {
+    rtLogError("failed to start timer thread. %s", err.what());
+    m_running = false;
+    return RT_FAIL;
+  }
+  return RT_OK;
+}
+
+rtError
+rtRemoteTimerService::shutdown()
+{
+  {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    if (!m_running)
+      return RT_OK;
+    m_running = false;
+    m_cond.notify_all();
+  }
+
+  if (m_thread)
+  {
+    m_thread->join();
+    m_thread.reset();
+  }
+
+  std::unique_lock<std::mutex> lock(m_mutex);
+  if (!m_timers.empty())
+    rtLogDebug("%d timers still scheduled at shutdown", static_cast<int>(m_timers.size()));
+  m_timers.clear();
+  m_due.clear();
+  return RT_OK;
+}
+
+rtRemoteTimerService::TimerId
+rtRemoteTimerService::schedule(std::chrono::milliseconds interval, Callback const& func, bool periodic)
+{
+  std::unique_lock<std::mutex> lock(m_mutex);
+  if (!m_running)
+    return 0;
+
+  TimerId id = m_next_id++;
+  if (m_next_id == 0)
+    m_next_id = 1;
+
+  Timer t;
+  t.Due = Clock::now() + interval;
+  t.Interval = interval;
+  t.Periodic = periodic;
+  t.Func = func;
+
+  m_due.insert(std::make_pair(t.Due, id));
+  m_timers.insert(std::make_pair(id, std::move(t)));
+  m_cond.notify_all();
+  return id;
+}
+
+void
+rtRemoteTimerService::cancel(TimerId id)
+{
+  std::unique_lock<std::mutex> lock(m_mutex);
+
+  auto itr = m_timers.find(id);
+  if (itr != m_timers.end())
+  {
+    m_due.erase(std::make_pair(itr->second.Due, id));
+    m_timers.erase(itr);
+  }
+
+  // don't return while it's still running on the timer thread
+  if (m_thread && std::this_thread::get_id() != m_thread->get_id())
+    m_cond.wait(lock, [&] { return m_current != id; });
+}
+
+void
+rtRemoteTimerService::run()
+{
+  std::unique_lock<std::mutex> lock(m_mutex);
+  while (m_running)
+  {
+    if (m_due.empty())
+    {
+      m_cond.wait(lock);
+      continue;
+    }
+
+    auto next = *m_due.begin();
+    if (Clock::now() < next.first)
+    {
+      m_cond.wait_until(lock, next.first);
+      continue;
+    }
+
+    m_due.erase(m_due.begin());
+    auto itr = m_timers.find(next.second);
+    if (itr == m_timers.end())
+      continue;
+
+    Callback func = itr->second.Func;
+    if (!itr->second.Periodic)
+      m_timers.erase(itr);
+
+    m_current = next.second;
+    lock.unlock();
+    func();
+    lock.lock();
+    m_current = 0;
+
+    // reschedule from now so a slow callback doesn't pile up missed runs
+    itr = m_timers.find(next.second);
+    if (itr != m_timers.end())
+    {
+      itr->second.Due = Clock::now() + itr->second.Interval;
+      m_due.insert(std::make_pair(itr->second.Due, next.second));
+    }
+    m_cond.notify_all();
+  }
+}
@@ -82,7 +82,7 @@ rtRemoteSocketToEndpointAddress(sockaddr_storage const& ss, rtConnType const& co
 
   if (ss.ss_family == AF_UNIX)
   {
-    strncpy(addrBuff, (const char*)addr, sizeof(addrBuff) -1);
+    strncpy(addrBuff, rtUnixSocketPath(ss).c_str(), sizeof(addrBuff) -1);
     buff << addrBuff;
     endpoint = std::make_shared<rtRemoteFileEndPoint>(scheme, addrBuff);
     return RT_OK;
@@ -165,10 +165,7 @@ rtRemoteSameEndpoint(sockaddr_storage const& first, sockaddr_storage const& seco
 
   if (first.ss_family == AF_UNIX)
   {
-    sockaddr_un const* un1 = reinterpret_cast<sockaddr_un const*>(&first);
-    sockaddr_un const* un2 = reinterpret_cast<sockaddr_un const*>(&second);
-
-    return 0 == strncmp(un1->sun_path, un2->sun_path, UNIX_PATH_MAX);
+    return rtUnixSocketPath(first) == rtUnixSocketPath(second);
   }
 
   RT_ASSERT(false);
@@ -20,6 +20,7 @@ limitations under the License.
 #include "rtRemoteObjectCache.h"
 #include "rtRemoteClient.h"
 #include "rtRemoteObject.h"
+#include "rtRemoteBuffer.h"
 #include "rtRemoteFunction.h"
 #include "rtRemoteMessage.h"
 
@@ -46,7 +47,7 @@ static std::string toString(rapidjson::Value const& v)
 
 rtError
 rtRemoteValueReader::read(rtRemoteEnvironment* env, rtValue& to, rapidjson::Value const& from,
-  std::shared_ptr<rtRemoteClient> const& client)
+  rtRemoteMessage const& parent, std::shared_ptr<rtRemoteClient> const& client)
 {
   auto type = from.FindMember(kFieldNameValueType);
   if (type  == from.MemberEnd())
@@ -58,7 +59,9 @@ rtRemoteValueReader::read(rtRemoteEnvironment* env, rtValue& to, rapidjson::Valu
   int const typeId = type->value.GetInt();
 
   auto val = from.FindMember(kFieldNameValueValue);
-  if (((typeId != RT_functionType) && (typeId != RT_voidType)) && (val == from.MemberEnd()))
+  auto attachment = from.FindMember(kFieldNameValueAttachment);
+  if (((typeId != RT_functionType) && (typeId != RT_voidType)) && (val == from.MemberEnd())
+    && !(((typeId == RT_stringType) || (typeId == RT_objectType)) && (attachment != from.MemberEnd())))
   {
     rtLogError("read: failed to find member '%s'. RT_ERROR_PROTOCOL_ERROR", kFieldNameValueValue);
     return RT_ERROR_PROTOCOL_ERROR;
@@ -112,13 +115,51 @@ rtRemoteValueReader::read(rtRemoteEnvironment* env, rtValue& to, rapidjson::Valu
 
     case RT_stringType:
     {
-      rtString s(val->value.GetString());
-      to.setString(s);
+      if (attachment != from.MemberEnd())
+      {
+        if (!attachment->value.IsUint())
+        {
+          rtLogError("read: bad attachment index for string value. RT_ERROR_PROTOCOL_ERROR");
+          return RT_ERROR_PROTOCOL_ERROR;
+        }
+        rtRemoteAttachment const* a = parent.getAttachment(attachment->value.GetUint());
+        if (!a || !a->Data)
+        {
+          rtLogError("read: missing attachment for string value. RT_ERROR_PROTOCOL_ERROR");
+          return RT_ERROR_PROTOCOL_ERROR;
+        }
+        // attachments are always received with a trailing nul
+        rtString s(a->Data);
+        to.setString(s);
+      }
+      else
+      {
+        rtString s(val->value.GetString());
+        to.setString(s);
+      }
     }
     break;
 
     case RT_objectType:
     {
+      if (attachment != from.MemberEnd())
+      {
+        if (!attachment->value.IsUint())
+        {
+          rtLogError("read: bad attachment index for buffer value. RT_ERROR_PROTOCOL_ERROR");
+          return RT_ERROR_PROTOCOL_ERROR;
+        }
+        rtRemoteAttachment const* a = parent.getAttachment(attachment->value.GetUint());
+        if (!a || !a->Data)
+        {
+          rtLogError("read: missing attachment for buffer value. RT_ERROR_PROTOCOL_ERROR");
+          return RT_ERROR_PROTOCOL_ERROR;
+        }
+        // shares the receive buffer, no copy
+        to.setObject(new rtRemoteBuffer(a->Owner, a->Data, a->Length));
+        break;
+      }
+
       RT_ASSERT(client != NULL);
       if (!client)
       {
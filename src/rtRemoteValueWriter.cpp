@@ -18,65 +18,61 @@ limitations under the License.
 
 #include "rtRemoteValueWriter.h"
 #include "rtRemoteObject.h"
+#include "rtRemoteBuffer.h"
 #include "rtRemoteFunction.h"
 #include "rtRemoteObjectCache.h"
 #include "rtRemoteConfig.h"
 #include "rtRemoteMessage.h"
 #include "rtRemoteEnvironment.h"
-#include "rtGuid.h"
 
 #include <rtObject.h>
 #include <rapidjson/rapidjson.h>
-#include <sstream>
+#include <typeinfo>
 
 namespace
 {
-//  static std::atomic<int> sNextFunctionId;
+  // nearly every local function that crosses the wire is a plain
+  // rtFunctionCallback, so check the exact type before paying for a
+  // dynamic_cast. Proxies never carry a callback id.
+  rtFunctionCallback* toCallback(rtIFunction* func)
+  {
+    if (!func)
+      return nullptr;
+    if (typeid(*func) == typeid(rtFunctionCallback))
+      return static_cast<rtFunctionCallback *>(func);
+    if (typeid(*func) == typeid(rtRemoteFunction))
+      return nullptr;
+    return dynamic_cast<rtFunctionCallback *>(func);
+  }
 
-  std::string getId(rtFunctionRef const& ref)
+  std::string getId(rtRemoteEnvironment* env, rtFunctionRef const& ref)
   {
-    rtFunctionCallback * obj = dynamic_cast<rtFunctionCallback *>(ref.ptr());
+    rtFunctionCallback * obj = toCallback(ref.ptr());
     if(obj && !obj->getId().empty())
     {
       return obj->getId();
     }
     else
     {
-      rtGuid id = rtGuid::newRandom();
-
-      std::stringstream ss;
-      ss << "func://";
-      ss << id.toString();
-
+      std::string id = env->newObjectId("func://");
       if(obj)
-        obj->setId(ss.str());
-
-      return ss.str();
+        obj->setId(id);
+      return id;
     }
   }
  
-  std::string getId(rtObjectRef const& ref)
+  std::string getId(rtRemoteEnvironment* env, rtObjectRef const& ref)
   {
-    rtRemoteObject const* obj = dynamic_cast<rtRemoteObject const *>(ref.getPtr());
+    rtRemoteObject const* obj = rtRemoteObject::fromObject(ref.getPtr());
     if (obj != nullptr)
-    {
       return obj->getId();
-    }
-    else
-    {
-      rtGuid id = rtGuid::newRandom();
-
-      std::stringstream ss;
-      ss << "obj://";
-      ss << id.toString();
-      return ss.str();
-    }
+    return env->newObjectId("obj://");
   }
 }
 
 rtError
 rtRemoteValueWriter::write(rtRemoteEnvironment* env, rtValue const& from,
-  rapidjson::Value& to, rapidjson::Document& doc)
+  rapidjson::Value& to, rtRemoteMessage& doc)
 {
   to.SetObject();
 
@@ -85,7 +81,7 @@ rtRemoteValueWriter::write(rtRemoteEnvironment* env, rtValue const& from,
     to.AddMember(kFieldNameValueType, static_cast<int>(RT_functionType), doc.GetAllocator());
 
     rtFunctionRef func = from.toFunction();
-    std::string id = func ? getId(func) : kNullObjectId;
+    std::string id = func ? getId(env, func) : kNullObjectId;
 
     rapidjson::Value val;
     val.SetObject();
@@ -106,7 +102,20 @@ rtRemoteValueWriter::write(rtRemoteEnvironment* env, rtValue const& from,
     to.AddMember(kFieldNameValueType, static_cast<int>(RT_objectType), doc.GetAllocator());
 
     rtObjectRef obj = from.toObject();
-    std::string id = obj ? getId(obj) : kNullObjectId;
+
+    // buffers travel by value as raw bytes, they never get an id
+    rtRemoteBuffer const* buff = rtRemoteBuffer::fromObject(obj.getPtr());
+    if (buff != nullptr)
+    {
+      rtRemoteAttachment a;
+      a.Data = buff->data();
+      a.Length = buff->length();
+      a.Owner = buff->owner();
+      to.AddMember(kFieldNameValueAttachment, doc.addAttachment(a), doc.GetAllocator());
+      return RT_OK;
+    }
+
+    std::string id = obj ? getId(env, obj) : kNullObjectId;
 
     rapidjson::Value val;
     val.SetObject();
@@ -136,7 +145,30 @@ rtRemoteValueWriter::write(rtRemoteEnvironment* env, rtValue const& from,
     case RT_uint32_tType: to.AddMember("value", from.toUInt32(), doc.GetAllocator()); break;
     case RT_int64_tType:  to.AddMember("value", from.toInt64(), doc.GetAllocator()); break;
     case RT_uint64_tType: to.AddMember("value", from.toUInt64(), doc.GetAllocator()); break;
-    case RT_stringType:   to.AddMember("value", std::string(from.toString().cString()), doc.GetAllocator()); break;
+    case RT_stringType:
+    {
+      rtString str = from.toString();
+      uint32_t const length = static_cast<uint32_t>(str.byteLength());
+      uint32_t const threshold = env->Config->stream_attachment_threshold();
+      if (threshold > 0 && length >= threshold)
+      {
+        // sent as raw bytes after the frame, no escaping and no DOM copy.
+        // the attachment needs an owner that outlives this call, so only
+        // strings that go this way pay for one.
+        std::shared_ptr<rtString> s = std::make_shared<rtString>(str);
+        rtRemoteAttachment a;
+        a.Data = s->cString();
+        a.Length = length;
+        a.Owner = s;
+        to.AddMember(kFieldNameValueAttachment, doc.addAttachment(a), doc.GetAllocator());
+      }
+      else
+      {
+        rapidjson::Value val(str.cString(), length, doc.GetAllocator());
+        to.AddMember("value", val, doc.GetAllocator());
+      }
+    }
+    break;
     case RT_voidPtrType:
 #if __x86_64 || __aarch64__
       to.AddMember("value", (uint64_t)(from.toVoidPtr()), doc.GetAllocator());
@@ -0,0 +1,112 @@
+/*
+
+pxCore Copyright 2005-2018 John Robinson
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+*/
+
+// Registers inet and unix endpoints with the file resolver and reads them
+// back through a second resolver on the same file.
+//
+//   file_resolver_test
+
+#include <rtRemote.h>
+#include <rtRemoteConfig.h>
+#include <rtRemoteConfigBuilder.h>
+#include <rtRemoteEnvironment.h>
+#include <rtRemoteFileResolver.h>
+#include <rtRemoteSocketUtils.h>
+#include <rtLog.h>
+
+#include <string>
+
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+static int failures = 0;
+
+static void
+check(bool ok, char const* what)
+{
+  printf("%s: %s\n", ok ? "PASS" : "FAIL", what);
+  if (!ok)
+    failures++;
+}
+
+static rtRemoteEnvironment*
+createEnvironment(std::string const& dbPath)
+{
+  rtRemoteConfigBuilder* builder = rtRemoteConfigBuilder::getDefaultConfig();
+  rtRemoteConfig* conf = builder->build();
+  delete builder;
+  conf->set_resolver_file_db_path(dbPath);
+  return new rtRemoteEnvironment(conf);
+}
+
+static sockaddr_storage
+parse(char const* addr, uint16_t port)
+{
+  sockaddr_storage ss;
+  memset(&ss, 0, sizeof(ss));
+  rtParseAddress(ss, addr, port, nullptr);
+  return ss;
+}
+
+// registers through one resolver and looks up through the other
+static bool
+roundTrip(rtRemoteFileResolver& writer, rtRemoteFileResolver& reader, char const* name,
+  sockaddr_storage const& endpoint)
+{
+  if (writer.registerObject(name, endpoint) != RT_OK)
+    return false;
+
+  sockaddr_storage found;
+  if (reader.locateObject(name, found, 0) != RT_OK)
+    return false;
+
+  return found.ss_family == endpoint.ss_family
+    && rtSocketToString(found) == rtSocketToString(endpoint);
+}
+
+int main()
+{
+  rtLogSetLevel(RT_LOG_WARN);
+
+  std::string const dbPath = "/tmp/rtremote_file_resolver_test." + std::to_string(getpid());
+  unlink(dbPath.c_str());
+
+  rtRemoteEnvironment* env = createEnvironment(dbPath);
+  sockaddr_storage const none = parse("127.0.0.1", 0);
+
+  rtRemoteFileResolver writer(env);
+  rtRemoteFileResolver reader(env);
+  check(writer.open(none) == RT_OK, "writer opens");
+  check(reader.open(none) == RT_OK, "reader opens");
+
+  check(roundTrip(writer, reader, "file.test.inet", parse("127.0.0.1", 40001)), "inet endpoint");
+  check(roundTrip(writer, reader, "file.test.unix", parse("/tmp/rtremote_test.sock", 0)), "unix endpoint");
+  check(roundTrip(writer, reader, "file.test.abstract", parse("@rtremote_test", 0)), "abstract unix endpoint");
+
+  check(writer.unregisterObject("file.test.unix") == RT_OK, "unregister");
+  sockaddr_storage found;
+  check(reader.locateObject("file.test.unix", found, 0) == RT_RESOURCE_NOT_FOUND, "lookup after unregister");
+
+  writer.close();
+  reader.close();
+  unlink(dbPath.c_str());
+
+  printf("%d failed\n", failures);
+  return failures == 0 ? 0 : 1;
+}
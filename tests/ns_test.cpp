@@ -0,0 +1,326 @@
+/*
+
+pxCore Copyright 2005-2018 John Robinson
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+*/
+
+// Runs the name service in a forked child, since it doesn't answer lookups
+// from its own process, and talks to it through two unicast resolvers: one
+// registers, the other looks up. Checks register, lookup, lease expiry,
+// batched lookup, cached misses, malformed requests, unix endpoints,
+// deregister and pushed names.
+//
+//   ns_test
+
+#include <rtRemote.h>
+#include <rtRemoteConfig.h>
+#include <rtRemoteConfigBuilder.h>
+#include <rtRemoteEnvironment.h>
+#include <rtRemoteLocateCache.h>
+#include <rtRemoteNameService.h>
+#include <rtRemoteNsResolver.h>
+#include <rtRemoteSocketUtils.h>
+#include <rtLog.h>
+
+#include <chrono>
+#include <map>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+static int failures = 0;
+
+static void
+check(bool ok, char const* what)
+{
+  printf("%s: %s\n", ok ? "PASS" : "FAIL", what);
+  if (!ok)
+    failures++;
+}
+
+static sockaddr_storage
+loopback(uint16_t port)
+{
+  sockaddr_storage ss;
+  memset(&ss, 0, sizeof(ss));
+  sockaddr_in* in = reinterpret_cast<sockaddr_in *>(&ss);
+  in->sin_family = AF_INET;
+  in->sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  in->sin_port = htons(port);
+  return ss;
+}
+
+static bool
+isFound(rtRemoteNsResolver& resolver, char const* name, uint16_t port)
+{
+  sockaddr_storage endpoint;
+  memset(&endpoint, 0, sizeof(endpoint));
+  if (resolver.locateObject(name, endpoint, 1000) != RT_OK)
+    return false;
+
+  uint16_t found = 0;
+  rtGetPort(endpoint, &found);
+  return found == port;
+}
+
+// sends a datagram straight to the name service
+static void
+sendRaw(rtRemoteEnvironment* env, char const* json)
+{
+  int fd = socket(AF_INET, SOCK_DGRAM, 0);
+  sockaddr_storage dest = loopback(static_cast<uint16_t>(env->Config->resolver_unicast_port()));
+  sendto(fd, json, strlen(json), 0, reinterpret_cast<sockaddr *>(&dest), sizeof(sockaddr_in));
+  ::close(fd);
+}
+
+static rtRemoteEnvironment*
+createEnvironment(char const* subscribe = "")
+{
+  // short leases so expiry doesn't take long, and misses cached for long
+  // enough to see
+  rtRemoteConfigBuilder* builder = rtRemoteConfigBuilder::getDefaultConfig();
+  rtRemoteConfig* conf = builder->build();
+  delete builder;
+  conf->set_resolver_unicast_address("127.0.0.1");
+  conf->set_resolver_unicast_lease_ms(600);
+  conf->set_resolver_unicast_purge_interval_ms(100);
+  conf->set_resolver_cache_negative_ttl_ms(5000);
+  conf->set_resolver_unicast_subscribe(subscribe);
+  return new rtRemoteEnvironment(conf);
+}
+
+static void
+runNameService(int readyFd, int stopFd)
+{
+  rtRemoteNameService ns(createEnvironment());
+  char c = ns.init() == RT_OK ? 1 : 0;
+  if (write(readyFd, &c, 1) != 1 || c == 0)
+    _exit(1);
+
+  // parent closes its end when it's done
+  while (read(stopFd, &c, 1) > 0)
+    ;
+
+  ns.close();
+  _exit(0);
+}
+
+int main()
+{
+  rtLogSetLevel(RT_LOG_WARN);
+
+  int ready[2];
+  int stop[2];
+  if (pipe(ready) == -1 || pipe(stop) == -1)
+  {
+    perror("pipe");
+    return 1;
+  }
+
+  // fork before anything starts a thread
+  pid_t child = fork();
+  if (child == 0)
+  {
+    close(ready[0]);
+    close(stop[1]);
+    runNameService(ready[1], stop[0]);
+  }
+  close(ready[1]);
+  close(stop[0]);
+
+  char c = 0;
+  check(read(ready[0], &c, 1) == 1 && c == 1, "name service starts");
+  if (c != 1)
+    return 1;
+
+  rtRemoteEnvironment* env = createEnvironment();
+  rtError e = RT_OK;
+
+  sockaddr_storage const rpcEndpoint = loopback(40001);
+
+  rtRemoteNsResolver client(env);
+  e = client.open(loopback(0));
+  check(e == RT_OK, "client resolver opens");
+
+  // register and look up
+  {
+    rtRemoteNsResolver server(env);
+    e = server.open(rpcEndpoint);
+    check(e == RT_OK, "server resolver opens");
+
+    e = server.registerObject("ns.test.lease", rpcEndpoint, 1000);
+    check(e == RT_OK, "register");
+    check(isFound(client, "ns.test.lease", 40001), "lookup after register");
+
+    // heartbeats keep it alive past the lease
+    std::this_thread::sleep_for(std::chrono::milliseconds(1200));
+    check(isFound(client, "ns.test.lease", 40001), "lookup after renewals");
+
+    // closing stops the heartbeats without deregistering
+    server.close();
+  }
+
+  // lease runs out
+  std::this_thread::sleep_for(std::chrono::milliseconds(1000));
+  check(!isFound(client, "ns.test.lease", 40001), "lookup after lease expired");
+
+  // batched lookup, over more than one request
+  {
+    rtRemoteNsResolver server(env);
+    server.open(rpcEndpoint);
+
+    std::vector<std::string> names;
+    bool registered = true;
+    for (int i = 0; i < kNsMaxLookupBatch + 8; ++i)
+    {
+      names.push_back("ns.test.batch." + std::to_string(i));
+      registered = server.registerObject(names.back(), rpcEndpoint, 1000) == RT_OK && registered;
+    }
+    check(registered, "register batch");
+
+    std::map<std::string, sockaddr_storage> endpoints;
+    e = client.locateObjects(names, endpoints, 1000);
+    check(e == RT_OK && endpoints.size() == names.size(), "batched lookup");
+
+    names.push_back("ns.test.batch.missing");
+    endpoints.clear();
+    e = client.locateObjects(names, endpoints, 1000);
+    check(e == RT_RESOURCE_NOT_FOUND && endpoints.size() == names.size() - 1
+      && endpoints.find("ns.test.batch.missing") == endpoints.end(), "batched lookup with a missing name");
+
+    for (std::string const& name : names)
+      server.unregisterObject(name);
+    server.close();
+  }
+
+  // a missing name is answered rather than timed out, so the miss is
+  // cached. the second lookup comes from the cache even though the name
+  // exists by then.
+  {
+    rtRemoteLocateCache cache(env, new rtRemoteNsResolver(env));
+    cache.open(loopback(0));
+
+    sockaddr_storage found;
+    auto start = std::chrono::steady_clock::now();
+    e = cache.locateObject("ns.test.missing", found, 1000);
+    auto elapsed = std::chrono::steady_clock::now() - start;
+    check(e == RT_RESOURCE_NOT_FOUND && elapsed < std::chrono::milliseconds(500), "lookup of missing name");
+
+    rtRemoteNsResolver server(env);
+    server.open(rpcEndpoint);
+    server.registerObject("ns.test.missing", rpcEndpoint, 1000);
+    check(isFound(client, "ns.test.missing", 40001), "missing name registered");
+
+    e = cache.locateObject("ns.test.missing", found, 1000);
+    check(e == RT_RESOURCE_NOT_FOUND, "second lookup served from cache");
+
+    server.unregisterObject("ns.test.missing");
+    server.close();
+    cache.close();
+  }
+
+  // fields of the wrong type are dropped, not trusted
+  {
+    sendRaw(env, "{\"message.type\":5}");
+    sendRaw(env, "{\"message.type\":\"ns.register\",\"object.id\":7,\"correlation.key\":\"a\"}");
+    sendRaw(env, "{\"message.type\":\"ns.register\",\"object.id\":\"ns.test.bad\",\"ip\":1,"
+      "\"port\":\"x\",\"correlation.key\":\"a\"}");
+    sendRaw(env, "{\"message.type\":\"ns.update\",\"object.id\":\"ns.test.bad\",\"ip\":\"127.0.0.1\","
+      "\"port\":-1,\"correlation.key\":\"a\"}");
+    sendRaw(env, "{\"message.type\":\"ns.lookup\",\"object.id\":\"ns.test.bad\",\"sender.id\":\"x\","
+      "\"correlation.key\":[]}");
+
+    rtRemoteNsResolver server(env);
+    server.open(rpcEndpoint);
+    e = server.registerObject("ns.test.wellformed", rpcEndpoint, 1000);
+    check(e == RT_OK, "register after malformed messages");
+    check(isFound(client, "ns.test.wellformed", 40001), "lookup after malformed messages");
+    server.unregisterObject("ns.test.wellformed");
+    server.close();
+  }
+
+  // unix endpoints go through as their path
+  {
+    sockaddr_storage unixEndpoint;
+    memset(&unixEndpoint, 0, sizeof(unixEndpoint));
+    rtParseAddress(unixEndpoint, "/tmp/rtremote_ns_test.sock", 0, nullptr);
+
+    rtRemoteNsResolver server(env);
+    server.open(unixEndpoint);
+    e = server.registerObject("ns.test.unix", unixEndpoint, 1000);
+    check(e == RT_OK, "register unix endpoint");
+
+    sockaddr_storage found;
+    memset(&found, 0, sizeof(found));
+    e = client.locateObject("ns.test.unix", found, 1000);
+    check(e == RT_OK && found.ss_family == AF_UNIX
+      && rtUnixSocketPath(found) == "/tmp/rtremote_ns_test.sock", "lookup unix endpoint");
+
+    server.unregisterObject("ns.test.unix");
+    server.close();
+  }
+
+  // deregister
+  {
+    rtRemoteNsResolver server(env);
+    server.open(rpcEndpoint);
+    e = server.registerObject("ns.test.dereg", rpcEndpoint, 1000);
+    check(e == RT_OK, "register again");
+    check(isFound(client, "ns.test.dereg", 40001), "lookup before deregister");
+
+    e = server.unregisterObject("ns.test.dereg");
+    check(e == RT_OK, "deregister");
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    check(!isFound(client, "ns.test.dereg", 40001), "lookup after deregister");
+    server.close();
+  }
+
+  // names matching rt.rpc.resolver.unicast.subscribe are pushed, so they
+  // can still be found with the name service gone
+  {
+    rtRemoteNsResolver subscriber(createEnvironment("ns.test.push.*"));
+    e = subscriber.open(loopback(0));
+    check(e == RT_OK, "subscriber opens");
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+    rtRemoteNsResolver server(env);
+    server.open(rpcEndpoint);
+    e = server.registerObject("ns.test.push.a", rpcEndpoint, 1000);
+    check(e == RT_OK, "register subscribed name");
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+    close(stop[1]);
+    waitpid(child, nullptr, 0);
+
+    // before the unanswered renewal makes the subscriber forget it
+    check(isFound(subscriber, "ns.test.push.a", 40001), "pushed name found with the name service gone");
+    check(!isFound(client, "ns.test.push.a", 40001), "lookup with the name service gone");
+
+    server.close();
+    subscriber.close();
+  }
+
+  client.close();
+
+  printf("%d failed\n", failures);
+  return failures == 0 ? 0 : 1;
+}
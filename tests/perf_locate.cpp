@@ -0,0 +1,185 @@
+/*
+
+pxCore Copyright 2005-2018 John Robinson
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+*/
+
+// Runs many locates in parallel against a stand-in process and reports
+// their latency. The stand-in is a forked child that registers the
+// objects. The resolver is used directly, so the locate cache does not
+// hide the round trips.
+//
+//   perf_locate [-t threads] [-n locates per thread] [-o objects]
+
+#include <rtRemote.h>
+#include <rtRemoteEnvironment.h>
+#include <rtRemoteMulticastResolver.h>
+#include <rtLog.h>
+
+#include <algorithm>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <arpa/inet.h>
+#include <getopt.h>
+#include <netinet/in.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+static std::string
+objectName(int i)
+{
+  return "perf.locate." + std::to_string(i);
+}
+
+static void
+runStandIn(int objects, int readyFd, int stopFd)
+{
+  rtRemoteEnvironment* env = rtEnvironmentGetGlobal();
+  rtError e = rtRemoteInit(env);
+  RT_ASSERT(e == RT_OK);
+
+  std::vector<rtObjectRef> refs;
+  for (int i = 0; i < objects; ++i)
+  {
+    refs.push_back(new rtMapObject());
+    rtRemoteRegisterObject(env, objectName(i).c_str(), refs.back());
+  }
+
+  char c = 1;
+  if (write(readyFd, &c, 1) != 1)
+    _exit(1);
+
+  // parent closes its end when it's done
+  while (read(stopFd, &c, 1) > 0)
+    ;
+
+  rtRemoteShutdown(env, true);
+  _exit(0);
+}
+
+int main(int argc, char* argv[])
+{
+  int threads = 200;
+  int count = 20;
+  int objects = 32;
+
+  while (true)
+  {
+    int c = getopt(argc, argv, "t:n:o:");
+    if (c == -1)
+      break;
+    if (c == 't')
+      threads = static_cast<int>(strtol(optarg, nullptr, 10));
+    else if (c == 'n')
+      count = static_cast<int>(strtol(optarg, nullptr, 10));
+    else if (c == 'o')
+      objects = static_cast<int>(strtol(optarg, nullptr, 10));
+  }
+
+  rtLogSetLevel(RT_LOG_WARN);
+
+  int ready[2];
+  int stop[2];
+  if (pipe(ready) == -1 || pipe(stop) == -1)
+  {
+    perror("pipe");
+    return 1;
+  }
+
+  // fork before anything starts a thread
+  pid_t child = fork();
+  if (child == 0)
+  {
+    close(ready[0]);
+    close(stop[1]);
+    runStandIn(objects, ready[1], stop[0]);
+  }
+  close(ready[1]);
+  close(stop[0]);
+
+  char c;
+  if (read(ready[0], &c, 1) != 1)
+  {
+    fprintf(stderr, "stand-in failed to start\n");
+    return 1;
+  }
+
+  rtRemoteEnvironment* env = rtEnvironmentGetGlobal();
+  rtRemoteMulticastResolver resolver(env);
+
+  sockaddr_storage rpcEndpoint;
+  memset(&rpcEndpoint, 0, sizeof(rpcEndpoint));
+  sockaddr_in* in = reinterpret_cast<sockaddr_in *>(&rpcEndpoint);
+  in->sin_family = AF_INET;
+  in->sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+  rtError e = resolver.open(rpcEndpoint);
+  RT_ASSERT(e == RT_OK);
+
+  using namespace std::chrono;
+  std::vector< std::vector<double> > latencies(threads);
+  std::vector<int> failures(threads, 0);
+  std::vector<std::thread> workers;
+
+  auto start = steady_clock::now();
+  for (int t = 0; t < threads; ++t)
+  {
+    workers.emplace_back([&, t]
+    {
+      for (int i = 0; i < count; ++i)
+      {
+        sockaddr_storage endpoint;
+        auto begin = steady_clock::now();
+        rtError err = resolver.locateObject(objectName((t + i) % objects), endpoint, 3000);
+        auto end = steady_clock::now();
+        if (err == RT_OK)
+          latencies[t].push_back(duration_cast<microseconds>(end - begin).count() / 1000.0);
+        else
+          failures[t]++;
+      }
+    });
+  }
+  for (std::thread& w : workers)
+    w.join();
+  double wall = duration_cast<microseconds>(steady_clock::now() - start).count() / 1000.0;
+
+  std::vector<double> all;
+  int failed = 0;
+  for (int t = 0; t < threads; ++t)
+  {
+    all.insert(all.end(), latencies[t].begin(), latencies[t].end());
+    failed += failures[t];
+  }
+  std::sort(all.begin(), all.end());
+
+  printf("threads:%d locates:%d failed:%d wall:%.1fms rate:%.0f/s\n", threads,
+    threads * count, failed, wall, (threads * count) / (wall / 1000.0));
+  if (!all.empty())
+  {
+    printf("latency ms p50:%.2f p90:%.2f p99:%.2f max:%.2f\n",
+      all[all.size() / 2], all[all.size() * 9 / 10], all[all.size() * 99 / 100], all.back());
+  }
+
+  resolver.close();
+  close(stop[1]);
+  waitpid(child, nullptr, 0);
+  return failed == 0 ? 0 : 1;
+}
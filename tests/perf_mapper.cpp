@@ -0,0 +1,126 @@
+/*
+
+pxCore Copyright 2005-2018 John Robinson
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+*/
+
+// Compares the mapper backends: register, lookup and deregister of many
+// object ids against the in-memory map, the file store and SQLite.
+//
+//   perf_mapper [-n objects] [-l lookups per object]
+
+#include <rtRemote.h>
+#include <rtRemoteConfig.h>
+#include <rtRemoteEndPoint.h>
+#include <rtRemoteEnvironment.h>
+#include <rtRemoteMapper.h>
+#include <rtRemoteMapperFile.h>
+#include <rtRemoteMapperMap.h>
+#include <rtRemoteMapperSql.h>
+#include <rtLog.h>
+
+#include <chrono>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <getopt.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+template<class Func>
+static void
+timeIt(char const* backend, char const* label, int count, Func func)
+{
+  auto start = std::chrono::steady_clock::now();
+  for (int i = 0; i < count; ++i)
+    func(i);
+  auto end = std::chrono::steady_clock::now();
+
+  double ns = std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count();
+  printf("%-6s %-14s %10.1f ns/op\n", backend, label, ns / count);
+}
+
+static void
+runBackend(char const* backend, rtRemoteIMapper& mapper, int objects, int lookups)
+{
+  std::vector<std::string> ids;
+  for (int i = 0; i < objects; ++i)
+    ids.push_back("perf.mapper." + std::to_string(i));
+
+  rtRemoteEndPointPtr endpoint(rtRemoteEndPoint::fromString("tcp://127.0.0.1:10004"));
+
+  timeIt(backend, "register", objects, [&](int i)
+  {
+    mapper.registerEndpoint(ids[i], endpoint);
+  });
+  timeIt(backend, "lookup", objects * lookups, [&](int i)
+  {
+    rtRemoteEndPointPtr ep;
+    mapper.lookupEndpoint(ids[i % objects], ep);
+  });
+  timeIt(backend, "isRegistered", objects * lookups, [&](int i)
+  {
+    mapper.isRegistered(ids[i % objects]);
+  });
+  timeIt(backend, "deregister", objects, [&](int i)
+  {
+    mapper.deregisterEndpoint(ids[i]);
+  });
+}
+
+int main(int argc, char* argv[])
+{
+  int objects = 10000;
+  int lookups = 10;
+
+  while (true)
+  {
+    int c = getopt(argc, argv, "n:l:");
+    if (c == -1)
+      break;
+    if (c == 'n')
+      objects = static_cast<int>(strtol(optarg, nullptr, 10));
+    else if (c == 'l')
+      lookups = static_cast<int>(strtol(optarg, nullptr, 10));
+  }
+
+  rtLogSetLevel(RT_LOG_WARN);
+
+  rtRemoteEnvironment* env = rtEnvironmentGetGlobal();
+
+  // start from empty databases so runs are comparable
+  std::string sqlPath = env->Config->mapper_sql_db_path();
+  unlink(env->Config->mapper_file_db_path().c_str());
+  unlink(sqlPath.c_str());
+  unlink((sqlPath + "-wal").c_str());
+  unlink((sqlPath + "-shm").c_str());
+
+  {
+    rtRemoteMapperMap mapper(env);
+    runBackend("map", mapper, objects, lookups);
+  }
+  {
+    rtRemoteMapperFile mapper(env);
+    runBackend("file", mapper, objects, lookups);
+  }
+  {
+    rtRemoteMapperSql mapper(env);
+    runBackend("sql", mapper, objects, lookups);
+  }
+
+  return 0;
+}
@@ -0,0 +1,124 @@
+/*
+
+pxCore Copyright 2005-2018 John Robinson
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+*/
+
+// Measures the per-value cost of rtRemoteValueWriter::write and of the
+// proxy type checks it does on objects and functions.
+//
+//   perf_value_writer [-n iterations]
+
+#include <rtRemote.h>
+#include <rtRemoteEnvironment.h>
+#include <rtRemoteFunction.h>
+#include <rtRemoteMessage.h>
+#include <rtRemoteObject.h>
+#include <rtRemoteObjectCache.h>
+#include <rtRemoteValueWriter.h>
+#include <rtLog.h>
+
+#include <chrono>
+#include <typeinfo>
+#include <getopt.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+static rtError
+noopHandler(int /*argc*/, rtValue const* /*argv*/, rtValue* /*result*/, void* /*argp*/)
+{
+  return RT_OK;
+}
+
+template<class Func>
+static void
+timeIt(char const* label, int count, Func func)
+{
+  auto start = std::chrono::steady_clock::now();
+  for (int i = 0; i < count; ++i)
+    func();
+  auto end = std::chrono::steady_clock::now();
+
+  double ns = std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count();
+  printf("%-28s %10.1f ns/op\n", label, ns / count);
+}
+
+int main(int argc, char* argv[])
+{
+  int count = 1000000;
+
+  while (true)
+  {
+    int c = getopt(argc, argv, "n:");
+    if (c == -1)
+      break;
+    if (c == 'n')
+      count = static_cast<int>(strtol(optarg, nullptr, 10));
+  }
+
+  rtLogSetLevel(RT_LOG_WARN);
+
+  rtRemoteEnvironment* env = rtEnvironmentGetGlobal();
+  rtError e = rtRemoteInit(env);
+  RT_ASSERT(e == RT_OK);
+
+  rtObjectRef localObject(new rtMapObject());
+  rtFunctionRef callback(new rtFunctionCallback(noopHandler));
+
+  volatile uintptr_t sink = 0;
+
+  // cast cost in isolation. dynamic_cast is what write() used to do.
+  timeIt("dynamic_cast<rtRemoteObject>", count, [&]
+  {
+    sink += reinterpret_cast<uintptr_t>(dynamic_cast<rtRemoteObject const *>(localObject.getPtr()));
+  });
+  timeIt("rtRemoteObject::fromObject", count, [&]
+  {
+    sink += reinterpret_cast<uintptr_t>(rtRemoteObject::fromObject(localObject.getPtr()));
+  });
+  timeIt("dynamic_cast<callback>", count, [&]
+  {
+    sink += reinterpret_cast<uintptr_t>(dynamic_cast<rtFunctionCallback *>(callback.ptr()));
+  });
+  timeIt("typeid<callback>", count, [&]
+  {
+    rtIFunction* f = callback.ptr();
+    if (typeid(*f) == typeid(rtFunctionCallback))
+      sink += reinterpret_cast<uintptr_t>(static_cast<rtFunctionCallback *>(f));
+  });
+
+  // full serialization of a single value
+  rtValue values[] = { rtValue(static_cast<int32_t>(42)), rtValue("hello world"),
+    rtValue(localObject), rtValue(callback) };
+  char const* labels[] = { "write int32", "write string", "write object", "write function" };
+
+  for (int i = 0; i < 4; ++i)
+  {
+    rtValue const& v = values[i];
+    timeIt(labels[i], count, [&]
+    {
+      rtRemoteMessage doc;
+      doc.SetObject();
+      rapidjson::Value val;
+      rtRemoteValueWriter::write(env, v, val, doc);
+    });
+  }
+
+  static_cast<void>(sink);
+
+  env->ObjectCache->clear();
+  rtRemoteShutdown(env);
+  return 0;
+}
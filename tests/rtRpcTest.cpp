@@ -25,8 +25,16 @@ limitations under the License.
 #include<gtest/gtest.h>
 #include "../rtRemote.h"
 #include "rtTestCommon.h"
+#include "rtRemoteBuffer.h"
+#include "rtRemoteConfig.h"
+#include "rtRemoteEnvironment.h"
+#include "rtRemoteSocketUtils.h"
+#include <arpa/inet.h>
 #include <limits.h>
 #include <memory>
+#include <string.h>
+#include <string>
+#include <vector>
 
 static char const* objectName = "com.xfinity.xsmart.SimpleServer/Comcast";
 class RemoteSettingsTest : public ::testing::Test {
@@ -463,6 +471,125 @@ TEST(RemoteSettingsTest,rtLCDPropertyTest)
   rtRemoteShutdown();
 }
 
+// strings are written inline below rt.rpc.stream.attachment_threshold and
+// sent as attachments at or above it, both ways must come back intact
+TEST(RemoteSettingsTest,rtAttachmentThresholdTest)
+{
+  rtRemoteEnvironment* env = rtEnvironmentGetGlobal();
+  EXPECT_EQ(RT_OK,rtRemoteInit(env));
+  env->Config->set_stream_attachment_threshold(1024);
+
+  rtObjectRef objectRef;
+  rtObjectRef serverObj(new rtLcd());
+  EXPECT_EQ(RT_OK, rtRemoteRegisterObject(objectName, serverObj));
+  EXPECT_EQ(RT_OK,rtRemoteLocateObject(objectName, objectRef));
+
+  std::string below(1023, 'a');
+  EXPECT_EQ(RT_OK,objectRef.set("text", below.c_str()));
+  rtString s = objectRef.get<rtString>("text");
+  EXPECT_EQ(below.size(), static_cast<size_t>(s.byteLength()));
+  EXPECT_STREQ(below.c_str(), s.cString());
+
+  std::string above(1025, 'b');
+  above[0] = '"';
+  above[1] = '\\';
+  EXPECT_EQ(RT_OK,objectRef.set("text", above.c_str()));
+  s = objectRef.get<rtString>("text");
+  EXPECT_EQ(above.size(), static_cast<size_t>(s.byteLength()));
+  EXPECT_STREQ(above.c_str(), s.cString());
+
+  env->Config->set_stream_attachment_threshold(0);
+  rtRemoteShutdown(env);
+}
+
+// length word with the attachment flag, json, then each attachment
+static std::vector<char>
+attachmentFrame(std::vector<uint32_t> const& lengths)
+{
+  std::string const json = "{\"message.type\":\"test\"}";
+  std::vector<char> frame;
+  auto put = [&frame](uint32_t n)
+  {
+    n = htonl(n);
+    frame.insert(frame.end(), reinterpret_cast<char *>(&n), reinterpret_cast<char *>(&n) + 4);
+  };
+
+  put(static_cast<uint32_t>(json.size()) | 0x80000000u);
+  frame.insert(frame.end(), json.begin(), json.end());
+  put(static_cast<uint32_t>(lengths.size()));
+  for (uint32_t n : lengths)
+  {
+    put(n);
+    frame.insert(frame.end(), n, 'x');
+  }
+  return frame;
+}
+
+static rtError
+readAttachmentFrame(std::vector<char> const& frame, uint32_t maxFrameBytes, rtRemoteMessagePtr& doc)
+{
+  rtRemoteSocketBuffer buff;
+  buff.reserve(1024);
+
+  size_t offset = 0;
+  return rtReadFrame([&frame, &offset](char* out, uint32_t n)
+    {
+      if (offset + n > frame.size())
+        return RT_FAIL;
+      memcpy(out, &frame[offset], n);
+      offset += n;
+      return RT_OK;
+    }, buff, doc, 1024, maxFrameBytes);
+}
+
+// each attachment is under the per attachment limit, but together they're
+// over the per frame cap, so the frame is refused
+TEST(RemoteSettingsTest,rtFrameAttachmentCapTest)
+{
+  std::vector<char> frame = attachmentFrame({ 600, 600 });
+
+  rtRemoteMessagePtr doc;
+  EXPECT_EQ(RT_OK, readAttachmentFrame(frame, 1200, doc));
+  ASSERT_TRUE(doc != nullptr);
+  EXPECT_EQ(2u, doc->getAttachments().size());
+
+  doc.reset();
+  EXPECT_EQ(RT_ERROR_PROTOCOL_ERROR, readAttachmentFrame(frame, 1199, doc));
+}
+
+// buffers go to the server and come back as local rtRemoteBuffer objects
+TEST(RemoteSettingsTest,rtRemoteBufferTest)
+{
+  EXPECT_EQ(RT_OK,rtRemoteInit());
+
+  rtObjectRef objectRef;
+  rtObjectRef serverObj(new rtThermostat());
+  EXPECT_EQ(RT_OK, rtRemoteRegisterObject(objectName, serverObj));
+  EXPECT_EQ(RT_OK,rtRemoteLocateObject(objectName, objectRef));
+
+  std::vector<char> bytes(4096);
+  for (size_t i = 0; i < bytes.size(); ++i)
+    bytes[i] = static_cast<char>(i);
+
+  EXPECT_EQ(RT_OK,objectRef.set("lcd", rtObjectRef(new rtRemoteBuffer(&bytes[0], bytes.size()))));
+  rtObjectRef ref;
+  EXPECT_EQ(RT_OK,objectRef.get("lcd", ref));
+  rtRemoteBuffer const* buff = rtRemoteBuffer::fromObject(ref.getPtr());
+  ASSERT_TRUE(buff != nullptr);
+  EXPECT_EQ(bytes.size(), buff->length());
+  EXPECT_EQ(0, memcmp(&bytes[0], buff->data(), bytes.size()));
+  EXPECT_EQ(bytes.size(), ref.get<uint32_t>("length"));
+
+  // empty
+  EXPECT_EQ(RT_OK,objectRef.set("lcd", rtObjectRef(new rtRemoteBuffer(nullptr, 0))));
+  EXPECT_EQ(RT_OK,objectRef.get("lcd", ref));
+  buff = rtRemoteBuffer::fromObject(ref.getPtr());
+  ASSERT_TRUE(buff != nullptr);
+  EXPECT_EQ(0u, buff->length());
+
+  rtRemoteShutdown();
+}
+
 int main(int argc,char **argv) {
     ::testing::InitGoogleTest(&argc, argv);
     return RUN_ALL_TESTS();